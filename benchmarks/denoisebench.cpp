@@ -0,0 +1,212 @@
+// What the denoiser buys: every clip is encoded without it and with
+// each level, twice — at a constant quality (CRF 23) to see how much
+// smaller the file gets, and at a fixed, tight bitrate to see how the
+// picture holds up (SSIM against the undenoised source, scaled the same
+// way). Encode times show the denoiser's cost.
+//
+// Without clips, a clean and a grainy 1080p30 clip are generated with
+// ffmpeg's lavfi sources.
+//
+//   clip2disc_denoisebench [--ffmpeg PATH] [--seconds N] [--kbps N]
+//                          [--resolution WxH] [clip...]
+
+#include "filtergraph.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QProcess>
+#include <QPair>
+#include <QRegularExpression>
+#include <QTextStream>
+
+struct Clip {
+    QString name;
+    QString path;
+    int width = 1920;
+    int height = 1080;
+};
+
+struct Run {
+    bool ok = false;
+    qint64 bytes = 0;
+    double seconds = 0.0;
+};
+
+static bool generateClip(const QString &ffmpeg, int seconds, const QString &filter,
+                         const QString &outPath)
+{
+    QString source = QString("testsrc2=size=1920x1080:rate=30:duration=%1").arg(seconds);
+    if (!filter.isEmpty())
+        source += "," + filter;
+
+    QProcess p;
+    p.start(ffmpeg, {
+        "-v", "error", "-y",
+        "-f", "lavfi", "-i", source,
+        "-c:v", "libx264", "-preset", "ultrafast", "-qp", "0",
+        outPath
+    });
+    return p.waitForFinished(600000) && p.exitCode() == 0;
+}
+
+static Run encode(const QString &ffmpeg, const Clip &clip, const QString &chain,
+                  const QStringList &rateControl, const QString &outPath)
+{
+    QStringList args { "-v", "error", "-y", "-i", clip.path, "-an" };
+    if (!chain.isEmpty())
+        args << "-vf" << chain;
+    args << "-c:v" << "libx264" << "-preset" << "fast" << rateControl << outPath;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QProcess p;
+    p.start(ffmpeg, args);
+
+    Run run;
+    run.ok = p.waitForFinished(1800000) && p.exitCode() == 0;
+    run.seconds = timer.nsecsElapsed() / 1e9;
+    run.bytes = QFileInfo(outPath).size();
+    return run;
+}
+
+// SSIM of the encode against the source scaled to the same size
+static double ssim(const QString &ffmpeg, const QString &encoded, const Clip &clip,
+                   int width, int height)
+{
+    QProcess p;
+    p.start(ffmpeg, {
+        "-hide_banner", "-nostats",
+        "-i", encoded,
+        "-i", clip.path,
+        "-lavfi", QString("[1:v]scale=%1:%2:flags=bicubic[ref];[0:v][ref]ssim").arg(width).arg(height),
+        "-f", "null", "-",
+    });
+    if (!p.waitForFinished(1800000) || p.exitCode() != 0)
+        return 0.0;
+
+    static const QRegularExpression pattern("All:([0-9.]+)");
+    const QRegularExpressionMatch m = pattern.match(QString::fromLocal8Bit(p.readAllStandardError()));
+    return m.hasMatch() ? m.captured(1).toDouble() : 0.0;
+}
+
+static void probeSize(const QString &ffprobe, Clip &clip)
+{
+    QProcess p;
+    p.start(ffprobe, {
+        "-v", "error", "-select_streams", "v:0",
+        "-show_entries", "stream=width,height", "-of", "csv=p=0",
+        clip.path,
+    });
+    if (!p.waitForFinished(30000))
+        return;
+
+    const QStringList parts = QString::fromLocal8Bit(p.readAllStandardOutput()).trimmed().split(',');
+    if (parts.size() == 2) {
+        clip.width = parts[0].toInt();
+        clip.height = parts[1].toInt();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"ffmpeg", "ffmpeg binary", "path", "ffmpeg"});
+    parser.addOption({"ffprobe", "ffprobe binary", "path", "ffprobe"});
+    parser.addOption({"seconds", "Length of the generated clips", "n", "10"});
+    parser.addOption({"kbps", "Video bitrate of the fixed-bitrate runs", "n", "1500"});
+    parser.addOption({"resolution", "Output size", "WxH", "1280x720"});
+    parser.addPositionalArgument("clip", "Reference clips (default: generated)", "[clip...]");
+    parser.process(app);
+
+    const QString ffmpeg = parser.value("ffmpeg");
+    const int seconds = qMax(1, parser.value("seconds").toInt());
+    const int kbps = qMax(1, parser.value("kbps").toInt());
+
+    const QStringList size = parser.value("resolution").split('x');
+    const int outWidth = size.size() == 2 ? size[0].toInt() : 1280;
+    const int outHeight = size.size() == 2 ? size[1].toInt() : 720;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create temporary directory\n";
+        return 1;
+    }
+
+    // --- Clips ---
+    QList<Clip> clips;
+    for (const QString &path : parser.positionalArguments()) {
+        Clip clip { QFileInfo(path).fileName(), path };
+        probeSize(parser.value("ffprobe"), clip);
+        clips << clip;
+    }
+
+    if (clips.isEmpty()) {
+        const QList<QPair<QString, QString>> generated {
+            { "clean", QString() },
+            { "grainy", "noise=alls=20:allf=t+u" },
+        };
+        for (const auto &g : generated) {
+            const QString path = dir.filePath(g.first + ".mkv");
+            if (!generateClip(ffmpeg, seconds, g.second, path)) {
+                out << "Failed to generate " << path << "\n";
+                return 1;
+            }
+            clips << Clip { g.first, path };
+        }
+        out << "Generated " << seconds << " s of 1920x1080@30, clean and grainy\n";
+    }
+
+    // --- Runs ---
+    const QStringList levels { QString(), "light", "medium" };
+
+    for (const Clip &clip : clips) {
+        out << "\n" << clip.name << " (" << clip.width << "x" << clip.height << ")\n";
+
+        qint64 baseBytes = 0;
+        double baseSsim = 0.0;
+
+        for (const QString &level : levels) {
+            VideoFilterSpec spec;
+            spec.sourceWidth = clip.width;
+            spec.sourceHeight = clip.height;
+            spec.outWidth = outWidth;
+            spec.outHeight = outHeight;
+            spec.denoise = level;
+            const QString chain = FilterGraph::chain(spec);
+
+            const QString name = level.isEmpty() ? QString("off") : level;
+            const QString crfPath = dir.filePath(name + "-crf.mp4");
+            const QString abrPath = dir.filePath(name + "-abr.mp4");
+
+            const Run crf = encode(ffmpeg, clip, chain, { "-crf", "23" }, crfPath);
+            const Run abr = encode(ffmpeg, clip, chain, { "-b:v", QString::number(kbps) + "k" }, abrPath);
+            const double score = abr.ok ? ssim(ffmpeg, abrPath, clip, outWidth, outHeight) : 0.0;
+
+            if (level.isEmpty()) {
+                baseBytes = crf.bytes;
+                baseSsim = score;
+            }
+
+            out << QString("%1: CRF 23 %2 KiB (%3%), %4 s | %5 kbps SSIM %6 (%7), %8 s%9\n")
+                       .arg(name, -7)
+                       .arg(crf.bytes / 1024)
+                       .arg(baseBytes > 0 ? 100.0 * (crf.bytes - baseBytes) / baseBytes : 0.0, 0, 'f', 1)
+                       .arg(crf.seconds, 0, 'f', 1)
+                       .arg(kbps)
+                       .arg(score, 0, 'f', 4)
+                       .arg(score - baseSsim, 0, 'f', 4)
+                       .arg(abr.seconds, 0, 'f', 1)
+                       .arg(crf.ok && abr.ok ? QString() : QString(" (failed)"));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Filter graph cost: the old "-vf scale=...:flags=lanczos -r N" against
+// the planned chain (frames dropped first, scaler chosen by ratio).
+//
+// Generates a 1080p60 clip with ffmpeg's lavfi sources, then runs both
+// graphs down to 720p30 into the null muxer and prints mean and median
+// wall time. Nothing is encoded unless --x264 is given, so the numbers
+// are decode + filter only.
+//
+//   clip2disc_filterbench [--ffmpeg PATH] [--seconds N] [--rounds N] [--x264]
+
+#include "filtergraph.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QProcess>
+#include <QTextStream>
+
+#include <algorithm>
+
+struct Graph {
+    QString name;
+    QStringList arguments;           // between the input and the output
+};
+
+static bool generateClip(const QString &ffmpeg, int seconds, const QString &outPath)
+{
+    QProcess p;
+    p.start(ffmpeg, {
+        "-v", "error", "-y",
+        "-f", "lavfi", "-i", QString("testsrc2=size=1920x1080:rate=60:duration=%1").arg(seconds),
+        "-c:v", "libx264", "-preset", "ultrafast",
+        outPath
+    });
+    return p.waitForFinished(300000) && p.exitCode() == 0;
+}
+
+static double median(QList<double> samples)
+{
+    if (samples.isEmpty())
+        return 0.0;
+    std::sort(samples.begin(), samples.end());
+    return samples.at(samples.size() / 2);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"ffmpeg", "ffmpeg binary", "path", "ffmpeg"});
+    parser.addOption({"seconds", "Length of the generated clip", "n", "10"});
+    parser.addOption({"rounds", "Runs per graph", "n", "5"});
+    parser.addOption({"x264", "Also encode with x264 (-preset fast), as a real encode would"});
+    parser.process(app);
+
+    const QString ffmpeg = parser.value("ffmpeg");
+    const int seconds = qMax(1, parser.value("seconds").toInt());
+    const int rounds = qMax(1, parser.value("rounds").toInt());
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create temporary directory\n";
+        return 1;
+    }
+
+    // --- Clip ---
+    const QString clip = dir.filePath("source.mp4");
+    if (!generateClip(ffmpeg, seconds, clip)) {
+        out << "Failed to generate " << clip << "\n";
+        return 1;
+    }
+    out << "Generated " << seconds << " s of 1920x1080@60\n";
+
+    // --- Graphs ---
+    VideoFilterSpec spec;
+    spec.sourceWidth = 1920;
+    spec.sourceHeight = 1080;
+    spec.sourceFps = 60.0;
+    spec.outWidth = 1280;
+    spec.outHeight = 720;
+    spec.fps = 30;
+
+    const QList<Graph> graphs {
+        { "old", { "-vf", "scale=1280:720:flags=lanczos", "-r", "30" } },
+        { "planned", { "-vf", FilterGraph::chain(spec) } },
+    };
+
+    const QStringList encoder = parser.isSet("x264")
+                                    ? QStringList { "-c:v", "libx264", "-preset", "fast" }
+                                    : QStringList();
+
+    for (const Graph &graph : graphs) {
+        QList<double> samplesMs;
+        int failures = 0;
+
+        for (int r = 0; r < rounds; ++r) {
+            QStringList args { "-v", "error", "-i", clip };
+            args << graph.arguments << encoder << "-f" << "null" << "-";
+
+            QElapsedTimer timer;
+            timer.start();
+
+            QProcess p;
+            p.start(ffmpeg, args);
+            const bool ok = p.waitForFinished(600000) && p.exitCode() == 0;
+            samplesMs << timer.nsecsElapsed() / 1e6;
+            if (!ok)
+                ++failures;
+        }
+
+        double sum = 0.0;
+        for (double v : samplesMs)
+            sum += v;
+
+        out << QString("%1: %2 runs, mean %3 ms, median %4 ms, failures %5\n")
+                   .arg(graph.name, -8)
+                   .arg(samplesMs.size())
+                   .arg(sum / samplesMs.size(), 0, 'f', 1)
+                   .arg(median(samplesMs), 0, 'f', 1)
+                   .arg(failures);
+        out << "          " << graph.arguments.join(' ') << "\n";
+    }
+
+    return 0;
+}
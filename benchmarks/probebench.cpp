@@ -0,0 +1,130 @@
+// Per-file probe latency: in-process libavformat vs spawning ffprobe.
+//
+// Generates a small corpus of clips with ffmpeg's lavfi sources, then
+// probes every clip with each available backend and prints mean, median
+// and p95 latency. The probe cache is bypassed on purpose.
+//
+//   clip2disc_probebench [--ffmpeg PATH] [--ffprobe PATH] [--clips N] [--rounds N]
+
+#include "probebackend.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QProcess>
+#include <QTextStream>
+
+#include <algorithm>
+
+struct ClipSpec {
+    const char *size;
+    int rate;
+    const char *container;
+};
+
+static const ClipSpec CORPUS[] = {
+    {"1920x1080", 60, "mp4"},
+    {"1280x720",  30, "mkv"},
+    {"2560x1440", 60, "mov"},
+    {"854x480",   30, "mp4"},
+};
+
+static bool generateClip(const QString &ffmpeg, const ClipSpec &spec,
+                         const QString &outPath)
+{
+    QProcess p;
+    p.start(ffmpeg, {
+        "-v", "error", "-y",
+        "-f", "lavfi", "-i", QString("testsrc2=size=%1:rate=%2:duration=2")
+                                 .arg(spec.size).arg(spec.rate),
+        "-f", "lavfi", "-i", "sine=frequency=440:duration=2",
+        "-c:v", "libx264", "-preset", "ultrafast",
+        "-c:a", "aac", "-shortest",
+        outPath
+    });
+    return p.waitForFinished(60000) && p.exitCode() == 0;
+}
+
+static double percentile(QList<double> samples, double p)
+{
+    if (samples.isEmpty())
+        return 0.0;
+    std::sort(samples.begin(), samples.end());
+    const int idx = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(idx);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"ffmpeg", "ffmpeg binary", "path", "ffmpeg"});
+    parser.addOption({"ffprobe", "ffprobe binary", "path", "ffprobe"});
+    parser.addOption({"clips", "Number of clips to generate", "n", "16"});
+    parser.addOption({"rounds", "Probe passes over the corpus", "n", "5"});
+    parser.process(app);
+
+    const int clipCount = qMax(1, parser.value("clips").toInt());
+    const int rounds    = qMax(1, parser.value("rounds").toInt());
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create temporary directory\n";
+        return 1;
+    }
+
+    // --- Corpus ---
+    QStringList clips;
+    const int specCount = int(sizeof(CORPUS) / sizeof(CORPUS[0]));
+    for (int i = 0; i < clipCount; ++i) {
+        const ClipSpec &spec = CORPUS[i % specCount];
+        const QString path = dir.filePath(QString("clip%1.%2").arg(i).arg(spec.container));
+        if (!generateClip(parser.value("ffmpeg"), spec, path)) {
+            out << "Failed to generate " << path << "\n";
+            return 1;
+        }
+        clips << path;
+    }
+    out << "Generated " << clips.size() << " clips\n";
+
+    // --- Probe ---
+    const ProbeBackendList backends = createProbeBackends(parser.value("ffprobe"));
+    const std::atomic_bool notCancelled{false};
+
+    for (const auto &backend : backends) {
+        QList<double> samplesMs;
+        int failures = 0;
+
+        for (int r = 0; r < rounds; ++r) {
+            for (const QString &clip : clips) {
+                QElapsedTimer timer;
+                timer.start();
+                const ProbeResult result = backend->probe(clip, notCancelled);
+                samplesMs << timer.nsecsElapsed() / 1e6;
+                if (!result.ok)
+                    ++failures;
+            }
+        }
+
+        double sum = 0.0;
+        for (double v : samplesMs)
+            sum += v;
+
+        out << QString("%1: %2 probes, mean %3 ms, median %4 ms, p95 %5 ms, failures %6\n")
+                   .arg(backend->name(), -12)
+                   .arg(samplesMs.size())
+                   .arg(sum / samplesMs.size(), 0, 'f', 2)
+                   .arg(percentile(samplesMs, 0.50), 0, 'f', 2)
+                   .arg(percentile(samplesMs, 0.95), 0, 'f', 2)
+                   .arg(failures);
+    }
+
+    if (backends.size() < 2)
+        out << "libavformat backend not built; configure with -DCLIP2DISC_LIBAV_PROBE=ON\n";
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+// HDR tone-mapping cost: tone-map at the source's size and then scale,
+// against the planned chain (scale first, 10 bits kept, tone-map the
+// smaller picture).
+//
+// Generates a 4K 10-bit clip tagged BT.2020/PQ with ffmpeg's lavfi
+// sources, then runs both graphs down to 720p into the null muxer and
+// prints mean and median wall time. Needs an FFmpeg built with zimg.
+//
+//   clip2disc_tonemapbench [--ffmpeg PATH] [--seconds N] [--rounds N]
+
+#include "filtergraph.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QProcess>
+#include <QTextStream>
+
+#include <algorithm>
+
+struct Graph {
+    QString name;
+    QStringList arguments;           // between the input and the output
+};
+
+static bool generateClip(const QString &ffmpeg, int seconds, const QString &outPath)
+{
+    QProcess p;
+    p.start(ffmpeg, {
+        "-v", "error", "-y",
+        "-f", "lavfi", "-i", QString("testsrc2=size=3840x2160:rate=30:duration=%1").arg(seconds),
+        "-c:v", "libx264", "-preset", "ultrafast", "-pix_fmt", "yuv420p10le",
+        "-color_primaries", "bt2020", "-color_trc", "smpte2084", "-colorspace", "bt2020nc",
+        outPath
+    });
+    return p.waitForFinished(600000) && p.exitCode() == 0;
+}
+
+static double median(QList<double> samples)
+{
+    if (samples.isEmpty())
+        return 0.0;
+    std::sort(samples.begin(), samples.end());
+    return samples.at(samples.size() / 2);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"ffmpeg", "ffmpeg binary", "path", "ffmpeg"});
+    parser.addOption({"seconds", "Length of the generated clip", "n", "5"});
+    parser.addOption({"rounds", "Runs per graph", "n", "3"});
+    parser.process(app);
+
+    const QString ffmpeg = parser.value("ffmpeg");
+    const int seconds = qMax(1, parser.value("seconds").toInt());
+    const int rounds = qMax(1, parser.value("rounds").toInt());
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create temporary directory\n";
+        return 1;
+    }
+
+    // --- Clip ---
+    const QString clip = dir.filePath("source.mp4");
+    if (!generateClip(ffmpeg, seconds, clip)) {
+        out << "Failed to generate " << clip << "\n";
+        return 1;
+    }
+    out << "Generated " << seconds << " s of 3840x2160@30, 10-bit PQ\n";
+
+    // --- Graphs ---
+    VideoFilterSpec spec;
+    spec.sourceWidth = 3840;
+    spec.sourceHeight = 2160;
+    spec.sourceFps = 30.0;
+    spec.outWidth = 1280;
+    spec.outHeight = 720;
+    spec.toneMap = true;
+    spec.bitDepth = 10;
+
+    const QString toneMapFirst =
+        "zscale=t=linear:npl=100,format=gbrpf32le,zscale=p=bt709,"
+        "tonemap=tonemap=hable:desat=0,zscale=t=bt709:m=bt709:r=tv,format=yuv420p,"
+        "scale=1280:720:flags=" + FilterGraph::scaler(3840, 2160, 1280, 720, spec.scalerBudget);
+
+    const QList<Graph> graphs {
+        { "tonemap-first", { "-vf", toneMapFirst } },
+        { "planned", { "-vf", FilterGraph::chain(spec) } },
+    };
+
+    for (const Graph &graph : graphs) {
+        QList<double> samplesMs;
+        int failures = 0;
+
+        for (int r = 0; r < rounds; ++r) {
+            QStringList args { "-v", "error", "-i", clip };
+            args << graph.arguments << "-f" << "null" << "-";
+
+            QElapsedTimer timer;
+            timer.start();
+
+            QProcess p;
+            p.start(ffmpeg, args);
+            const bool ok = p.waitForFinished(600000) && p.exitCode() == 0;
+            samplesMs << timer.nsecsElapsed() / 1e6;
+            if (!ok)
+                ++failures;
+        }
+
+        double sum = 0.0;
+        for (double v : samplesMs)
+            sum += v;
+
+        out << QString("%1: %2 runs, mean %3 ms, median %4 ms, failures %5\n")
+                   .arg(graph.name, -14)
+                   .arg(samplesMs.size())
+                   .arg(sum / samplesMs.size(), 0, 'f', 1)
+                   .arg(median(samplesMs), 0, 'f', 1)
+                   .arg(failures);
+        out << "                " << graph.arguments.join(' ') << "\n";
+    }
+
+    return 0;
+}
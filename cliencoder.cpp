@@ -0,0 +1,765 @@
+#include "cliencoder.h"
+#include "ffmpeglocator.h"
+#include "encodescheduler.h"
+#include "probebackend.h"
+#include "probecache.h"
+#include "fileidentity.h"
+#include "presettuner.h"
+#include "cropdetector.h"
+#include "clipanalyzer.h"
+#include "denoiser.h"
+#include "filtergraph.h"
+#include "qualityreport.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFutureWatcher>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <cstdio>
+
+static void printJson(QTextStream &out, const QJsonObject &obj)
+{
+    out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << '\n';
+    out.flush();
+}
+
+CliEncoder::CliEncoder(QObject *parent)
+    : QObject(parent)
+    , m_out(stdout)
+{
+}
+
+void CliEncoder::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        {{"i", "input"}, "Encode <file> without opening a window (repeatable).", "file"},
+        {{"o", "output"}, "Output file for a single input (default: <input>-clipped.mp4).", "file"},
+        {"start", "Trim start, in seconds or [hh:]mm:ss[.ms].", "time"},
+        {"end", "Trim end, in seconds or [hh:]mm:ss[.ms].", "time"},
+        {"target-size", "Fit the output into <mb> megabytes (1 MB = 1024 KiB).", "mb"},
+        {"tiers", "Encode once per size in <list> (e.g. 10,25,50) from a single decode.", "list"},
+        {"crop", "Crop to W:H:X:Y (source pixels) before scaling, or 'auto' to remove black bars.", "rect"},
+        {"resolution", "Output resolution, e.g. 1280x720.", "WxH"},
+        {"fps", "Output frame rate.", "fps"},
+        {"video-bitrate", "Video bitrate before resolution/fps scaling.", "kbps"},
+        {"audio-bitrate", "Audio bitrate.", "kbps"},
+        {"segments", "Split each clip at keyframes into <n> parts encoded in parallel (0 = auto).", "n"},
+        {"codec", "Video encoder: libx264 (default), libx265, libsvtav1, libvpx-vp9 or auto.", "name"},
+        {"speed-floor", "With --codec auto, slowest acceptable encode speed (default 1.0 = real time).", "x"},
+        {"deadline", "Use the slowest x264 preset that still finishes each clip within <sec> seconds.", "sec"},
+        {"time-budget", "Like --deadline, in multiples of the clip's length (e.g. 2 = twice real time).", "x"},
+        {"denoise", "Denoise before scaling: light, medium, off (default) or auto (when noisy and bits are tight).", "level"},
+        {"no-copy", "Always re-encode, even streams that already fit."},
+        {"cache-size", "Keep up to <mb> megabytes of earlier outputs and copy repeats from them (0 = off).", "mb"},
+        {"analyze", "Profile each clip's content (motion, scene cuts, black, loudness) in one decode first."},
+        {"quality-report", "Score each output against its source (sampled SSIM/PSNR) and log it with size and encode time."},
+        {"no-tonemap", "Keep HDR (PQ/HLG) sources as they are instead of converting them to SDR."},
+        {"jobs", "Encodes to run at once (default: from the core count).", "n"},
+        {"pin-cpus", "Give each running encode its own set of CPUs (Linux)."},
+    });
+}
+
+bool CliEncoder::isRequested(const QCommandLineParser &parser)
+{
+    return parser.isSet("input");
+}
+
+bool CliEncoder::parseTime(const QString &text, qint64 &ms)
+{
+    // Accept "93.5", "1:33.5" and "0:01:33.5"
+    const QStringList parts = text.split(':');
+    if (parts.isEmpty() || parts.size() > 3)
+        return false;
+
+    double seconds = 0.0;
+    for (const QString &part : parts) {
+        bool ok = false;
+        const double v = part.toDouble(&ok);
+        if (!ok || v < 0)
+            return false;
+        seconds = seconds * 60.0 + v;
+    }
+
+    ms = qint64(seconds * 1000.0 + 0.5);
+    return true;
+}
+
+bool CliEncoder::configure(const QCommandLineParser &parser)
+{
+    m_inputs = parser.values("input");
+
+    for (const QString &input : std::as_const(m_inputs)) {
+        if (!QFileInfo::exists(input)) {
+            fail(UsageError, "Input file not found: " + input);
+            return false;
+        }
+    }
+
+    m_settings.outputPath = parser.value("output");
+    if (!m_settings.outputPath.isEmpty() && m_inputs.size() > 1) {
+        fail(UsageError, "--output can only be used with a single --input");
+        return false;
+    }
+
+    if (parser.isSet("start") && !parseTime(parser.value("start"), m_settings.trimStartMs)) {
+        fail(UsageError, "Invalid --start: " + parser.value("start"));
+        return false;
+    }
+
+    if (parser.isSet("end") && !parseTime(parser.value("end"), m_settings.trimEndMs)) {
+        fail(UsageError, "Invalid --end: " + parser.value("end"));
+        return false;
+    }
+
+    if (parser.isSet("resolution")) {
+        const QStringList parts = parser.value("resolution").split('x');
+        if (parts.size() != 2 || parts[0].toInt() <= 0 || parts[1].toInt() <= 0) {
+            fail(UsageError, "Invalid --resolution: " + parser.value("resolution"));
+            return false;
+        }
+        m_settings.outWidth = parts[0].toInt();
+        m_settings.outHeight = parts[1].toInt();
+    }
+
+    if (parser.isSet("crop")) {
+        const QString crop = parser.value("crop");
+        m_autoCrop = crop == "auto";
+
+        if (!m_autoCrop) {
+            const QStringList parts = crop.split(':');
+            bool ok = parts.size() == 4;
+            int v[4] = {};
+            for (int i = 0; ok && i < 4; ++i)
+                v[i] = parts[i].toInt(&ok);
+
+            if (!ok || v[0] <= 0 || v[1] <= 0 || v[2] < 0 || v[3] < 0) {
+                fail(UsageError, "Invalid --crop: " + crop);
+                return false;
+            }
+            m_settings.crop = QRect(v[2], v[3], v[0] / 2 * 2, v[1] / 2 * 2);
+        }
+    }
+
+    // Numeric options: zero keeps the source value
+    struct IntOption { const char *name; int *target; };
+    const IntOption intOptions[] = {
+        {"fps", &m_settings.fps},
+        {"video-bitrate", &m_settings.userVideoBitrateKbps},
+        {"audio-bitrate", &m_settings.audioBitrateKbps},
+        {"jobs", &m_concurrency},
+    };
+
+    for (const IntOption &opt : intOptions) {
+        if (!parser.isSet(opt.name))
+            continue;
+
+        bool ok = false;
+        const int v = parser.value(opt.name).toInt(&ok);
+        if (!ok || v <= 0) {
+            fail(UsageError, QString("Invalid --%1: %2").arg(QLatin1String(opt.name), parser.value(opt.name)));
+            return false;
+        }
+        *opt.target = v;
+    }
+
+    if (parser.isSet("target-size")) {
+        bool ok = false;
+        const double mb = parser.value("target-size").toDouble(&ok);
+        if (!ok || mb <= 0) {
+            fail(UsageError, "Invalid --target-size: " + parser.value("target-size"));
+            return false;
+        }
+        m_settings.targetSizeBytes = qint64(mb * 1024 * 1024);
+    }
+
+    if (parser.isSet("tiers")) {
+        if (parser.isSet("target-size")) {
+            fail(UsageError, "--tiers and --target-size can't be combined");
+            return false;
+        }
+
+        for (const QString &part : parser.value("tiers").split(',', Qt::SkipEmptyParts)) {
+            bool ok = false;
+            const double mb = part.trimmed().toDouble(&ok);
+            if (!ok || mb <= 0) {
+                fail(UsageError, "Invalid --tiers: " + parser.value("tiers"));
+                return false;
+            }
+            m_tierSizes << qint64(mb * 1024 * 1024);
+        }
+    }
+
+    if (parser.isSet("segments")) {
+        bool ok = false;
+        const int v = parser.value("segments").toInt(&ok);
+        if (!ok || v < 0) {
+            fail(UsageError, "Invalid --segments: " + parser.value("segments"));
+            return false;
+        }
+        m_settings.segments = v;
+    }
+
+    if (parser.isSet("codec")) {
+        const QString codec = parser.value("codec");
+        m_autoCodec = codec == "auto";
+
+        if (!m_autoCodec) {
+            if (EncodePlanner::videoEncoder(codec).encoder != codec) {
+                fail(UsageError, "Unknown --codec: " + codec);
+                return false;
+            }
+            m_settings.videoEncoder = codec;
+        }
+    }
+
+    if (parser.isSet("cache-size")) {
+        bool ok = false;
+        const double mb = parser.value("cache-size").toDouble(&ok);
+        if (!ok || mb < 0) {
+            fail(UsageError, "Invalid --cache-size: " + parser.value("cache-size"));
+            return false;
+        }
+        m_outputCache.setMaxBytes(qint64(mb * 1024 * 1024));
+    }
+
+    if (parser.isSet("speed-floor")) {
+        bool ok = false;
+        m_speedFloor = parser.value("speed-floor").toDouble(&ok);
+        if (!ok || m_speedFloor < 0) {
+            fail(UsageError, "Invalid --speed-floor: " + parser.value("speed-floor"));
+            return false;
+        }
+    }
+
+    // Time budget for the x264 preset
+    struct DoubleOption { const char *name; double *target; };
+    const DoubleOption budgetOptions[] = {
+        {"deadline", &m_deadlineSec},
+        {"time-budget", &m_timeBudget},
+    };
+
+    for (const DoubleOption &opt : budgetOptions) {
+        if (!parser.isSet(opt.name))
+            continue;
+
+        bool ok = false;
+        const double v = parser.value(opt.name).toDouble(&ok);
+        if (!ok || v <= 0) {
+            fail(UsageError, QString("Invalid --%1: %2").arg(QLatin1String(opt.name), parser.value(opt.name)));
+            return false;
+        }
+        *opt.target = v;
+    }
+
+    if (m_deadlineSec > 0 && m_timeBudget > 0) {
+        fail(UsageError, "--deadline and --time-budget can't be combined");
+        return false;
+    }
+
+    if (parser.isSet("denoise")) {
+        const QString level = parser.value("denoise");
+        m_autoDenoise = level == "auto";
+
+        if (!m_autoDenoise && level != "off") {
+            if (FilterGraph::denoiser(level).isEmpty()) {
+                fail(UsageError, "Invalid --denoise: " + level);
+                return false;
+            }
+            m_settings.denoise = level;
+        }
+    }
+
+    m_settings.allowStreamCopy = !parser.isSet("no-copy");
+    m_settings.toneMapHdr = !parser.isSet("no-tonemap");
+    m_analyze = parser.isSet("analyze");
+    m_qualityReport = parser.isSet("quality-report");
+    m_pinCpus = parser.isSet("pin-cpus");
+
+    return true;
+}
+
+void CliEncoder::fail(ExitCode code, const QString &message)
+{
+    printJson(m_out, {
+        {"event", "error"},
+        {"code", int(code)},
+        {"message", message},
+    });
+
+    // Defer so fail() can be called before the event loop runs
+    QTimer::singleShot(0, qApp, [code] {
+        QCoreApplication::exit(code);
+    });
+}
+
+void CliEncoder::setExitCode(ExitCode code)
+{
+    // The first failure decides the exit code of a batch
+    if (m_exitCode == Success)
+        m_exitCode = code;
+}
+
+void CliEncoder::start()
+{
+    m_elapsed.start();
+
+    // --- FFmpeg ---
+    FfmpegLocator locator;
+    if (!locator.locateBlocking()) {
+        fail(FfmpegMissing, "FFmpeg binaries not found");
+        return;
+    }
+    m_ffmpegPath = locator.ffmpegPath();
+    m_outputCache.setEncoder(m_ffmpegPath, locator.ffmpegVersion());
+
+    // Measured once per FFmpeg binary, then read from the settings
+    m_encoderCaps = EncoderCaps::cached(m_ffmpegPath);
+    if (m_autoCodec && !m_encoderCaps.isValid())
+        m_encoderCaps = EncoderCaps::discover(m_ffmpegPath);
+
+    // Builds without zimg can't tone-map; ones not measured yet are assumed to
+    if (m_encoderCaps.isValid()
+        && !(m_encoderCaps.hasFilter("zscale") && m_encoderCaps.hasFilter("tonemap")))
+        m_settings.toneMapHdr = false;
+
+    m_scheduler = new EncodeScheduler(this);
+    m_scheduler->setConcurrency(m_concurrency);
+    m_scheduler->setPinCpus(m_pinCpus);
+
+    connect(m_scheduler, &EncodeScheduler::jobStarted, this, [this](int id) {
+        if (m_jobs.contains(id))
+            m_jobs[id].started.start();
+    });
+    connect(m_scheduler, &EncodeScheduler::jobProgress, this, &CliEncoder::onProgress);
+    connect(m_scheduler, &EncodeScheduler::jobRetrying, this, &CliEncoder::onRetrying);
+    connect(m_scheduler, &EncodeScheduler::jobTierRedo, this, &CliEncoder::onTierRedo);
+    connect(m_scheduler, &EncodeScheduler::jobFinished, this, &CliEncoder::onJobFinished);
+    connect(m_scheduler, &EncodeScheduler::allFinished, this, &CliEncoder::onAllFinished);
+
+    printJson(m_out, {
+        {"event", "scheduler"},
+        {"jobs", m_scheduler->concurrency()},
+        {"threads_per_job", m_scheduler->threadsPerJob()},
+        {"pinned", m_pinCpus},
+    });
+
+    for (const QString &input : std::as_const(m_inputs)) {
+        Job job;
+        job.settings = m_settings;
+        job.settings.inputPath = input;
+
+        if (job.settings.outputPath.isEmpty()) {
+            const QFileInfo inputInfo(input);
+            job.settings.outputPath =
+                inputInfo.absolutePath() + "/" +
+                inputInfo.completeBaseName() +
+                "-clipped.mp4";
+        }
+
+        if (!prepareJob(job, locator.ffprobePath())) {
+            setExitCode(ProbeFailed);
+            continue;
+        }
+
+        // Exported before with the same source, range and arguments
+        if (m_outputCache.restore(job.plan)) {
+            printDone(0, job, true);
+            continue;
+        }
+
+        const int id = m_scheduler->enqueue(m_ffmpegPath, job.plan);
+        m_jobs.insert(id, job);
+
+        QJsonArray tiers;
+        for (const EncodeTier &tier : std::as_const(job.plan.tiers)) {
+            tiers << QJsonObject {
+                {"output", tier.settings.outputPath},
+                {"target_size", tier.settings.targetSizeBytes},
+                {"width", tier.settings.outWidth},
+                {"height", tier.settings.outHeight},
+                {"fps", tier.settings.fps},
+                {"video_kbps", tier.videoBitrateKbps},
+            };
+        }
+
+        printJson(m_out, {
+            {"event", "plan"},
+            {"job", id},
+            {"input", input},
+            {"output", job.plan.settings.outputPath},
+            {"encoder", EncodePlanner::videoEncoder(job.plan.settings.videoEncoder).encoder},
+            {"crop", job.plan.settings.crop.isEmpty()
+                         ? QString()
+                         : QString("%1:%2:%3:%4")
+                               .arg(job.plan.settings.crop.width())
+                               .arg(job.plan.settings.crop.height())
+                               .arg(job.plan.settings.crop.x())
+                               .arg(job.plan.settings.crop.y())},
+            {"width", job.plan.outWidth},
+            {"height", job.plan.outHeight},
+            {"fps", job.plan.fps},
+            {"video_kbps", job.plan.videoBitrateKbps},
+            {"audio_kbps", job.plan.audioBitrateKbps},
+            {"duration", job.plan.durationSec},
+            {"segments", job.plan.segments},
+            {"copy_video", job.plan.copyVideo},
+            {"copy_audio", job.plan.copyAudio},
+            {"smart_cut", job.plan.smartCut},
+            {"two_pass", job.plan.twoPass},
+            {"x264_preset", job.plan.settings.x264Preset},
+            {"denoise", job.plan.settings.denoise},
+            {"tone_map", job.plan.settings.toneMapHdr && job.plan.source.isHdr()},
+            {"tiers", tiers},
+        });
+    }
+
+    // Nothing was queued (unreadable or cached); still finish through the event loop
+    if (m_scheduler->isIdle())
+        QTimer::singleShot(0, this, &CliEncoder::onAllFinished);
+}
+
+EncodePlan CliEncoder::planJob(const Job &job,
+                               const VideoInfo &info,
+                               const SourceAnalysis &analysis) const
+{
+    if (m_tierSizes.isEmpty())
+        return EncodePlanner::plan(info, job.settings, analysis);
+
+    QList<EncodeSettings> tiers;
+    for (qint64 bytes : std::as_const(m_tierSizes)) {
+        EncodeSettings tier = job.settings;
+        tier.targetSizeBytes = bytes;
+        tier.outputPath = EncodePlanner::tierOutputPath(job.settings.outputPath, bytes);
+        tiers << tier;
+    }
+    return EncodePlanner::planTiers(info, tiers, analysis);
+}
+
+bool CliEncoder::prepareJob(Job &job, const QString &ffprobePath)
+{
+    const QString &input = job.settings.inputPath;
+
+    // --- Probe (cached, same backends as the window) ---
+    ProbeCache &cache = m_probeCache;
+    const FileIdentity id = FileIdentity::of(input);
+
+    ProbeResult probe;
+    probe.ok = cache.lookup(id, probe.info);
+
+    if (!probe.ok) {
+        const std::atomic_bool notCancelled{false};
+        for (const auto &backend : createProbeBackends(ffprobePath)) {
+            probe = backend->probe(input, notCancelled);
+            if (probe.ok)
+                break;
+        }
+
+        if (!probe.ok) {
+            printJson(m_out, {
+                {"event", "error"},
+                {"code", int(ProbeFailed)},
+                {"input", input},
+                {"message", probe.error},
+            });
+            return false;
+        }
+        cache.store(id, probe.info);
+    }
+
+    const VideoInfo &info = probe.info;
+
+    printJson(m_out, {
+        {"event", "probe"},
+        {"input", input},
+        {"duration", info.duration},
+        {"width", info.width},
+        {"height", info.height},
+        {"fps", info.fps},
+        {"video_codec", info.videoCodec},
+        {"audio_codec", info.audioCodec},
+        {"bitrate_kbps", info.bitrate},
+        {"hdr", info.isHdr()},
+        {"bit_depth", info.bitDepth},
+    });
+
+    // --- Keyframes (only needed to split or stream-copy) ---
+    SourceAnalysis analysis;
+    if (EncodePlanner::needsKeyframes(info, job.settings)) {
+        if (!m_keyframeCache.lookup(id, analysis.keyframes)) {
+            const std::atomic_bool notCancelled{false};
+            QString error;
+            analysis.keyframes = KeyframeIndex::build(ffprobePath, input, notCancelled, &error);
+
+            if (analysis.keyframes.isEmpty())
+                qDebug() << "No keyframe index, planning without it:" << error;
+            else
+                m_keyframeCache.store(id, analysis.keyframes);
+        }
+    }
+
+    const double rangeStartSec = job.settings.trimStartMs / 1000.0;
+    const double rangeEndSec = job.settings.trimEndMs > 0 ? job.settings.trimEndMs / 1000.0
+                                                          : info.duration;
+
+    // --- Content profile ---
+    ComplexityProfile profile;
+    if (m_analyze) {
+        const std::atomic_bool notCancelled{false};
+        QString error;
+        profile = ClipAnalyzer::analyzeBlocking(m_ffmpegPath, input, info,
+                                                rangeStartSec,
+                                                rangeEndSec - rangeStartSec,
+                                                notCancelled, &error);
+
+        if (profile.isEmpty()) {
+            qDebug() << "No content profile:" << error;
+        } else {
+            QJsonArray cuts;
+            for (double sec : profile.sceneCuts())
+                cuts << sec;
+
+            printJson(m_out, {
+                {"event", "profile"},
+                {"input", input},
+                {"seconds", int(profile.buckets().size())},
+                {"mean_motion", profile.meanMotion(profile.startSec(),
+                                                   profile.startSec() + profile.rangeSec())},
+                {"scene_cuts", cuts},
+                {"silent_share", profile.silentShare()},
+                {"loudness_lufs", profile.integratedLoudness()},
+            });
+        }
+    }
+
+    // --- Crop ---
+    // The profile has already looked at every second; otherwise a few
+    // keyframes are sampled
+    if (m_autoCrop) {
+        if (!profile.isEmpty()) {
+            job.settings.crop = profile.crop();
+        } else {
+            const std::atomic_bool notCancelled{false};
+            job.settings.crop = CropDetector::detectBlocking(m_ffmpegPath, input, info,
+                                                             rangeStartSec,
+                                                             rangeEndSec - rangeStartSec,
+                                                             notCancelled);
+        }
+    }
+
+    // --- Codec ---
+    // Chosen for the format libx264 would get; a faster or more
+    // efficient encoder only changes how the bits are spent
+    if (m_autoCodec) {
+        const EncodePlan reference = EncodePlanner::plan(info, job.settings, analysis);
+        job.settings.videoEncoder = m_encoderCaps.chooseEncoder(reference, m_speedFloor);
+    }
+
+    // --- Plan ---
+    QElapsedTimer planning;
+    planning.start();
+
+    job.plan = planJob(job, info, analysis);
+
+    // --- Denoise ---
+    // Judged on the plan's bitrate, which denoising doesn't change
+    if (m_autoDenoise && !job.plan.copyVideo && !job.plan.smartCut) {
+        const std::atomic_bool notCancelled{false};
+        const NoiseMeasurement noise = Denoiser::measure(m_ffmpegPath, input, info,
+                                                         rangeStartSec,
+                                                         rangeEndSec - rangeStartSec,
+                                                         notCancelled);
+        job.settings.denoise =
+            Denoiser::chooseLevel(job.plan, noise,
+                                  Denoiser::estimatedEncodeSeconds(job.plan, m_encoderCaps));
+        if (!job.settings.denoise.isEmpty())
+            job.plan = planJob(job, info, analysis);
+    }
+
+    // --- x264 preset (time budget) ---
+    // Calibrated once per machine and size; the measurement itself
+    // counts against the deadline
+    const double budgetSec = m_deadlineSec > 0.0 ? m_deadlineSec
+                                                 : m_timeBudget * job.plan.durationSec;
+    if (budgetSec > 0.0 && !job.plan.copyVideo && !job.plan.smartCut
+        && EncodePlanner::videoEncoder(job.plan.settings.videoEncoder).encoder == "libx264") {
+        double fps = PresetTuner::calibratedFps(job.plan.outWidth, job.plan.outHeight);
+        if (fps <= 0.0)
+            fps = PresetTuner::calibrate(m_ffmpegPath, job.plan);
+
+        if (fps > 0.0) {
+            const double remainingSec = budgetSec - planning.elapsed() / 1000.0;
+            job.settings.x264Preset = PresetTuner::choosePreset(job.plan, fps, remainingSec);
+            job.plan = planJob(job, info, analysis);
+        } else {
+            qDebug() << "x264 calibration failed, keeping the default preset";
+        }
+    }
+
+    if (job.plan.durationSec <= 0.0) {
+        printJson(m_out, {
+            {"event", "error"},
+            {"code", int(UsageError)},
+            {"input", input},
+            {"message", "Empty trim range"},
+        });
+        setExitCode(UsageError);
+        return false;
+    }
+
+    return true;
+}
+
+void CliEncoder::onProgress(int id, const EncodeProgress &progress)
+{
+    printJson(m_out, {
+        {"event", "progress"},
+        {"job", id},
+        {"percent", progress.percent},
+        {"out_time_us", progress.outTimeUs},
+        {"frame", progress.frame},
+        {"fps", progress.fps},
+        {"speed", progress.speed},
+        {"total_size", progress.totalSize},
+        {"bitrate_kbps", progress.bitrateKbps},
+        {"eta", progress.etaSec},
+    });
+}
+
+void CliEncoder::onRetrying(int id, int attempt, int videoBitrateKbps)
+{
+    printJson(m_out, {
+        {"event", "retry"},
+        {"job", id},
+        {"attempt", attempt},
+        {"video_kbps", videoBitrateKbps},
+    });
+}
+
+void CliEncoder::onTierRedo(int id, const QString &outputPath, int videoBitrateKbps)
+{
+    printJson(m_out, {
+        {"event", "tier_redo"},
+        {"job", id},
+        {"output", outputPath},
+        {"video_kbps", videoBitrateKbps},
+    });
+}
+
+void CliEncoder::onJobFinished(int id, bool ok, const QString &errorLog)
+{
+    const Job job = m_jobs.take(id);
+
+    if (!ok) {
+        setExitCode(EncodeFailed);
+        printJson(m_out, {
+            {"event", "error"},
+            {"code", int(EncodeFailed)},
+            {"job", id},
+            {"input", job.settings.inputPath},
+            {"message", errorLog},
+        });
+        return;
+    }
+
+    printDone(id, job, false);
+    m_outputCache.store(job.plan);
+
+    if (m_qualityReport)
+        startQualityReport(id, job);
+}
+
+void CliEncoder::printDone(int id, const Job &job, bool cached)
+{
+    QJsonArray outputs;
+    for (const EncodeTier &tier : std::as_const(job.plan.tiers)) {
+        outputs << QJsonObject {
+            {"output", tier.settings.outputPath},
+            {"size", QFileInfo(tier.settings.outputPath).size()},
+        };
+    }
+
+    printJson(m_out, {
+        {"event", "done"},
+        {"job", id},
+        {"input", job.settings.inputPath},
+        {"output", job.plan.settings.outputPath},
+        {"size", QFileInfo(job.plan.settings.outputPath).size()},
+        {"outputs", outputs},
+        {"cached", cached},
+        {"elapsed", m_elapsed.elapsed() / 1000.0},
+    });
+}
+
+void CliEncoder::startQualityReport(int id, const Job &job)
+{
+    const QString ffmpegPath = m_ffmpegPath;
+    const EncodePlan plan = job.plan;
+    const double encodeSec = job.started.isValid() ? job.started.elapsed() / 1000.0 : 0.0;
+
+    // Off the event loop, so the encodes still running keep being read
+    auto *watcher = new QFutureWatcher<QList<QualityScore>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, id, encodeSec]() {
+        for (const QualityScore &score : watcher->result()) {
+            printJson(m_out, {
+                {"event", "quality"},
+                {"job", id},
+                {"output", score.outputPath},
+                {"size", score.bytes},
+                {"width", score.width},
+                {"height", score.height},
+                {"fps", score.fps},
+                {"video_kbps", score.videoBitrateKbps},
+                {"encode_sec", encodeSec},
+                {"ssim", score.ssim},
+                {"psnr", score.psnr},
+                {"samples", score.samples},
+            });
+        }
+        watcher->deleteLater();
+
+        if (--m_pendingReports == 0 && m_allEncoded)
+            onAllFinished();
+    });
+
+    ++m_pendingReports;
+    watcher->setFuture(QtConcurrent::run([ffmpegPath, plan, encodeSec]() {
+        const std::atomic_bool cancelled { false };
+        const QList<QualityScore> scores = QualityReport::measure(ffmpegPath, plan, cancelled);
+        QualityReport::record(plan, scores, encodeSec);
+        return scores;
+    }));
+}
+
+void CliEncoder::onAllFinished()
+{
+    // Quality reports still running come before the summary
+    if (m_pendingReports > 0) {
+        m_allEncoded = true;
+        return;
+    }
+
+    const EncodeScheduler::Throughput t = m_scheduler->throughput();
+    const OutputCache::Stats cache = m_outputCache.stats();
+
+    printJson(m_out, {
+        {"event", "summary"},
+        {"completed", t.completed},
+        {"failed", t.failed},
+        {"wall_sec", t.wallSec},
+        {"encoded_sec", t.encodedSec},
+        {"clips_per_hour", t.clipsPerHour},
+        {"encoded_per_wall_sec", t.encodedPerWallSec},
+        {"cache_hits", cache.hits},
+        {"cache_hit_rate", cache.hitRate()},
+        {"cache_bytes_saved", cache.bytesSaved},
+    });
+
+    QCoreApplication::exit(m_exitCode);
+}
@@ -0,0 +1,101 @@
+#ifndef CLIENCODER_H
+#define CLIENCODER_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "encodeplan.h"
+#include "encodercaps.h"
+#include "progressparser.h"
+#include "probecache.h"
+#include "keyframeindexcache.h"
+#include "outputcache.h"
+
+class QCommandLineParser;
+class EncodeScheduler;
+
+// Headless encode driven from the command line (clip2disc --input ...).
+//
+// Uses the same probe backends and EncodePlanner as the window but never
+// touches QtWidgets. --input may be repeated; the clips then run through
+// an EncodeScheduler, several at a time. Progress and results are
+// written to stdout as one JSON object per line; the process exit code
+// is one of ExitCode.
+class CliEncoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ExitCode {
+        Success        = 0,
+        UsageError     = 1,
+        FfmpegMissing  = 2,
+        ProbeFailed    = 3,
+        EncodeFailed   = 4,
+    };
+
+    explicit CliEncoder(QObject *parent = nullptr);
+
+    static void addOptions(QCommandLineParser &parser);
+    static bool isRequested(const QCommandLineParser &parser);
+
+    // Reads options; on failure prints the error and returns false
+    bool configure(const QCommandLineParser &parser);
+
+    // Starts the job; the application exits with an ExitCode when done
+    void start();
+
+private:
+    struct Job {
+        EncodeSettings settings;
+        EncodePlan plan;
+        QElapsedTimer started;       // when the scheduler ran it
+    };
+
+    void fail(ExitCode code, const QString &message);
+    void setExitCode(ExitCode code);
+    bool prepareJob(Job &job, const QString &ffprobePath);
+    EncodePlan planJob(const Job &job, const VideoInfo &info, const SourceAnalysis &analysis) const;
+    void onProgress(int id, const EncodeProgress &progress);
+    void onRetrying(int id, int attempt, int videoBitrateKbps);
+    void onTierRedo(int id, const QString &outputPath, int videoBitrateKbps);
+    void onJobFinished(int id, bool ok, const QString &errorLog);
+    void onAllFinished();
+    void startQualityReport(int id, const Job &job);
+    void printDone(int id, const Job &job, bool cached);
+
+    static bool parseTime(const QString &text, qint64 &ms);
+
+    EncodeSettings m_settings;      // shared by every input
+    QList<qint64> m_tierSizes;      // --tiers, bytes; one decode, several outputs
+    bool m_autoCodec = false;       // --codec auto: picked per clip from m_encoderCaps
+    double m_speedFloor = 1.0;      // --speed-floor, multiple of real time
+    double m_deadlineSec = 0.0;     // --deadline, wall-clock seconds per clip
+    double m_timeBudget = 0.0;      // --time-budget, multiple of the clip's length
+    bool m_autoCrop = false;        // --crop auto: detected per clip
+    bool m_analyze = false;         // --analyze: content profile per clip
+    bool m_autoDenoise = false;     // --denoise auto: measured per clip
+    bool m_qualityReport = false;   // --quality-report: SSIM/PSNR after each encode
+    int m_pendingReports = 0;
+    bool m_allEncoded = false;      // the summary waits for the reports
+    EncoderCaps m_encoderCaps;
+    QStringList m_inputs;
+    QHash<int, Job> m_jobs;         // scheduler id → job
+
+    int m_concurrency = 0;
+    bool m_pinCpus = false;
+    ExitCode m_exitCode = Success;
+
+    ProbeCache m_probeCache;
+    KeyframeIndexCache m_keyframeCache;
+    OutputCache m_outputCache;      // earlier outputs of the same source and arguments
+
+    QString m_ffmpegPath;
+    EncodeScheduler *m_scheduler = nullptr;
+    QElapsedTimer m_elapsed;
+    QTextStream m_out;
+};
+
+#endif // CLIENCODER_H
@@ -0,0 +1,131 @@
+#include "clipanalyzer.h"
+#include "complexityprofilecache.h"
+#include "fileidentity.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QTimer>
+#include <QDebug>
+
+// Longer than the crop detection's: this one decodes the whole range
+static constexpr int DEBOUNCE_MS = 800;
+
+ClipAnalyzer::ClipAnalyzer(QObject *parent)
+    : QObject(parent)
+    , m_debounce(new QTimer(this))
+    , m_cache(std::make_shared<ComplexityProfileCache>())
+{
+    m_debounce->setSingleShot(true);
+    m_debounce->setInterval(DEBOUNCE_MS);
+    connect(m_debounce, &QTimer::timeout, this, &ClipAnalyzer::startAnalysis);
+}
+
+ClipAnalyzer::~ClipAnalyzer()
+{
+    cancel();
+}
+
+bool ClipAnalyzer::isRunning() const
+{
+    return m_debounce->isActive() || (m_watcher && m_watcher->isRunning());
+}
+
+void ClipAnalyzer::analyze(const QString &filePath, const VideoInfo &source,
+                           double startSec, double durationSec)
+{
+    cancel();
+
+    m_request = { filePath, source, startSec, durationSec };
+    m_debounce->start();
+}
+
+void ClipAnalyzer::cancel()
+{
+    m_debounce->stop();
+
+    if (m_cancelFlag)
+        m_cancelFlag->store(true);
+    m_cancelFlag.reset();
+
+    if (m_watcher) {
+        m_watcher->disconnect(this);
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+    }
+}
+
+void ClipAnalyzer::startAnalysis()
+{
+    if (m_ffmpegPath.isEmpty() || m_request.durationSec <= 0.0)
+        return;
+
+    const Request request = m_request;
+    m_cancelFlag = std::make_shared<std::atomic_bool>(false);
+    m_watcher = new QFutureWatcher<Result>(this);
+
+    QFutureWatcher<Result> *watcher = m_watcher;
+    connect(watcher, &QFutureWatcher<Result>::finished,
+            this, [this, watcher, request]() {
+                if (watcher != m_watcher)
+                    return;
+
+                const Result result = watcher->result();
+
+                m_watcher->deleteLater();
+                m_watcher = nullptr;
+                m_cancelFlag.reset();
+
+                if (!result.profile.isEmpty())
+                    emit analyzed(request.filePath, result.profile);
+                else
+                    emit analysisFailed(request.filePath, result.error);
+            });
+
+    const CancelFlag flag = m_cancelFlag;
+    const std::shared_ptr<ComplexityProfileCache> cache = m_cache;
+    const QString ffmpegPath = m_ffmpegPath;
+    watcher->setFuture(QtConcurrent::run([ffmpegPath, request, cache, flag]() {
+        return runAnalysis(ffmpegPath, request, *cache, *flag);
+    }));
+}
+
+// ----------------- Worker -----------------
+
+ClipAnalyzer::Result ClipAnalyzer::runAnalysis(const QString &ffmpegPath,
+                                               const Request &request,
+                                               ComplexityProfileCache &cache,
+                                               const std::atomic_bool &cancelled)
+{
+    const FileIdentity id = FileIdentity::of(request.filePath);
+
+    Result result;
+    if (cache.lookup(id, request.startSec, request.durationSec, result.profile)) {
+        qDebug() << "Complexity profile cache hit:" << request.filePath;
+        return result;
+    }
+
+    result.profile = ComplexityProfile::build(ffmpegPath, request.filePath, request.source,
+                                              request.startSec, request.durationSec,
+                                              cancelled, &result.error);
+
+    if (!result.profile.isEmpty())
+        cache.store(id, result.profile);
+
+    return result;
+}
+
+ComplexityProfile ClipAnalyzer::analyzeBlocking(const QString &ffmpegPath,
+                                                const QString &filePath,
+                                                const VideoInfo &source,
+                                                double startSec,
+                                                double durationSec,
+                                                const std::atomic_bool &cancelled,
+                                                QString *error)
+{
+    const Request request { filePath, source, startSec, durationSec };
+    ComplexityProfileCache cache;
+
+    const Result result = runAnalysis(ffmpegPath, request, cache, cancelled);
+    if (error)
+        *error = result.error;
+    return result.profile;
+}
@@ -0,0 +1,82 @@
+#ifndef CLIPANALYZER_H
+#define CLIPANALYZER_H
+
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+
+#include <atomic>
+#include <memory>
+
+#include "complexityprofile.h"
+#include "videoinfo.h"
+
+class QTimer;
+class ComplexityProfileCache;
+
+// Builds the ComplexityProfile of the marked range in the background.
+// One range at a time: requests are debounced like the crop detection
+// (the trim marks move in steps), a new one abandons the previous
+// analysis, and finished profiles come from the on-disk
+// ComplexityProfileCache when the file hasn't changed.
+class ClipAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClipAnalyzer(QObject *parent = nullptr);
+    ~ClipAnalyzer();
+
+    void setFfmpegPath(const QString &path) { m_ffmpegPath = path; }
+
+    void analyze(const QString &filePath, const VideoInfo &source,
+                 double startSec, double durationSec);
+    void cancel();
+
+    bool isRunning() const;
+
+    // Blocking, with the same cache; for the command line
+    static ComplexityProfile analyzeBlocking(const QString &ffmpegPath,
+                                             const QString &filePath,
+                                             const VideoInfo &source,
+                                             double startSec,
+                                             double durationSec,
+                                             const std::atomic_bool &cancelled,
+                                             QString *error = nullptr);
+
+signals:
+    void analyzed(const QString &filePath, const ComplexityProfile &profile);
+    void analysisFailed(const QString &filePath, const QString &error);
+
+private:
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+
+    struct Request {
+        QString filePath;
+        VideoInfo source;
+        double startSec = 0.0;
+        double durationSec = 0.0;
+    };
+
+    struct Result {
+        ComplexityProfile profile;
+        QString error;
+    };
+
+    static Result runAnalysis(const QString &ffmpegPath,
+                              const Request &request,
+                              ComplexityProfileCache &cache,
+                              const std::atomic_bool &cancelled);
+
+    void startAnalysis();
+
+    QString m_ffmpegPath;
+    Request m_request;
+
+    QTimer *m_debounce = nullptr;
+    std::shared_ptr<ComplexityProfileCache> m_cache;
+    CancelFlag m_cancelFlag;
+    QFutureWatcher<Result> *m_watcher = nullptr;
+};
+
+#endif // CLIPANALYZER_H
@@ -0,0 +1,400 @@
+#include "complexityprofile.h"
+#include "cropdetector.h"
+
+#include <QProcess>
+#include <QRegularExpression>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <cmath>
+
+// Enough frames for cuts and motion; the decoder still sees them all,
+// but the filters only a few
+static constexpr int ANALYSIS_FPS   = 10;
+static constexpr int ANALYSIS_WIDTH = 320;
+
+// cropdetect's black threshold (of 255), the same as CropDetector's
+static constexpr int CROP_BLACK_LIMIT = 24;
+
+// A frame counts as black when this share of its pixels is below 32
+static constexpr int BLACK_PIXEL_PERCENT = 98;
+
+// Scene score of a cut, and the closest two cuts may be
+static constexpr double SCENE_CUT_SCORE  = 0.4;
+static constexpr double MIN_CUT_GAP_SEC  = 0.5;
+
+// Loudness is averaged over windows of this many samples at 48 kHz
+static constexpr int AUDIO_WINDOW_SAMPLES = 4800;
+
+// A full decode of the range: allow a minute plus twice real time
+static constexpr int PROFILE_BASE_TIMEOUT_MS = 60000;
+static constexpr int PROFILE_POLL_MS         = 50;
+
+namespace {
+
+// Sums per bucket while the log is read
+struct Accumulator {
+    double motion = 0.0;
+    int motionFrames = 0;
+    double sceneScore = 0.0;
+    int videoFrames = 0;
+    int blackFrames = 0;
+    double loudness = 0.0;
+    int audioFrames = 0;
+    QRect crop;
+};
+
+}
+
+bool ComplexityProfile::covers(double startSec, double durationSec) const
+{
+    return !isEmpty()
+           && qAbs(m_startSec - startSec) < 0.05
+           && qAbs(m_rangeSec - durationSec) < 0.05;
+}
+
+double ComplexityProfile::meanMotion(double fromSec, double toSec) const
+{
+    const int first = qMax(0, int((fromSec - m_startSec) / BUCKET_SEC));
+    const int last = qMin(int(m_buckets.size()), int(std::ceil((toSec - m_startSec) / BUCKET_SEC)));
+    if (first >= last)
+        return -1.0;
+
+    double sum = 0.0;
+    for (int i = first; i < last; ++i)
+        sum += m_buckets.at(i).motion;
+    return sum / (last - first);
+}
+
+double ComplexityProfile::silentShare() const
+{
+    if (m_buckets.isEmpty())
+        return 0.0;
+
+    int silent = 0;
+    for (const Bucket &bucket : m_buckets) {
+        if (bucket.loudness <= SILENCE_LUFS)
+            ++silent;
+    }
+    return double(silent) / m_buckets.size();
+}
+
+// ----------------- Build -----------------
+
+ComplexityProfile ComplexityProfile::build(const QString &ffmpegPath,
+                                           const QString &filePath,
+                                           const VideoInfo &source,
+                                           double startSec,
+                                           double durationSec,
+                                           const std::atomic_bool &cancelled,
+                                           QString *error)
+{
+    ComplexityProfile profile;
+    if (ffmpegPath.isEmpty() || source.width <= 0 || durationSec <= 0.0) {
+        if (error)
+            *error = "Nothing to analyze";
+        return profile;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // --- Graph ---
+    // Thinned first, so only the analysed frames are filtered; crop is
+    // measured at full size (it's in source pixels), the rest shrunk.
+    // cropdetect restarts every second, giving one sample per bucket.
+    const int fps = source.fps > 0.0 ? qMin(ANALYSIS_FPS, qMax(1, int(std::lround(source.fps))))
+                                     : ANALYSIS_FPS;
+    const int width = qMin(ANALYSIS_WIDTH, source.width) / 2 * 2;
+    const bool hasAudio = !source.audioCodec.isEmpty();
+
+    QString graph = QString("[0:v]fps=%1,"
+                            "cropdetect=limit=%2:round=2:reset=%1,"
+                            "scale=%3:-2:flags=fast_bilinear,"
+                            "blackframe=amount=%4:threshold=32,"
+                            "select='gte(scene,0)',"
+                            "signalstats,"
+                            "metadata=mode=print[v]")
+                        .arg(fps)
+                        .arg(CROP_BLACK_LIMIT)
+                        .arg(width)
+                        .arg(BLACK_PIXEL_PERCENT);
+    if (hasAudio) {
+        graph += QString(";[0:a:0]aresample=48000,"
+                         "asetnsamples=n=%1:p=0,"
+                         "ebur128=metadata=1,"
+                         "ametadata=mode=print[a]")
+                     .arg(AUDIO_WINDOW_SAMPLES);
+    }
+
+    QStringList args {
+        "-hide_banner", "-nostats",
+        "-loglevel", "info",
+        "-ss", QString::number(startSec, 'f', 3),
+        "-t", QString::number(durationSec, 'f', 3),
+        "-i", filePath,
+        "-filter_complex", graph,
+        "-map", "[v]",
+    };
+    if (hasAudio)
+        args << "-map" << "[a]";
+    args << "-f" << "null" << "-";
+
+    QProcess process;
+    process.setStandardOutputFile(QProcess::nullDevice());
+    process.start(ffmpegPath, args);
+    if (!process.waitForStarted()) {
+        if (error)
+            *error = "Could not start ffmpeg";
+        return profile;
+    }
+
+    // --- Log ---
+    // The metadata filters print each frame as
+    //   [Parsed_metadata_6 @ 0x...] frame:12   pts:12   pts_time:1.2
+    //   [Parsed_metadata_6 @ 0x...] lavfi.scene_score=0.013
+    // with ametadata's lines for the audio in between
+    static const QRegularExpression linePattern(
+        "^\\[Parsed_(a?)metadata_\\d+ @ [^\\]]+\\] (.+)$");
+    static const QRegularExpression ptsPattern("pts_time:(\\S+)");
+
+    const int bucketCount = qMax(1, int(std::ceil(durationSec / BUCKET_SEC)));
+    QList<Accumulator> sums(bucketCount);
+    QList<double> cuts;
+    int lastBucket = -1;
+
+    int videoBucket = -1;
+    int audioBucket = -1;
+    double videoSec = 0.0;
+    double integrated = FLOOR_LUFS;
+    QRect pendingCrop;
+
+    auto bucketAt = [&](double sec) {
+        return qBound(0, int(sec / BUCKET_SEC), bucketCount - 1);
+    };
+
+    auto parseLine = [&](const QString &line) {
+        const QRegularExpressionMatch m = linePattern.match(line);
+        if (!m.hasMatch())
+            return;
+
+        const bool audio = !m.captured(1).isEmpty();
+        const QString body = m.captured(2);
+
+        if (body.startsWith("frame:")) {
+            const QRegularExpressionMatch pts = ptsPattern.match(body);
+            const double sec = pts.hasMatch() ? pts.captured(1).toDouble() : 0.0;
+
+            if (audio) {
+                audioBucket = bucketAt(sec);
+                ++sums[audioBucket].audioFrames;
+            } else {
+                videoSec = sec;
+                videoBucket = bucketAt(sec);
+                ++sums[videoBucket].videoFrames;
+                lastBucket = qMax(lastBucket, videoBucket);
+            }
+            return;
+        }
+
+        const int eq = body.indexOf('=');
+        if (eq <= 0)
+            return;
+
+        const QString key = body.left(eq);
+        const QString value = body.mid(eq + 1).trimmed();
+
+        if (audio) {
+            if (audioBucket < 0)
+                return;
+
+            if (key == "lavfi.r128.M") {
+                // "-inf" before the first 400 ms window fills
+                bool ok = false;
+                const double lufs = value.toDouble(&ok);
+                sums[audioBucket].loudness += ok && std::isfinite(lufs) ? qMax<double>(lufs, FLOOR_LUFS)
+                                                                        : FLOOR_LUFS;
+            } else if (key == "lavfi.r128.I") {
+                bool ok = false;
+                const double lufs = value.toDouble(&ok);
+                if (ok && std::isfinite(lufs))
+                    integrated = qMax<double>(lufs, FLOOR_LUFS);
+            }
+            return;
+        }
+
+        if (videoBucket < 0)
+            return;
+
+        Accumulator &sum = sums[videoBucket];
+        if (key == "lavfi.signalstats.YDIF") {
+            sum.motion += value.toDouble();
+            ++sum.motionFrames;
+        } else if (key == "lavfi.scene_score") {
+            const double score = value.toDouble();
+            sum.sceneScore = qMax(sum.sceneScore, score);
+
+            if (score >= SCENE_CUT_SCORE) {
+                const double at = startSec + videoSec;
+                if (cuts.isEmpty() || at - cuts.last() >= MIN_CUT_GAP_SEC)
+                    cuts << at;
+            }
+        } else if (key == "lavfi.blackframe.pblack") {
+            ++sum.blackFrames;
+        } else if (key.startsWith("lavfi.cropdetect.")) {
+            // The bucket keeps its last frame's rectangle, which covers
+            // the whole second
+            const int v = value.toInt();
+            if (key.endsWith(".w"))
+                pendingCrop.setWidth(v);
+            else if (key.endsWith(".h"))
+                pendingCrop.setHeight(v);
+            else if (key.endsWith(".x"))
+                pendingCrop.moveLeft(v);
+            else if (key.endsWith(".y"))
+                pendingCrop.moveTop(v);
+            sum.crop = pendingCrop;
+        }
+    };
+
+    const qint64 timeoutMs = PROFILE_BASE_TIMEOUT_MS + qint64(durationSec * 2000.0);
+    QByteArray pending;
+
+    auto readLines = [&]() {
+        pending += process.readAllStandardError();
+
+        qsizetype start = 0;
+        qsizetype newline;
+        while ((newline = pending.indexOf('\n', start)) >= 0) {
+            parseLine(QString::fromLocal8Bit(pending.constData() + start, newline - start).trimmed());
+            start = newline + 1;
+        }
+        pending.remove(0, start);
+    };
+
+    while (!process.waitForFinished(PROFILE_POLL_MS)) {
+        readLines();
+
+        if (cancelled.load() || timer.elapsed() >= timeoutMs) {
+            process.kill();
+            process.waitForFinished();
+            if (error)
+                *error = cancelled.load() ? "Cancelled" : "ffmpeg timed out";
+            return profile;
+        }
+    }
+    readLines();
+    if (!pending.isEmpty())
+        parseLine(QString::fromLocal8Bit(pending).trimmed());
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0 || lastBucket < 0) {
+        if (error)
+            *error = "Analysis failed";
+        return profile;
+    }
+
+    // --- Buckets ---
+    QList<QRect> cropSamples;
+
+    profile.m_startSec = startSec;
+    profile.m_rangeSec = durationSec;
+    profile.m_buckets.reserve(lastBucket + 1);
+    for (int i = 0; i <= lastBucket; ++i) {
+        const Accumulator &sum = sums.at(i);
+
+        Bucket bucket;
+        if (sum.motionFrames > 0)
+            bucket.motion = float(sum.motion / sum.motionFrames);
+        bucket.sceneScore = float(sum.sceneScore);
+        if (sum.videoFrames > 0)
+            bucket.blackShare = float(double(sum.blackFrames) / sum.videoFrames);
+        if (sum.audioFrames > 0)
+            bucket.loudness = float(sum.loudness / sum.audioFrames);
+
+        profile.m_buckets << bucket;
+
+        if (!sum.crop.isEmpty())
+            cropSamples << sum.crop;
+    }
+
+    profile.m_sceneCuts = cuts;
+    profile.m_integratedLufs = hasAudio ? integrated : FLOOR_LUFS;
+    profile.m_crop = CropDetector::stableCrop(cropSamples, source.width, source.height);
+
+    qDebug() << "Complexity profile:" << filePath << profile.m_buckets.size() << "s,"
+             << cuts.size() << "cuts," << profile.m_integratedLufs << "LUFS, crop"
+             << profile.m_crop << "in" << timer.elapsed() << "ms";
+
+    return profile;
+}
+
+// ----------------- Serialization -----------------
+
+QByteArray ComplexityProfile::serialize() const
+{
+    QByteArray raw;
+    QDataStream out(&raw, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << m_startSec << m_rangeSec << m_integratedLufs << m_crop;
+
+    // About six bytes a second
+    out << quint32(m_buckets.size());
+    for (const Bucket &bucket : m_buckets) {
+        out << quint16(qBound(0.0f, bucket.motion * 100.0f, 65535.0f))
+            << quint8(qBound(0.0f, bucket.sceneScore * 255.0f, 255.0f))
+            << quint8(qBound(0.0f, bucket.blackShare * 255.0f, 255.0f))
+            << qint16(bucket.loudness * 100.0f);
+    }
+
+    out << quint32(m_sceneCuts.size());
+    for (double cut : m_sceneCuts)
+        out << quint32(qMax(0.0, (cut - m_startSec) * 1000.0));
+
+    return qCompress(raw);
+}
+
+bool ComplexityProfile::deserialize(const QByteArray &data, ComplexityProfile &profile)
+{
+    const QByteArray raw = qUncompress(data);
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    ComplexityProfile p;
+    quint32 count = 0;
+    in >> p.m_startSec >> p.m_rangeSec >> p.m_integratedLufs >> p.m_crop >> count;
+    if (in.status() != QDataStream::Ok || count > quint32(raw.size()))
+        return false;
+
+    p.m_buckets.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        quint16 motion = 0;
+        quint8 scene = 0, black = 0;
+        qint16 loudness = 0;
+        in >> motion >> scene >> black >> loudness;
+
+        Bucket bucket;
+        bucket.motion = motion / 100.0f;
+        bucket.sceneScore = scene / 255.0f;
+        bucket.blackShare = black / 255.0f;
+        bucket.loudness = loudness / 100.0f;
+        p.m_buckets << bucket;
+    }
+
+    in >> count;
+    if (in.status() != QDataStream::Ok || count > quint32(raw.size()))
+        return false;
+
+    for (quint32 i = 0; i < count; ++i) {
+        quint32 ms = 0;
+        in >> ms;
+        p.m_sceneCuts << p.m_startSec + ms / 1000.0;
+    }
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    profile = p;
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef COMPLEXITYPROFILE_H
+#define COMPLEXITYPROFILE_H
+
+#include <QList>
+#include <QString>
+#include <QByteArray>
+#include <QRect>
+
+#include <atomic>
+
+#include "videoinfo.h"
+
+// What happens in a clip, second by second: how much the picture moves,
+// where the scenes cut, which stretches are black or silent and how loud
+// the audio is, plus the black bars around the picture.
+//
+// Built from a single decode of the range: the video is thinned to a few
+// frames per second and shrunk right after decoding, and one FFmpeg
+// filter graph feeds cropdetect, blackframe, the scene score and
+// signalstats from it, next to ebur128 on the audio. Whatever later
+// wants to know about the content reads the profile instead of decoding
+// the source again.
+class ComplexityProfile
+{
+public:
+    // ebur128's floor: what silence and a clip without audio read
+    static constexpr float FLOOR_LUFS = -70.0f;
+
+    // Quieter than this counts as silent
+    static constexpr float SILENCE_LUFS = -50.0f;
+
+    static constexpr double BUCKET_SEC = 1.0;
+
+    struct Bucket {
+        float motion = 0.0f;         // mean luma change between frames, 0-255
+        float sceneScore = 0.0f;     // highest scene change score, 0-1
+        float blackShare = 0.0f;     // share of frames that are black
+        float loudness = FLOOR_LUFS; // mean momentary loudness
+    };
+
+    ComplexityProfile() = default;
+
+    // Blocking; polls `cancelled` while it works
+    static ComplexityProfile build(const QString &ffmpegPath,
+                                   const QString &filePath,
+                                   const VideoInfo &source,
+                                   double startSec,
+                                   double durationSec,
+                                   const std::atomic_bool &cancelled,
+                                   QString *error = nullptr);
+
+    bool isEmpty() const { return m_buckets.isEmpty(); }
+
+    // Bucket i covers BUCKET_SEC from startSec() + i * BUCKET_SEC, in
+    // source time
+    double startSec() const { return m_startSec; }
+    double rangeSec() const { return m_rangeSec; }
+    const QList<Bucket> &buckets() const { return m_buckets; }
+
+    // Whether the profile was made for this range (to a tenth of a second)
+    bool covers(double startSec, double durationSec) const;
+
+    // Source times of the scene cuts, sorted
+    const QList<double> &sceneCuts() const { return m_sceneCuts; }
+
+    // Mean motion over [fromSec, toSec); -1 outside the profile
+    double meanMotion(double fromSec, double toSec) const;
+
+    // Share of the buckets that are silent
+    double silentShare() const;
+
+    // EBU R128 integrated loudness of the range; FLOOR_LUFS without audio
+    double integratedLoudness() const { return m_integratedLufs; }
+
+    // The bars around the picture, as CropDetector::stableCrop sees the
+    // per-second samples; empty when there's nothing worth cropping
+    QRect crop() const { return m_crop; }
+
+    // Fixed point per bucket, then zlib
+    QByteArray serialize() const;
+    static bool deserialize(const QByteArray &data, ComplexityProfile &profile);
+
+private:
+    double m_startSec = 0.0;
+    double m_rangeSec = 0.0;
+    QList<Bucket> m_buckets;
+    QList<double> m_sceneCuts;
+    double m_integratedLufs = FLOOR_LUFS;
+    QRect m_crop;
+};
+
+#endif // COMPLEXITYPROFILE_H
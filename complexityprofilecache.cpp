@@ -0,0 +1,130 @@
+#include "complexityprofilecache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QDebug>
+
+static constexpr quint32 PROFILE_MAGIC   = 0x43324443; // "C2DC"
+static constexpr quint32 PROFILE_VERSION = 1;
+
+static constexpr int PRUNE_INTERVAL = 16;
+
+ComplexityProfileCache::ComplexityProfileCache(const QString &directory, int maxEntries)
+    : m_directory(directory)
+    , m_maxEntries(qMax(1, maxEntries))
+{
+    if (m_directory.isEmpty()) {
+        m_directory =
+            QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + "/profiles";
+    }
+
+    QDir().mkpath(m_directory);
+}
+
+QString ComplexityProfileCache::entryPath(const QString &canonicalPath,
+                                          double startSec,
+                                          double durationSec) const
+{
+    // Ranges to the tenth of a second, as ComplexityProfile::covers compares them
+    const QString key = QString("%1|%2|%3")
+                            .arg(canonicalPath)
+                            .arg(startSec, 0, 'f', 1)
+                            .arg(durationSec, 0, 'f', 1);
+    const QByteArray name =
+        QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_directory + "/" + QString::fromLatin1(name) + ".prof";
+}
+
+bool ComplexityProfileCache::lookup(const FileIdentity &id,
+                                    double startSec,
+                                    double durationSec,
+                                    ComplexityProfile &profile)
+{
+    if (!id.isValid())
+        return false;
+
+    const QString path = entryPath(id.canonicalPath, startSec, durationSec);
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != PROFILE_MAGIC || version != PROFILE_VERSION)
+        return false;
+
+    FileIdentity stored;
+    QByteArray data;
+    in >> stored.canonicalPath >> stored.size >> stored.mtimeMs >> stored.sampleHash
+       >> data;
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    if (stored != id) {
+        // Same path, different file: stale
+        file.close();
+        QFile::remove(path);
+        return false;
+    }
+
+    return ComplexityProfile::deserialize(data, profile)
+           && profile.covers(startSec, durationSec);
+}
+
+void ComplexityProfileCache::store(const FileIdentity &id, const ComplexityProfile &profile)
+{
+    if (!id.isValid() || profile.isEmpty())
+        return;
+
+    const QByteArray data = profile.serialize();
+
+    QSaveFile file(entryPath(id.canonicalPath, profile.startSec(), profile.rangeSec()));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Complexity profile cache: cannot write" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << PROFILE_MAGIC << PROFILE_VERSION;
+    out << id.canonicalPath << id.size << id.mtimeMs << id.sampleHash;
+    out << data;
+
+    if (!file.commit())
+        qDebug() << "Complexity profile cache: commit failed for" << file.fileName();
+
+    QMutexLocker lock(&m_mutex);
+    if (++m_storesSincePrune >= PRUNE_INTERVAL) {
+        m_storesSincePrune = 0;
+        prune();
+    }
+}
+
+void ComplexityProfileCache::prune()
+{
+    QDir dir(m_directory);
+    QFileInfoList entries =
+        dir.entryInfoList({"*.prof"}, QDir::Files, QDir::Time | QDir::Reversed);
+
+    const int excess = entries.size() - m_maxEntries;
+    if (excess <= 0)
+        return;
+
+    for (int i = 0; i < excess; ++i)
+        QFile::remove(entries.at(i).absoluteFilePath());
+
+    qDebug() << "Complexity profile cache: evicted" << excess << "entries";
+}
@@ -0,0 +1,39 @@
+#ifndef COMPLEXITYPROFILECACHE_H
+#define COMPLEXITYPROFILECACHE_H
+
+#include <QString>
+#include <QMutex>
+
+#include "complexityprofile.h"
+#include "fileidentity.h"
+
+// On-disk store of ComplexityProfile data, one file per source path and
+// range, so going back to a range that was analysed before is free.
+//
+// Same rules as KeyframeIndexCache: entries are validated against the
+// full FileIdentity, replaced atomically and evicted oldest first.
+// Thread-safe.
+class ComplexityProfileCache
+{
+public:
+    explicit ComplexityProfileCache(const QString &directory = QString(),
+                                    int maxEntries = 256);
+
+    bool lookup(const FileIdentity &id, double startSec, double durationSec,
+                ComplexityProfile &profile);
+    void store(const FileIdentity &id, const ComplexityProfile &profile);
+
+    QString directory() const { return m_directory; }
+
+private:
+    QString entryPath(const QString &canonicalPath, double startSec, double durationSec) const;
+    void prune();
+
+    QString m_directory;
+    int m_maxEntries;
+
+    QMutex m_mutex;
+    int m_storesSincePrune = 0;
+};
+
+#endif // COMPLEXITYPROFILECACHE_H
@@ -0,0 +1,237 @@
+#include "cropdetector.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <memory>
+#include <vector>
+
+// The trim marks move in steps; only the range that sticks is sampled
+static constexpr int DEBOUNCE_MS = 400;
+
+// Enough samples that one dark scene can't decide, each only a couple
+// of keyframes long
+static constexpr int    SAMPLE_COUNT       = 8;
+static constexpr int    SAMPLE_FRAMES      = 2;
+
+// cropdetect reports nothing for its first frames (its "skip" option,
+// 2 and fixed in older builds); those are decoded on top of the sample
+static constexpr int    CROPDETECT_SKIP    = 2;
+static constexpr int    DETECT_TIMEOUT_MS  = 20000;
+static constexpr int    DETECT_POLL_MS     = 50;
+
+// cropdetect's black threshold (of 255) and the least a sample must
+// keep to count as having seen a picture
+static constexpr int    BLACK_LIMIT        = 24;
+static constexpr double MIN_PICTURE_SHARE  = 0.25;
+
+// Bars thinner than this aren't worth a crop (and may be encoder noise)
+static constexpr double MIN_SAVED_SHARE    = 0.03;
+
+static constexpr int MAX_CACHE_ENTRIES = 64;
+
+CropDetector::CropDetector(QObject *parent)
+    : QObject(parent)
+    , m_debounce(new QTimer(this))
+{
+    m_debounce->setSingleShot(true);
+    m_debounce->setInterval(DEBOUNCE_MS);
+    connect(m_debounce, &QTimer::timeout, this, &CropDetector::startDetection);
+}
+
+CropDetector::~CropDetector()
+{
+    cancel();
+}
+
+bool CropDetector::isRunning() const
+{
+    return m_debounce->isActive() || (m_watcher && m_watcher->isRunning());
+}
+
+QString CropDetector::cacheKey(const Request &request)
+{
+    return QStringList {
+        request.filePath,
+        QString::number(request.startSec, 'f', 1),
+        QString::number(request.durationSec, 'f', 1),
+    }.join('|');
+}
+
+void CropDetector::detect(const QString &filePath, const VideoInfo &source,
+                          double startSec, double durationSec)
+{
+    cancel();
+
+    m_request = { filePath, source, startSec, durationSec };
+
+    const auto cached = m_cache.constFind(cacheKey(m_request));
+    if (cached != m_cache.cend()) {
+        const QRect crop = *cached;
+        QTimer::singleShot(0, this, [this, filePath, crop]() {
+            emit detected(filePath, crop);
+        });
+        return;
+    }
+
+    m_debounce->start();
+}
+
+void CropDetector::cancel()
+{
+    m_debounce->stop();
+
+    if (m_cancelFlag)
+        m_cancelFlag->store(true);
+    m_cancelFlag.reset();
+
+    if (m_watcher) {
+        m_watcher->disconnect(this);
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+    }
+}
+
+void CropDetector::startDetection()
+{
+    if (m_ffmpegPath.isEmpty() || m_request.durationSec <= 0.0)
+        return;
+
+    const Request request = m_request;
+    m_cancelFlag = std::make_shared<std::atomic_bool>(false);
+    m_watcher = new QFutureWatcher<QRect>(this);
+
+    QFutureWatcher<QRect> *watcher = m_watcher;
+    connect(watcher, &QFutureWatcher<QRect>::finished,
+            this, [this, watcher, request]() {
+                if (watcher != m_watcher)
+                    return;
+
+                const QRect crop = watcher->result();
+
+                m_watcher->deleteLater();
+                m_watcher = nullptr;
+                m_cancelFlag.reset();
+
+                if (m_cache.size() >= MAX_CACHE_ENTRIES)
+                    m_cache.clear();
+                m_cache.insert(cacheKey(request), crop);
+
+                emit detected(request.filePath, crop);
+            });
+
+    const CancelFlag flag = m_cancelFlag;
+    const QString ffmpegPath = m_ffmpegPath;
+    watcher->setFuture(QtConcurrent::run([ffmpegPath, request, flag]() {
+        return detectBlocking(ffmpegPath, request.filePath, request.source,
+                              request.startSec, request.durationSec, *flag);
+    }));
+}
+
+// ----------------- Worker -----------------
+
+QRect CropDetector::detectBlocking(const QString &ffmpegPath,
+                                   const QString &filePath,
+                                   const VideoInfo &source,
+                                   double startSec,
+                                   double durationSec,
+                                   const std::atomic_bool &cancelled)
+{
+    if (ffmpegPath.isEmpty() || source.width <= 0 || source.height <= 0 || durationSec <= 0.0)
+        return QRect();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // One keyframe-only decoder thread per sample; the samples are the
+    // parallelism
+    std::vector<std::unique_ptr<QProcess>> processes;
+    for (int i = 0; i < SAMPLE_COUNT; ++i) {
+        const double at = startSec + durationSec * (i + 0.5) / SAMPLE_COUNT;
+
+        auto process = std::make_unique<QProcess>();
+        process->setStandardOutputFile(QProcess::nullDevice());
+        process->start(ffmpegPath, {
+            "-hide_banner", "-nostats",
+            "-skip_frame", "nokey",
+            "-threads", "1",
+            "-ss", QString::number(at, 'f', 3),
+            "-i", filePath,
+            "-an", "-sn", "-dn",
+            "-frames:v", QString::number(CROPDETECT_SKIP + SAMPLE_FRAMES),
+            "-vf", QString("cropdetect=limit=%1:round=2:reset=0").arg(BLACK_LIMIT),
+            "-f", "null", "-",
+        });
+        processes.push_back(std::move(process));
+    }
+
+    // cropdetect logs "... crop=1920:800:0:140" per frame past the
+    // skipped ones; with reset=0 the last line covers all of those
+    static const QRegularExpression cropPattern("crop=(\\d+):(\\d+):(\\d+):(\\d+)");
+
+    QList<QRect> samples;
+    for (const auto &process : processes) {
+        while (!process->waitForFinished(DETECT_POLL_MS)) {
+            if (cancelled.load() || timer.elapsed() > DETECT_TIMEOUT_MS) {
+                for (const auto &p : processes) {
+                    p->kill();
+                    p->waitForFinished();
+                }
+                return QRect();
+            }
+        }
+
+        const QString log = QString::fromLocal8Bit(process->readAllStandardError());
+        QRegularExpressionMatch last;
+        auto it = cropPattern.globalMatch(log);
+        while (it.hasNext())
+            last = it.next();
+
+        if (last.hasMatch()) {
+            samples << QRect(last.captured(3).toInt(), last.captured(4).toInt(),
+                             last.captured(1).toInt(), last.captured(2).toInt());
+        }
+    }
+
+    const QRect crop = stableCrop(samples, source.width, source.height);
+    qDebug() << "Crop detection:" << filePath << samples.size() << "sample(s) ->"
+             << crop << "in" << timer.elapsed() << "ms";
+    return crop;
+}
+
+QRect CropDetector::stableCrop(const QList<QRect> &samples, int width, int height)
+{
+    const QRect frame(0, 0, width, height);
+
+    QRect picture;
+    int usable = 0;
+    for (const QRect &sample : samples) {
+        // An all-black frame comes back tiny or inverted
+        const QRect r = sample.intersected(frame);
+        if (r.width() < width * MIN_PICTURE_SHARE || r.height() < height * MIN_PICTURE_SHARE)
+            continue;
+
+        picture = picture.isNull() ? r : picture.united(r);
+        ++usable;
+    }
+
+    if (picture.isNull() || usable * 2 < samples.size())
+        return QRect();
+
+    // Even edges, widened rather than narrowed so no picture is lost
+    const int left = picture.left() & ~1;
+    const int top = picture.top() & ~1;
+    const int right = qMin(width, (picture.right() + 2) & ~1);
+    const int bottom = qMin(height, (picture.bottom() + 2) & ~1);
+    const QRect crop(left, top, right - left, bottom - top);
+
+    const double saved = 1.0 - double(crop.width()) * crop.height() / (double(width) * height);
+    if (saved < MIN_SAVED_SHARE)
+        return QRect();
+
+    return crop;
+}
@@ -0,0 +1,81 @@
+#ifndef CROPDETECTOR_H
+#define CROPDETECTOR_H
+
+#include <QObject>
+#include <QString>
+#include <QRect>
+#include <QList>
+#include <QHash>
+#include <QFutureWatcher>
+
+#include <atomic>
+#include <memory>
+
+#include "videoinfo.h"
+
+class QTimer;
+
+// Finds letterbox and pillarbox bars in the background.
+//
+// FFmpeg's cropdetect runs on a handful of short samples spread over the
+// range, side by side, decoding keyframes only. The proposal is the
+// smallest rectangle that holds every sample's picture, so a dark scene
+// can't crop into the image, and it's only made when the bars are worth
+// removing. Requests are debounced like the size prediction (the trim
+// marks move in steps), and results are kept per file and range.
+class CropDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CropDetector(QObject *parent = nullptr);
+    ~CropDetector();
+
+    void setFfmpegPath(const QString &path) { m_ffmpegPath = path; }
+
+    void detect(const QString &filePath, const VideoInfo &source,
+                double startSec, double durationSec);
+    void cancel();
+
+    bool isRunning() const;
+
+    // Blocking; polls `cancelled`. Empty when there's nothing to crop.
+    static QRect detectBlocking(const QString &ffmpegPath,
+                                const QString &filePath,
+                                const VideoInfo &source,
+                                double startSec,
+                                double durationSec,
+                                const std::atomic_bool &cancelled);
+
+    // One rectangle for all samples: their union, aligned to even
+    // pixels; empty when too few samples saw a picture or the bars are
+    // too thin to matter
+    static QRect stableCrop(const QList<QRect> &samples, int width, int height);
+
+signals:
+    void detected(const QString &filePath, const QRect &crop);
+
+private:
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+
+    struct Request {
+        QString filePath;
+        VideoInfo source;
+        double startSec = 0.0;
+        double durationSec = 0.0;
+    };
+
+    static QString cacheKey(const Request &request);
+    void startDetection();
+
+    QString m_ffmpegPath;
+    Request m_request;
+
+    QTimer *m_debounce = nullptr;
+    CancelFlag m_cancelFlag;
+    QFutureWatcher<QRect> *m_watcher = nullptr;
+
+    QHash<QString, QRect> m_cache;
+};
+
+#endif // CROPDETECTOR_H
@@ -0,0 +1,259 @@
+#include "denoiser.h"
+#include "encodercaps.h"
+#include "filtergraph.h"
+#include "presettuner.h"
+
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QSysInfo>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <memory>
+#include <vector>
+
+// A few short runs of consecutive frames, so hqdn3d's temporal part
+// has something to work with
+static constexpr int SAMPLE_COUNT      = 4;
+static constexpr int SAMPLE_FRAMES     = 8;
+static constexpr int MEASURE_TIMEOUT_MS = 20000;
+static constexpr int MEASURE_POLL_MS    = 50;
+
+// Identical frames read "inf"
+static constexpr double CLEAN_PSNR = 99.0;
+
+// Below these, hqdn3d takes away enough to be worth it (dB). Rough;
+// benchmarks/denoisebench measures what they buy.
+static constexpr double MEDIUM_NOISE_PSNR = 37.0;
+static constexpr double LIGHT_NOISE_PSNR  = 42.0;
+
+// Bits per pixel (H.264-equivalent) under which noise competes with
+// the picture for bits; above it, denoising would only blur
+static constexpr double TIGHT_BITS_PER_PIXEL = 0.08;
+
+// Denoising may add at most this share of the encode's own time
+static constexpr double MAX_COST_SHARE = 1.0;
+
+static constexpr int CALIBRATION_FRAMES     = 60;
+static constexpr int CALIBRATION_PIXELS     = 1920 * 1080;
+static constexpr int CALIBRATION_TIMEOUT_MS = 30000;
+
+QString Denoiser::calibrationKey(const QString &level)
+{
+    // Per machine, like the x264 calibration
+    return QString("denoiseCalibration/%1-%2/%3")
+        .arg(QSysInfo::machineHostName())
+        .arg(QThread::idealThreadCount())
+        .arg(level);
+}
+
+double Denoiser::calibratedMpps(const QString &level)
+{
+    return QSettings().value(calibrationKey(level), 0.0).toDouble();
+}
+
+// ----------------- Calibration -----------------
+
+double Denoiser::calibrate(const QString &ffmpegPath, const QString &level)
+{
+    const QString filter = FilterGraph::denoiser(level);
+    if (ffmpegPath.isEmpty() || filter.isEmpty())
+        return 0.0;
+
+    // The same synthetic 1080p with and without hqdn3d; the difference
+    // is hqdn3d's
+    auto timedRun = [&](const QString &vf) -> qint64 {
+        QElapsedTimer timer;
+        timer.start();
+
+        QProcess process;
+        process.start(ffmpegPath, {
+            "-hide_banner", "-loglevel", "error",
+            "-f", "lavfi", "-i", "testsrc2=size=1920x1080:rate=30",
+            "-frames:v", QString::number(CALIBRATION_FRAMES),
+            "-vf", vf,
+            "-f", "null", "-",
+        });
+        if (!process.waitForFinished(CALIBRATION_TIMEOUT_MS)) {
+            process.kill();
+            process.waitForFinished();
+            return -1;
+        }
+        if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+            return -1;
+
+        return timer.elapsed();
+    };
+
+    const qint64 baseMs = timedRun("null");
+    const qint64 filteredMs = timedRun(filter);
+    if (baseMs < 0 || filteredMs < 0)
+        return 0.0;
+
+    const double costSec = qMax<qint64>(1, filteredMs - baseMs) / 1000.0;
+    const double mpps = CALIBRATION_FRAMES * double(CALIBRATION_PIXELS) / 1e6 / costSec;
+
+    qDebug() << "Denoise calibration:" << level << mpps << "megapixels/s";
+
+    QSettings().setValue(calibrationKey(level), mpps);
+    return mpps;
+}
+
+// ----------------- Measurement -----------------
+
+NoiseMeasurement Denoiser::measure(const QString &ffmpegPath,
+                                   const QString &filePath,
+                                   const VideoInfo &source,
+                                   double startSec,
+                                   double durationSec,
+                                   const std::atomic_bool &cancelled)
+{
+    NoiseMeasurement noise;
+    if (ffmpegPath.isEmpty() || source.width <= 0 || durationSec <= 0.0)
+        return noise;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The strongest level's difference; "light" takes away about half
+    const QString graph =
+        QString("[0:v]split[a][b];[b]%1[d];[a][d]psnr").arg(FilterGraph::denoiser("medium"));
+
+    // One thread per sample; the samples are the parallelism
+    std::vector<std::unique_ptr<QProcess>> processes;
+    for (int i = 0; i < SAMPLE_COUNT; ++i) {
+        const double at = startSec + durationSec * (i + 0.5) / SAMPLE_COUNT;
+
+        auto process = std::make_unique<QProcess>();
+        process->setStandardOutputFile(QProcess::nullDevice());
+        process->start(ffmpegPath, {
+            "-hide_banner", "-nostats",
+            "-threads", "1",
+            "-ss", QString::number(at, 'f', 3),
+            "-i", filePath,
+            "-an", "-sn", "-dn",
+            "-filter_complex", graph,
+            "-frames:v", QString::number(SAMPLE_FRAMES),
+            "-f", "null", "-",
+        });
+        processes.push_back(std::move(process));
+    }
+
+    // psnr ends with "PSNR y:38.12 u:... average:... min:... max:..."
+    static const QRegularExpression psnrPattern("PSNR y:(inf|[0-9.]+)");
+
+    double sum = 0.0;
+    for (const auto &process : processes) {
+        while (!process->waitForFinished(MEASURE_POLL_MS)) {
+            if (cancelled.load() || timer.elapsed() > MEASURE_TIMEOUT_MS) {
+                for (const auto &p : processes) {
+                    p->kill();
+                    p->waitForFinished();
+                }
+                return noise;
+            }
+        }
+
+        const QRegularExpressionMatch m =
+            psnrPattern.match(QString::fromLocal8Bit(process->readAllStandardError()));
+        if (!m.hasMatch())
+            continue;
+
+        sum += m.captured(1) == "inf" ? CLEAN_PSNR : qMin(CLEAN_PSNR, m.captured(1).toDouble());
+        ++noise.samples;
+    }
+
+    if (noise.samples > 0)
+        noise.psnrY = sum / noise.samples;
+
+    // Once per machine
+    noise.lightMpps = calibratedMpps("light");
+    if (noise.lightMpps <= 0.0 && !cancelled.load())
+        noise.lightMpps = calibrate(ffmpegPath, "light");
+
+    noise.mediumMpps = calibratedMpps("medium");
+    if (noise.mediumMpps <= 0.0 && !cancelled.load())
+        noise.mediumMpps = calibrate(ffmpegPath, "medium");
+
+    qDebug() << "Noise measurement:" << filePath << noise.samples << "sample(s), PSNR y"
+             << noise.psnrY << "in" << timer.elapsed() << "ms";
+    return noise;
+}
+
+// ----------------- Selection -----------------
+
+double Denoiser::estimatedEncodeSeconds(const EncodePlan &plan, const EncoderCaps &caps)
+{
+    const VideoEncoderSpec &spec = EncodePlanner::videoEncoder(plan.settings.videoEncoder);
+
+    // The clip's own calibration, if there is one
+    if (spec.encoder == "libx264") {
+        const double fastFps = PresetTuner::calibratedFps(plan.outWidth, plan.outHeight);
+
+        double relativeSpeed = 1.0;
+        for (const X264Preset &preset : EncodePlanner::x264Presets()) {
+            if (preset.name == plan.settings.x264Preset)
+                relativeSpeed = preset.relativeSpeed;
+        }
+
+        if (fastFps > 0.0)
+            return PresetTuner::estimatedSeconds(plan, fastFps * relativeSpeed);
+    }
+
+    const double speed = caps.estimatedSpeed(spec.encoder, plan);
+    return speed > 0.0 ? plan.durationSec / speed : 0.0;
+}
+
+QString Denoiser::chooseLevel(const EncodePlan &plan,
+                              const NoiseMeasurement &noise,
+                              double encodeSec)
+{
+    if (plan.copyVideo || plan.smartCut || !noise.isValid()
+        || plan.outWidth <= 0 || plan.outHeight <= 0 || plan.fps <= 0 || plan.durationSec <= 0.0)
+        return QString();
+
+    // --- Bits ---
+    const VideoEncoderSpec &spec = EncodePlanner::videoEncoder(plan.settings.videoEncoder);
+    const double bitsPerPixel = plan.videoBitrateKbps * 1000.0
+                                / (double(plan.outWidth) * plan.outHeight * plan.fps)
+                                / spec.relativeBits;
+    if (bitsPerPixel >= TIGHT_BITS_PER_PIXEL)
+        return QString();
+
+    // --- Noise ---
+    QString level;
+    if (noise.psnrY < MEDIUM_NOISE_PSNR)
+        level = "medium";
+    else if (noise.psnrY < LIGHT_NOISE_PSNR)
+        level = "light";
+    else
+        return QString();
+
+    // --- Cost ---
+    // hqdn3d sees the cropped picture after the frame rate drop (before
+    // the split, with tiers)
+    const QRect crop = plan.settings.crop;
+    const double pixels = crop.isEmpty() ? double(plan.source.width) * plan.source.height
+                                         : double(crop.width()) * crop.height();
+    const double fps = plan.tiers.isEmpty() ? plan.fps : qMax(double(plan.fps), plan.source.fps);
+    const double megapixels = plan.durationSec * fps * pixels / 1e6;
+    const double budgetSec = (encodeSec > 0.0 ? encodeSec : plan.durationSec) * MAX_COST_SHARE;
+
+    while (!level.isEmpty()) {
+        const double mpps = level == "medium" ? noise.mediumMpps : noise.lightMpps;
+        const double costSec = mpps > 0.0 ? megapixels / mpps : 0.0;
+
+        if (mpps > 0.0 && costSec <= budgetSec) {
+            qDebug() << "Denoise:" << level << "at" << bitsPerPixel << "bits/pixel, PSNR y"
+                     << noise.psnrY << "~" << costSec << "s of" << budgetSec << "s budget";
+            return level;
+        }
+
+        level = level == "medium" ? QString("light") : QString();
+    }
+
+    qDebug() << "Denoise: too slow for the encode's budget";
+    return QString();
+}
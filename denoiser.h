@@ -0,0 +1,60 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <QString>
+
+#include <atomic>
+
+#include "encodeplan.h"
+#include "videoinfo.h"
+
+class EncoderCaps;
+
+// How noisy a source is, and what hqdn3d costs on this machine
+struct NoiseMeasurement {
+    double psnrY = 0.0;              // sampled frames against their denoised selves; 0 = unknown
+    int samples = 0;
+    double lightMpps = 0.0;          // hqdn3d throughput, megapixels per second
+    double mediumMpps = 0.0;
+
+    bool isValid() const { return psnrY > 0.0; }
+};
+
+// Decides whether a denoiser runs ahead of the scaler, and how strong.
+//
+// Grain and sensor noise cost bits without being worth any, which only
+// matters when bits are short: the planner's bitrate must be tight for
+// the picture it carries, and the source must be noisy. Noise is read
+// off a few short samples spread over the range, side by side, as the
+// PSNR between each frame and its hqdn3d'd copy; a clean source barely
+// changes. The strength is then stepped down until hqdn3d's cost, known
+// from a one-off calibration kept in QSettings, stays within the
+// encode's own, so denoising never more than doubles the encode time.
+// Measuring blocks; run it off the GUI thread.
+class Denoiser
+{
+public:
+    // Samples the range, calibrates hqdn3d if this machine hasn't yet
+    static NoiseMeasurement measure(const QString &ffmpegPath,
+                                    const QString &filePath,
+                                    const VideoInfo &source,
+                                    double startSec,
+                                    double durationSec,
+                                    const std::atomic_bool &cancelled);
+
+    // Expected encode time without denoising; 0 when nothing is known
+    static double estimatedEncodeSeconds(const EncodePlan &plan, const EncoderCaps &caps);
+
+    // "medium", "light" or empty for none (see FilterGraph::denoiser).
+    // encodeSec 0 = assume real time.
+    static QString chooseLevel(const EncodePlan &plan,
+                               const NoiseMeasurement &noise,
+                               double encodeSec);
+
+private:
+    static double calibratedMpps(const QString &level);
+    static double calibrate(const QString &ffmpegPath, const QString &level);
+    static QString calibrationKey(const QString &level);
+};
+
+#endif // DENOISER_H
@@ -0,0 +1,1243 @@
+#include "encodeplan.h"
+#include "filtergraph.h"
+
+#include <QtGlobal>
+#include <QDir>
+#include <QFileInfo>
+#include <QSize>
+#include <QThread>
+#include <QUuid>
+
+// Parallel segments only pay off on long encodes with cores to spare
+static constexpr double SEGMENT_MIN_DURATION_SEC = 60.0;
+static constexpr double SEGMENT_MIN_LENGTH_SEC   = 15.0;
+static constexpr int    THREADS_PER_SEGMENT      = 4;
+static constexpr int    MAX_SEGMENTS             = 16;
+
+// Target-size mode aims this far under the budget; two-pass x264 lands
+// within about a percent of its bitrate. A retry after an overshoot
+// aims a bit lower again.
+static constexpr double TARGET_SIZE_FILL    = 0.98;
+static constexpr double RETRY_CORRECTION    = 0.97;
+static constexpr int    MIN_VIDEO_KBPS      = 100;
+
+// MP4 index cost: fixed boxes plus sample table entries (stsz, stts,
+// ctts, stco) per frame; AAC has 1024 samples per frame at up to 48 kHz
+static constexpr qint64 MP4_FIXED_OVERHEAD_BYTES  = 4096;
+static constexpr int    MP4_BYTES_PER_VIDEO_FRAME = 12;
+static constexpr int    MP4_BYTES_PER_AUDIO_FRAME = 8;
+static constexpr double AAC_FRAMES_PER_SEC        = 48000.0 / 1024.0;
+
+// MPEG-TS pieces carry packet and PES headers the joined MP4 doesn't
+static constexpr double MPEG_TS_OVERHEAD = 1.03;
+
+// Added to a keyframe's timestamp when seeking for a stream copy, so
+// rounding can't land the seek on the keyframe before it
+static constexpr double KEYFRAME_SEEK_EPSILON_SEC = 0.0005;
+
+// Relative cost of steps that don't encode video
+static constexpr double AUDIO_STEP_COST  = 0.05;
+static constexpr double REMUX_STEP_COST  = 0.02;
+
+// x264's and libvpx's first passes run with fast settings
+static constexpr double FIRST_PASS_COST  = 0.4;
+
+// Decoded picture buffer of H.264 level 4.1 in macroblocks, which caps
+// the reference frames hardware decoders accept (4 at 1080p, 9 at 720p)
+static constexpr int LEVEL_41_MAX_DPB_MBS = 32768;
+static constexpr int MAX_REFS             = 16;
+
+// Lookahead past a couple of seconds buys nothing on short clips
+static constexpr int LOOKAHEAD_SEC = 2;
+
+static QString seconds(double sec)
+{
+    return QString::number(sec, 'f', 6);
+}
+
+static QStringList progressArguments()
+{
+    return {
+        "-progress", "pipe:1",
+        "-nostats",
+        "-loglevel", "error",
+    };
+}
+
+static const VideoEncoderSpec &encoderOf(const EncodePlan &plan)
+{
+    return EncodePlanner::videoEncoder(plan.settings.videoEncoder);
+}
+
+static bool toneMaps(const EncodePlan &plan)
+{
+    return plan.settings.toneMapHdr && plan.source.isHdr();
+}
+
+// The budgeted x264 preset, with lookahead and references that suit
+// the output format
+static QStringList x264PresetArguments(const QString &name, int width, int height, int fps)
+{
+    X264Preset preset;
+    for (const X264Preset &p : EncodePlanner::x264Presets()) {
+        if (p.name == name)
+            preset = p;
+    }
+    if (preset.name.isEmpty())
+        return { "-preset", "fast" };
+
+    const int macroblocks = qMax(1, ((width + 15) / 16) * ((height + 15) / 16));
+    const int refs = qBound(1, qMin(preset.refs, LEVEL_41_MAX_DPB_MBS / macroblocks), MAX_REFS);
+    const int lookahead = qMin(preset.lookahead, qMax(1, fps) * LOOKAHEAD_SEC);
+
+    return {
+        "-preset", preset.name,
+        "-rc-lookahead", QString::number(lookahead),
+        "-refs", QString::number(refs),
+    };
+}
+
+// -c:v and rate control for one output format, without the filters
+static QStringList encoderArguments(const EncodePlan &plan,
+                                    int videoBitrateKbps,
+                                    int width,
+                                    int height,
+                                    int fps)
+{
+    const VideoEncoderSpec &spec = encoderOf(plan);
+    const QString videoBitrateArg = QString::number(videoBitrateKbps) + "k";
+
+    QStringList args { "-c:v", spec.encoder };
+    if (spec.encoder == "libx264" && !plan.settings.x264Preset.isEmpty())
+        args << x264PresetArguments(plan.settings.x264Preset, width, height, fps);
+    else
+        args << spec.options;
+
+    args << "-b:v" << videoBitrateArg;
+
+    // Two-pass hits the average on its own; a VBV cap would only take
+    // bits away from the scenes the first pass found hard
+    if (!plan.twoPass && spec.vbvCap) {
+        args << "-maxrate" << videoBitrateArg
+             << "-bufsize" << QString::number(videoBitrateKbps * 2) + "k";
+    }
+
+    if (!spec.tag.isEmpty())
+        args << "-tag:v" << spec.tag;
+
+    // Tagged, or players would read the tone-mapped picture as the
+    // source's BT.2020
+    if (toneMaps(plan)) {
+        args << "-color_primaries" << "bt709"
+             << "-color_trc" << "bt709"
+             << "-colorspace" << "bt709";
+    }
+
+    return args;
+}
+
+// The source's picture turned into one output format
+static VideoFilterSpec filterSpec(const EncodePlan &plan, int width, int height, int fps)
+{
+    VideoFilterSpec spec;
+    spec.sourceWidth = plan.source.width;
+    spec.sourceHeight = plan.source.height;
+    spec.sourceFps = plan.source.fps;
+    spec.crop = plan.settings.crop;
+    spec.outWidth = width;
+    spec.outHeight = height;
+    spec.fps = fps;
+    spec.scalerBudget = FilterGraph::budgetForPreset(plan.settings.x264Preset);
+    spec.denoise = plan.settings.denoise;
+    spec.toneMap = toneMaps(plan);
+    spec.bitDepth = plan.source.bitDepth;
+    return spec;
+}
+
+static QStringList videoArguments(const EncodePlan &plan)
+{
+    if (plan.copyVideo)
+        return { "-c:v", "copy", "-avoid_negative_ts", "make_zero" };
+
+    QStringList args = encoderArguments(plan, plan.videoBitrateKbps,
+                                        plan.outWidth, plan.outHeight, plan.fps);
+
+    const QString filters =
+        FilterGraph::chain(filterSpec(plan, plan.outWidth, plan.outHeight, plan.fps));
+    if (!filters.isEmpty())
+        args << "-vf" << filters;
+
+    return args;
+}
+
+// Index up front, so players can start before the whole file is there
+static QStringList muxerArguments(const EncodePlan &plan)
+{
+    if (encoderOf(plan).container == "mp4")
+        return { "-movflags", "+faststart" };
+
+    return {};
+}
+
+static QStringList passArguments(int pass, const QString &logPrefix)
+{
+    return {
+        "-pass", QString::number(pass),
+        "-passlogfile", logPrefix,
+    };
+}
+
+// First pass: same input and video options, statistics only
+static EncodeStep firstPassStep(const QStringList &inputArguments,
+                                const QStringList &codecArguments,
+                                const QString &logPrefix,
+                                double durationSec)
+{
+    EncodeStep step;
+    step.arguments << "-y"
+                   << inputArguments
+                   << "-an"
+                   << codecArguments
+                   << passArguments(1, logPrefix)
+                   << "-f" << "null"
+                   << progressArguments()
+                   << "-";
+    step.durationUs = qint64(durationSec * 1e6);
+    step.cost = durationSec * FIRST_PASS_COST;
+    return step;
+}
+
+// Video bytes the size target leaves per second of output; 0 without one
+static double videoBytesPerSecLimit(const EncodePlan &plan)
+{
+    if (plan.settings.targetSizeBytes <= 0 || plan.durationSec <= 0.0)
+        return 0.0;
+
+    return qMax(0.0, (plan.settings.targetSizeBytes - EncodePlanner::fixedBytes(plan)) / plan.durationSec);
+}
+
+static QString newScratchDir()
+{
+    return QDir(QDir::tempPath()).filePath(
+        "clip2disc-" + QUuid::createUuid().toString(QUuid::Id128));
+}
+
+static QStringList audioArguments(const EncodePlan &plan)
+{
+    if (plan.copyAudio)
+        return { "-c:a", "copy" };
+
+    return {
+        "-c:a", encoderOf(plan).audioEncoder,
+        "-b:a", QString::number(plan.audioBitrateKbps) + "k",
+    };
+}
+
+// Entry for the concat demuxer's list file
+static QByteArray concatEntry(const QString &path)
+{
+    QString escaped = path;
+    escaped.replace("'", "'\\''");
+    return "file '" + escaped.toUtf8() + "'\n";
+}
+
+// Codecs the output container can carry as they are
+static bool carriesVideo(const QString &container, const QString &codec)
+{
+    if (container == "webm")
+        return codec == "vp9" || codec == "vp8" || codec == "av1";
+
+    return codec == "h264" || codec == "hevc" || codec == "av1";
+}
+
+static bool carriesAudio(const QString &container, const QString &codec)
+{
+    if (container == "webm")
+        return codec == "opus" || codec == "vorbis";
+
+    return codec == "aac" || codec == "mp3";
+}
+
+// What's left of the source's frame after the crop
+static QSize pictureSize(const VideoInfo &source, const EncodeSettings &settings)
+{
+    if (settings.crop.isEmpty())
+        return QSize(source.width, source.height);
+
+    return settings.crop.size();
+}
+
+// The output path with the container's suffix, if it has another one
+static QString outputPathFor(const QString &path, const QString &container)
+{
+    if (path.isEmpty())
+        return path;
+
+    const QFileInfo info(path);
+    const QString suffix = info.suffix().toLower();
+
+    // Matroska takes anything
+    if (suffix == container || suffix == "mkv")
+        return path;
+    if (container == "mp4" && suffix != "webm")
+        return path;
+
+    return info.dir().filePath(info.completeBaseName() + "." + container);
+}
+
+static QStringList trimArguments(const EncodePlan &plan)
+{
+    if (!plan.hasTrim)
+        return {};
+
+    // A copied video stream starts at plan.startSec, which is a keyframe
+    if (plan.copyVideo) {
+        return {
+            "-ss", QString::number(plan.startSec + KEYFRAME_SEEK_EPSILON_SEC, 'f', 6),
+            "-t",  QString::number(plan.durationSec, 'f', 6),
+        };
+    }
+
+    return {
+        "-ss", QString::number(plan.startSec, 'f', 3),
+        "-t",  QString::number(plan.durationSec, 'f', 3),
+    };
+}
+
+static void planSinglePass(EncodePlan &plan, const EncodeSettings &settings)
+{
+    const QStringList input = trimArguments(plan) + QStringList { "-i", settings.inputPath };
+
+    EncodeStep step;
+    QStringList &args = step.arguments;
+    args << "-y";
+
+    args << input;
+
+    // --- Video ---
+    args << videoArguments(plan);
+
+    QString logPrefix;
+    if (plan.twoPass) {
+        plan.scratchDir = newScratchDir();
+        logPrefix = QDir(plan.scratchDir).filePath("pass");
+        args << passArguments(2, logPrefix);
+    }
+
+    // --- Audio ---
+    args << audioArguments(plan);
+
+    // --- Container + progress ---
+    args << muxerArguments(plan)
+         << progressArguments();
+
+    args << settings.outputPath;
+
+    step.durationUs = plan.durationUs();
+    step.cost = plan.copyVideo ? plan.durationSec * REMUX_STEP_COST
+                               : plan.durationSec;
+
+    // Writes the audio too, but the index only at the very end
+    if (!plan.copyVideo && videoBytesPerSecLimit(plan) > 0.0) {
+        const bool hasAudio = !plan.source.audioCodec.isEmpty();
+        step.budgetBytes = plan.settings.targetSizeBytes
+                           - EncodePlanner::containerOverheadBytes(plan.durationSec, plan.fps, hasAudio);
+    }
+
+    plan.stages = { { step } };
+
+    if (plan.twoPass) {
+        plan.stages.prepend({ firstPassStep(input, videoArguments(plan),
+                                            logPrefix, plan.durationSec) });
+    }
+}
+
+// A stretch of the source's video that is produced on its own
+struct VideoPiece {
+    double startSec = 0.0;
+    double endSec = 0.0;
+    QStringList codecArguments;     // -c:v ... for this piece
+    bool copy = false;              // starts on a keyframe, stream-copied
+};
+
+// Each video piece is produced by its own step, all side by side; audio
+// is encoded once over the whole range (AAC frames don't line up with
+// the cuts) and everything is joined without re-encoding. Pieces are
+// MPEG-TS, which repeats the H.264 parameter sets in-band, so pieces
+// from different encoders can follow one another. In two-pass mode the
+// first passes of all encoded pieces run as a stage of their own.
+static void planPieces(EncodePlan &plan,
+                       const VideoInfo &source,
+                       const EncodeSettings &settings,
+                       const QList<VideoPiece> &pieces)
+{
+    plan.scratchDir = newScratchDir();
+
+    const QDir scratch(plan.scratchDir);
+    const QString listPath = scratch.filePath("pieces.txt");
+    const QString audioPath = scratch.filePath("audio.m4a");
+    const bool hasAudio = !source.audioCodec.isEmpty();
+
+    EncodeStage firstPasses;
+    EncodeStage encodes;
+    QByteArray list;
+
+    for (int i = 0; i < pieces.size(); ++i) {
+        const VideoPiece &piece = pieces.at(i);
+        const double length = piece.endSec - piece.startSec;
+        const double seek = piece.copy ? piece.startSec + KEYFRAME_SEEK_EPSILON_SEC
+                                       : piece.startSec;
+        const QString number = QString("%1").arg(i, 3, 10, QChar('0'));
+        const QString piecePath = scratch.filePath("piece-" + number + ".ts");
+        const QStringList input {
+            "-ss", seconds(seek),
+            "-t", seconds(length),
+            "-i", settings.inputPath,
+        };
+
+        QStringList codecArguments = piece.codecArguments;
+        if (plan.twoPass && !piece.copy) {
+            const QString logPrefix = scratch.filePath("x264-" + number);
+            firstPasses << firstPassStep(input, piece.codecArguments, logPrefix, length);
+            codecArguments << passArguments(2, logPrefix);
+        }
+
+        EncodeStep step;
+        step.arguments << "-y"
+                       << input
+                       << "-an"
+                       << codecArguments
+                       << progressArguments()
+                       << piecePath;
+        step.durationUs = qint64(length * 1e6);
+        step.cost = piece.copy ? length * REMUX_STEP_COST : length;
+
+        if (!piece.copy)
+            step.budgetBytes = qint64(videoBytesPerSecLimit(plan) * length * MPEG_TS_OVERHEAD);
+
+        encodes << step;
+        list += concatEntry(piecePath);
+    }
+
+    if (hasAudio) {
+        EncodeStep step;
+        step.arguments << "-y"
+                       << trimArguments(plan)
+                       << "-i" << settings.inputPath
+                       << "-vn"
+                       << audioArguments(plan)
+                       << progressArguments()
+                       << audioPath;
+        step.durationUs = plan.durationUs();
+        step.cost = plan.durationSec * AUDIO_STEP_COST;
+
+        encodes << step;
+    }
+
+    // --- Join ---
+    EncodeStep join;
+    join.arguments << "-y"
+                   << "-f" << "concat"
+                   << "-safe" << "0"
+                   << "-i" << listPath;
+    if (hasAudio)
+        join.arguments << "-i" << audioPath;
+
+    join.arguments << "-map" << "0:v:0";
+    if (hasAudio)
+        join.arguments << "-map" << "1:a:0";
+
+    join.arguments << "-c" << "copy";
+    if (plan.smartCut) {
+        // The encoded ends carry their own parameter sets in-band, which
+        // avc1 (a single avcC for the whole track) doesn't allow
+        join.arguments << "-tag:v" << "avc3";
+    } else if (!encoderOf(plan).tag.isEmpty()) {
+        join.arguments << "-tag:v" << encoderOf(plan).tag;
+    }
+
+    join.arguments << muxerArguments(plan)
+                   << progressArguments()
+                   << settings.outputPath;
+    join.durationUs = plan.durationUs();
+    join.cost = plan.durationSec * REMUX_STEP_COST;
+
+    plan.scratchFiles << qMakePair(listPath, list);
+    plan.stages = { encodes, { join } };
+
+    if (!firstPasses.isEmpty())
+        plan.stages.prepend(firstPasses);
+}
+
+// Segments cut at keyframes, all encoded with the plan's settings
+static void planSegmented(EncodePlan &plan,
+                          const VideoInfo &source,
+                          const EncodeSettings &settings,
+                          const QList<double> &bounds)
+{
+    QList<VideoPiece> pieces;
+    for (int i = 0; i + 1 < bounds.size(); ++i) {
+        VideoPiece piece;
+        piece.startSec = bounds[i];
+        piece.endSec = bounds[i + 1];
+        piece.codecArguments = videoArguments(plan);
+        pieces << piece;
+    }
+
+    planPieces(plan, source, settings, pieces);
+}
+
+// x264's name for an H.264 profile as probes report it; empty for the
+// ones x264 can't make in 8-bit 4:2:0
+static QString x264Profile(const QString &profile)
+{
+    if (profile == "Constrained Baseline" || profile == "Baseline")
+        return "baseline";
+    if (profile == "Main")
+        return "main";
+    if (profile == "High")
+        return "high";
+    return QString();
+}
+
+// Whether x264 can encode pieces that decode like the source's own:
+// 8-bit 4:2:0, a profile it makes, and level, colour and sample aspect
+// ratio all known
+static bool canMatchH264(const VideoInfo &source)
+{
+    return source.videoCodec == "h264"
+           && source.bitDepth == 8
+           && source.pixelFormat == "yuv420p"
+           && !x264Profile(source.videoProfile).isEmpty()
+           && source.videoLevel >= 10
+           && !source.colorPrimaries.isEmpty()
+           && !source.colorTransfer.isEmpty()
+           && !source.colorSpace.isEmpty()
+           && !source.sampleAspectRatio.isEmpty();
+}
+
+// Smart cut: only the partial GOPs at either end of the trim are encoded,
+// with the source stream's profile, level, pixel format, colour and
+// sample aspect ratio at its size, rate and bitrate; the keyframe-aligned
+// middle is copied.
+static void planSmartCut(EncodePlan &plan,
+                         const VideoInfo &source,
+                         const EncodeSettings &settings,
+                         double copyStartSec,
+                         double copyEndSec)
+{
+    const QString bitrate = QString::number(plan.videoBitrateKbps) + "k";
+    const QStringList matching {
+        "-c:v", "libx264",
+        "-preset", "fast",
+        "-profile:v", x264Profile(source.videoProfile),
+        "-level", QString::number(source.videoLevel / 10.0, 'f', 1),
+        "-b:v", bitrate,
+        "-maxrate", bitrate,
+        "-bufsize", QString::number(plan.videoBitrateKbps * 2) + "k",
+        "-vf", "setsar=" + QString(source.sampleAspectRatio).replace(':', '/'),
+        "-pix_fmt", source.pixelFormat,
+        "-color_primaries", source.colorPrimaries,
+        "-color_trc", source.colorTransfer,
+        "-colorspace", source.colorSpace,
+    };
+
+    const double endSec = plan.startSec + plan.durationSec;
+    const double frameSec = 1.0 / qMax(1.0, source.fps);
+
+    QList<VideoPiece> pieces;
+
+    if (copyStartSec - plan.startSec > frameSec / 2)
+        pieces << VideoPiece { plan.startSec, copyStartSec, matching, false };
+
+    pieces << VideoPiece { copyStartSec, copyEndSec, { "-c:v", "copy" }, true };
+
+    if (endSec - copyEndSec > frameSec / 2)
+        pieces << VideoPiece { copyEndSec, endSec, matching, false };
+
+    planPieces(plan, source, settings, pieces);
+}
+
+// Tiers: one decode, `split` into a scaler per output, one x264 each.
+// In two-pass mode both passes share the graph and each tier keeps its
+// own statistics file.
+static void planTierOutputs(EncodePlan &plan, const EncodeSettings &shared)
+{
+    const int count = int(plan.tiers.size());
+
+    // Denoised once, ahead of the split
+    const QString denoiser = FilterGraph::denoiser(plan.settings.denoise);
+
+    QString graph = denoiser.isEmpty() ? QString("[0:v]split=%1").arg(count)
+                                       : QString("[0:v]%1,split=%2").arg(denoiser).arg(count);
+    for (int i = 0; i < count; ++i)
+        graph += QString("[s%1]").arg(i);
+
+    for (int i = 0; i < count; ++i) {
+        const EncodeSettings &tier = plan.tiers.at(i).settings;
+
+        VideoFilterSpec spec = filterSpec(plan, tier.outWidth, tier.outHeight, tier.fps);
+        spec.denoise.clear();
+        const QString filters = FilterGraph::chain(spec);
+
+        graph += QString(";[s%1]%2[v%1]").arg(i).arg(filters.isEmpty() ? QString("null") : filters);
+    }
+
+    const QStringList input = trimArguments(plan) + QStringList { "-i", shared.inputPath };
+
+    QString scratch;
+    if (plan.twoPass) {
+        plan.scratchDir = newScratchDir();
+        scratch = plan.scratchDir;
+    }
+
+    EncodeStep firstPass;
+    firstPass.arguments << "-y" << progressArguments() << input
+                        << "-filter_complex" << graph;
+
+    EncodeStep encode;
+    encode.arguments << "-y" << progressArguments() << input
+                     << "-filter_complex" << graph;
+
+    for (int i = 0; i < count; ++i) {
+        const EncodeTier &tier = plan.tiers.at(i);
+        const QString logPrefix = QDir(scratch).filePath(QString("pass-tier%1").arg(i));
+
+        QStringList video { "-map", QString("[v%1]").arg(i) };
+        video << encoderArguments(plan, tier.videoBitrateKbps,
+                                  tier.settings.outWidth, tier.settings.outHeight, tier.settings.fps);
+
+        if (plan.twoPass) {
+            firstPass.arguments << video << passArguments(1, logPrefix)
+                                << "-f" << "null" << "-";
+            video << passArguments(2, logPrefix);
+        }
+
+        encode.arguments << video
+                         << "-map" << "0:a:0?"
+                         << audioArguments(plan)
+                         << muxerArguments(plan)
+                         << tier.settings.outputPath;
+    }
+
+    encode.durationUs = plan.durationUs();
+    encode.cost = plan.durationSec;
+    plan.stages = { { encode } };
+
+    if (plan.twoPass) {
+        firstPass.durationUs = plan.durationUs();
+        firstPass.cost = plan.durationSec * FIRST_PASS_COST;
+        plan.stages.prepend({ firstPass });
+    }
+}
+
+static double sourceRangeStart(const EncodePlan &plan)
+{
+    return plan.hasTrim ? plan.startSec : 0.0;
+}
+
+const QList<VideoEncoderSpec> &EncodePlanner::videoEncoders()
+{
+    // relativeBits: bitrate for about x264's quality at the same preset
+    // speed class. x265 and SVT-AV1 take no -pass through FFmpeg (their
+    // stats files go through -x265-params/-svtav1-params, whose ':'
+    // separators clash with Windows paths), so they rely on the size
+    // guard instead; libvpx does two-pass natively.
+    static const QList<VideoEncoderSpec> encoders {
+        { "libx264", "h264", "mp4", "aac", "h264",
+          { "-preset", "fast" }, QString(), 1.0, true, true, true },
+        { "libx265", "hevc", "mp4", "aac", "hevc",
+          { "-preset", "fast" }, "hvc1", 0.65, false, true, true },
+        { "libsvtav1", "av1", "mp4", "aac", "ivf",
+          { "-preset", "8" }, QString(), 0.55, false, false, false },
+        { "libvpx-vp9", "vp9", "webm", "libopus", "ivf",
+          { "-deadline", "good", "-cpu-used", "4", "-row-mt", "1" }, QString(), 0.7, true, false, false },
+    };
+    return encoders;
+}
+
+const VideoEncoderSpec &EncodePlanner::videoEncoder(const QString &encoder)
+{
+    const QList<VideoEncoderSpec> &encoders = videoEncoders();
+    for (const VideoEncoderSpec &spec : encoders) {
+        if (spec.encoder == encoder)
+            return spec;
+    }
+    return encoders.first();
+}
+
+const QList<X264Preset> &EncodePlanner::x264Presets()
+{
+    // Speeds are typical x264 throughput at 720p-1080p relative to
+    // "fast"; lookahead and refs are the presets' own
+    static const QList<X264Preset> presets {
+        { "veryfast", 2.2, 10, 1 },
+        { "faster",   1.6, 20, 2 },
+        { "fast",     1.0, 30, 2 },
+        { "medium",   0.8, 40, 3 },
+        { "slow",     0.45, 50, 5 },
+        { "slower",   0.2, 60, 8 },
+    };
+    return presets;
+}
+
+EncodePlan EncodePlanner::plan(const VideoInfo &source,
+                               const EncodeSettings &requested,
+                               const SourceAnalysis &analysis)
+{
+    const VideoEncoderSpec &encoder = videoEncoder(requested.videoEncoder);
+
+    // The suffix follows the container (a .mp4 name for VP9 becomes .webm)
+    EncodeSettings settings = requested;
+    settings.outputPath = outputPathFor(requested.outputPath, encoder.container);
+
+    EncodePlan plan;
+    plan.source = source;
+    plan.settings = settings;
+    plan.analysis = analysis;
+
+    // --- Trim ---
+    const qint64 sourceMs = qint64(source.duration * 1000);
+    const qint64 trimStartMs = settings.trimStartMs;
+    const qint64 trimEndMs = settings.trimEndMs > 0 ? settings.trimEndMs : sourceMs;
+
+    plan.hasTrim =
+        trimEndMs > trimStartMs &&
+        trimEndMs <= sourceMs;
+
+    plan.startSec = trimStartMs / 1000.0;
+    plan.durationSec = plan.hasTrim ? (trimEndMs - trimStartMs) / 1000.0
+                                    : source.duration;
+
+    // --- Output format ---
+    const QSize picture = pictureSize(source, settings);
+    plan.outWidth  = settings.outWidth  > 0 ? settings.outWidth  : picture.width();
+    plan.outHeight = settings.outHeight > 0 ? settings.outHeight : picture.height();
+    plan.fps = settings.fps > 0 ? settings.fps : qMax(1, int(source.fps));
+
+    plan.audioBitrateKbps = settings.audioBitrateKbps > 0
+                                ? settings.audioBitrateKbps
+                                : int(qMax<qint64>(32, source.audioBitrate));
+
+    // --- Audio stream copy ---
+    // Worth it when the source track is no bigger than what we'd encode
+    plan.copyAudio = settings.allowStreamCopy
+                     && carriesAudio(encoder.container, source.audioCodec)
+                     && source.audioBitrate > 0
+                     && source.audioBitrate <= plan.audioBitrateKbps;
+    if (plan.copyAudio)
+        plan.audioBitrateKbps = int(source.audioBitrate);
+
+    // --- Video bitrate ---
+    if (settings.videoBitrateOverrideKbps > 0) {
+        plan.videoBitrateKbps = settings.videoBitrateOverrideKbps;
+    } else if (settings.targetSizeBytes > 0) {
+        const int audioKbps = source.audioCodec.isEmpty() ? 0 : plan.audioBitrateKbps;
+        plan.videoBitrateKbps =
+            videoBitrateForTargetSize(settings.targetSizeBytes,
+                                      plan.durationSec,
+                                      audioKbps,
+                                      plan.fps);
+    } else {
+        const int userVideoBitrate = settings.userVideoBitrateKbps > 0
+                                         ? settings.userVideoBitrateKbps
+                                         : int(qMax<qint64>(1, source.videoBitrate));
+        plan.videoBitrateKbps =
+            computeScaledVideoBitrate(userVideoBitrate, plan.outWidth, plan.outHeight, plan.fps);
+
+        // Same picture for fewer bits with a more efficient encoder
+        plan.videoBitrateKbps = qMax(1, int(plan.videoBitrateKbps * encoder.relativeBits));
+    }
+
+    // --- Video stream copy ---
+    plan.copyVideo = canCopyVideo(source, settings, plan, analysis);
+
+    // Trim between keyframes: copy from the first keyframe inside the range
+    // to the last one, encode the bits before and after
+    double copyStartSec = 0.0;
+    double copyEndSec = 0.0;
+    if (!plan.copyVideo
+        && canMatchH264(source)
+        && encoder.encoder == "libx264"
+        && plan.hasTrim
+        && !analysis.keyframes.isEmpty()
+        && videoFitsAsIs(source, settings, plan, analysis)) {
+        const double endSec = plan.startSec + plan.durationSec;
+        copyStartSec = analysis.keyframes.atOrAfter(plan.startSec);
+        copyEndSec = analysis.keyframes.atOrBefore(endSec);
+
+        // Without a whole GOP inside the range there's nothing to copy
+        plan.smartCut = copyStartSec >= 0.0 && copyEndSec > copyStartSec;
+    }
+
+    if (plan.copyVideo || plan.smartCut) {
+        plan.videoBitrateKbps = sourceVideoKbps(source, plan, analysis);
+
+        // Start on the keyframe instead of decoding up to the mark
+        if (plan.copyVideo && plan.hasTrim && plan.startSec > 0.0) {
+            const double keyframe = analysis.keyframes.nearest(plan.startSec);
+            plan.durationSec += plan.startSec - keyframe;
+            plan.startSec = keyframe;
+        }
+    }
+
+    // --- Segments ---
+    QList<double> bounds;
+    if (!plan.copyVideo && !plan.smartCut && encoder.mpegTs
+        && wantsSegments(source, settings) && !analysis.keyframes.isEmpty()) {
+        const int wanted = settings.segments > 0 ? settings.segments
+                                                 : autoSegmentCount(plan.durationSec);
+        const double rangeStart = sourceRangeStart(plan);
+        bounds = segmentBoundaries(analysis.keyframes,
+                                   rangeStart,
+                                   rangeStart + plan.durationSec,
+                                   wanted);
+    }
+    plan.segments = qMax(1, int(bounds.size()) - 1);
+
+    // A size target is only reliable with a first pass to budget from
+    plan.twoPass = settings.targetSizeBytes > 0 && encoder.twoPass
+                   && !plan.copyVideo && !plan.smartCut;
+
+    plan.crf = crfForHeight(plan.outHeight);
+
+    if (plan.smartCut) {
+        planSmartCut(plan, source, settings, copyStartSec, copyEndSec);
+    } else if (plan.segments > 1) {
+        planSegmented(plan, source, settings, bounds);
+    } else {
+        planSinglePass(plan, settings);
+    }
+
+    return plan;
+}
+
+EncodePlan EncodePlanner::replan(const EncodePlan &plan, int videoBitrateKbps)
+{
+    EncodeSettings settings = plan.settings;
+    settings.videoBitrateOverrideKbps = videoBitrateKbps;
+    settings.allowStreamCopy = false;
+
+    EncodePlan next = EncodePlanner::plan(plan.source, settings, plan.analysis);
+
+    // Same analysis, same cuts: the second passes can read the old
+    // statistics. Paths only differ in the scratch directory's name.
+    if (plan.twoPass && next.twoPass
+        && next.segments == plan.segments
+        && !plan.scratchDir.isEmpty()) {
+        const QString from = QDir(next.scratchDir).dirName();
+        const QString to = QDir(plan.scratchDir).dirName();
+
+        for (EncodeStage &stage : next.stages) {
+            for (EncodeStep &step : stage) {
+                for (QString &arg : step.arguments)
+                    arg.replace(from, to);
+            }
+        }
+        for (auto &[path, contents] : next.scratchFiles) {
+            path.replace(from, to);
+            contents.replace(from.toUtf8(), to.toUtf8());
+        }
+
+        next.scratchDir = plan.scratchDir;
+        next.stages.removeFirst();
+    }
+
+    return next;
+}
+
+EncodePlan EncodePlanner::planTiers(const VideoInfo &source,
+                                    const QList<EncodeSettings> &tiers,
+                                    const SourceAnalysis &analysis)
+{
+    if (tiers.isEmpty())
+        return EncodePlan();
+
+    // Trim and audio are worked out as for the first tier on its own;
+    // copying and splitting don't apply to a shared decode
+    EncodeSettings shared = tiers.first();
+    shared.allowStreamCopy = false;
+    shared.segments = 1;
+    shared.targetSizeBytes = 0;
+    shared.videoBitrateOverrideKbps = 0;
+
+    EncodePlan plan = EncodePlanner::plan(source, shared, analysis);
+    plan.stages.clear();
+    plan.scratchDir.clear();
+    plan.scratchFiles.clear();
+
+    const VideoEncoderSpec &encoder = videoEncoder(shared.videoEncoder);
+
+    // Tier formats are worked out from the cropped picture
+    VideoInfo picture = source;
+    picture.width = pictureSize(source, shared).width();
+    picture.height = pictureSize(source, shared).height();
+
+    const int sourceKbps = sourceVideoKbps(source, plan, analysis);
+    const int sourceFps = qMax(1, int(source.fps));
+    const int audioKbps = source.audioCodec.isEmpty() ? 0 : plan.audioBitrateKbps;
+
+    for (const EncodeSettings &settings : tiers) {
+        EncodeTier tier;
+        tier.settings = settings;
+        tier.settings.outputPath = outputPathFor(settings.outputPath, encoder.container);
+        tier.settings.videoEncoder = shared.videoEncoder;
+        tier.settings.allowStreamCopy = false;
+        tier.settings.segments = 1;
+
+        int width = settings.outWidth > 0 ? settings.outWidth : picture.width;
+        int height = settings.outHeight > 0 ? settings.outHeight : picture.height;
+        int fps = settings.fps > 0 ? settings.fps : sourceFps;
+
+        if (settings.targetSizeBytes > 0) {
+            tier.videoBitrateKbps =
+                videoBitrateForTargetSize(settings.targetSizeBytes, plan.durationSec, audioKbps, fps);
+
+            // In x264 terms, so an efficient encoder gets a larger format
+            if (settings.outWidth <= 0 || settings.outHeight <= 0) {
+                tierFormat(picture, sourceKbps, int(tier.videoBitrateKbps / encoder.relativeBits),
+                           settings.fps <= 0, width, height, fps);
+                tier.videoBitrateKbps =
+                    videoBitrateForTargetSize(settings.targetSizeBytes, plan.durationSec, audioKbps, fps);
+            }
+        } else {
+            const int userKbps = settings.userVideoBitrateKbps > 0 ? settings.userVideoBitrateKbps
+                                                                   : qMax(1, sourceKbps);
+            tier.videoBitrateKbps = computeScaledVideoBitrate(userKbps, width, height, fps);
+            tier.videoBitrateKbps = qMax(1, int(tier.videoBitrateKbps * encoder.relativeBits));
+        }
+
+        tier.settings.outWidth = width;
+        tier.settings.outHeight = height;
+        tier.settings.fps = fps;
+
+        plan.twoPass = plan.twoPass || (settings.targetSizeBytes > 0 && encoder.twoPass);
+        plan.tiers << tier;
+    }
+
+    // The plan-level format is the first tier's, for logging and progress
+    const EncodeTier &first = plan.tiers.first();
+    plan.outWidth = first.settings.outWidth;
+    plan.outHeight = first.settings.outHeight;
+    plan.fps = first.settings.fps;
+    plan.videoBitrateKbps = first.videoBitrateKbps;
+    plan.crf = crfForHeight(plan.outHeight);
+
+    planTierOutputs(plan, shared);
+    return plan;
+}
+
+void EncodePlanner::tierFormat(const VideoInfo &source,
+                               int sourceKbps,
+                               int videoBitrateKbps,
+                               bool allowLowerFps,
+                               int &outWidth,
+                               int &outHeight,
+                               int &fps)
+{
+    const int sourceHeight = qMax(2, source.height);
+
+    QList<int> heights { sourceHeight };
+    for (int h : { 1080, 720, 480, 360 }) {
+        if (h < sourceHeight)
+            heights << h;
+    }
+
+    QList<int> rates { fps };
+    if (allowLowerFps && fps > 30)
+        rates << 30;
+
+    // The slider logic's bitrate for each format, starting from the
+    // source's own: the first one the budget covers looks about as good
+    // as the source does at that size
+    for (int h : std::as_const(heights)) {
+        const int w = int(qint64(source.width) * h / sourceHeight);
+        for (int r : std::as_const(rates)) {
+            if (computeScaledVideoBitrate(qMax(1, sourceKbps), w, h, r) <= videoBitrateKbps) {
+                outWidth = w;
+                outHeight = h;
+                fps = r;
+                return;
+            }
+        }
+    }
+
+    // Nothing fits; the smallest format stretches the budget furthest
+    outHeight = heights.last();
+    outWidth = int(qint64(source.width) * outHeight / sourceHeight);
+    fps = rates.last();
+}
+
+QString EncodePlanner::tierOutputPath(const QString &outputPath, qint64 targetSizeBytes)
+{
+    const QFileInfo info(outputPath);
+    const double mb = targetSizeBytes / (1024.0 * 1024.0);
+    const QString suffix = info.suffix().isEmpty() ? QString("mp4") : info.suffix();
+
+    return info.dir().filePath(QString("%1-%2MB.%3")
+                                   .arg(info.completeBaseName(),
+                                        QString::number(mb, 'g', 4),
+                                        suffix));
+}
+
+QStringList EncodePlanner::withVideoBitrate(const QStringList &arguments, int videoBitrateKbps)
+{
+    QStringList args = arguments;
+    const QString rate = QString::number(videoBitrateKbps) + "k";
+
+    for (qsizetype i = 0; i + 1 < args.size(); ++i) {
+        if (args.at(i) == "-b:v" || args.at(i) == "-maxrate")
+            args[i + 1] = rate;
+        else if (args.at(i) == "-bufsize")
+            args[i + 1] = QString::number(videoBitrateKbps * 2) + "k";
+    }
+
+    return args;
+}
+
+QString EncodePlanner::referenceFilters(const EncodePlan &plan, int width, int height, int fps)
+{
+    VideoFilterSpec spec = filterSpec(plan, width, height, fps);
+    spec.denoise.clear();
+    return FilterGraph::chain(spec);
+}
+
+QStringList EncodePlanner::sampleArguments(const EncodePlan &plan,
+                                          double startSec,
+                                          double lengthSec)
+{
+    QStringList args {
+        "-ss", seconds(startSec),
+        "-t", seconds(lengthSec),
+        "-i", plan.settings.inputPath,
+        "-an",
+    };
+
+    args << videoArguments(plan)
+         << "-f" << encoderOf(plan).rawFormat
+         << "-loglevel" << "error"
+         << "-";
+
+    return args;
+}
+
+int EncodePlanner::sourceVideoKbps(const VideoInfo &source)
+{
+    if (source.videoBitrate > 0)
+        return int(source.videoBitrate);
+
+    // Matroska and friends only store the container total
+    return int(qMax<qint64>(0, source.bitrate - source.audioBitrate));
+}
+
+int EncodePlanner::sourceVideoKbps(const VideoInfo &source,
+                                   const EncodePlan &plan,
+                                   const SourceAnalysis &analysis)
+{
+    // Packet sizes give the real rate of the trimmed range, which can be
+    // far off the file average for game footage or screen recordings
+    const double rangeStart = sourceRangeStart(plan);
+    const qint64 bytes = analysis.keyframes.bytesBetween(rangeStart,
+                                                         rangeStart + plan.durationSec);
+    if (bytes > 0 && plan.durationSec > 0.0)
+        return qMax(1, int(bytes * 8.0 / 1000.0 / plan.durationSec));
+
+    return sourceVideoKbps(source);
+}
+
+bool EncodePlanner::videoFitsAsIs(const VideoInfo &source,
+                                  const EncodeSettings &settings,
+                                  const EncodePlan &plan,
+                                  const SourceAnalysis &analysis)
+{
+    const QString container = videoEncoder(settings.videoEncoder).container;
+    if (!settings.allowStreamCopy || !carriesVideo(container, source.videoCodec))
+        return false;
+
+    // Cropping means decoding
+    if (!settings.crop.isEmpty())
+        return false;
+
+    // So do tone-mapping and denoising
+    if ((settings.toneMapHdr && source.isHdr()) || !settings.denoise.isEmpty())
+        return false;
+
+    // Nothing to scale or resample
+    if (plan.outWidth != source.width
+        || plan.outHeight != source.height
+        || plan.fps != qMax(1, int(source.fps)))
+        return false;
+
+    // The source must already be as small as the encode would be
+    const int kbps = sourceVideoKbps(source, plan, analysis);
+    return kbps > 0 && kbps <= plan.videoBitrateKbps;
+}
+
+bool EncodePlanner::canCopyVideo(const VideoInfo &source,
+                                 const EncodeSettings &settings,
+                                 const EncodePlan &plan,
+                                 const SourceAnalysis &analysis)
+{
+    if (!videoFitsAsIs(source, settings, plan, analysis))
+        return false;
+
+    // A copy can only start on a keyframe; allow half a frame of slack
+    if (plan.hasTrim && plan.startSec > 0.0) {
+        if (analysis.keyframes.isEmpty())
+            return false;
+
+        const double tolerance = 0.5 / qMax(1.0, source.fps);
+        if (qAbs(analysis.keyframes.nearest(plan.startSec) - plan.startSec) > tolerance)
+            return false;
+    }
+
+    return true;
+}
+
+bool EncodePlanner::needsKeyframes(const VideoInfo &source, const EncodeSettings &settings)
+{
+    if (wantsSegments(source, settings))
+        return true;
+
+    // To tell whether a trimmed copy starts on a keyframe
+    return settings.allowStreamCopy
+           && settings.trimStartMs > 0
+           && carriesVideo(videoEncoder(settings.videoEncoder).container, source.videoCodec);
+}
+
+bool EncodePlanner::wantsSegments(const VideoInfo &source, const EncodeSettings &settings)
+{
+    if (settings.segments == 1 || source.videoCodec.isEmpty())
+        return false;
+
+    if (settings.segments > 1)
+        return true;
+
+    const qint64 endMs = settings.trimEndMs > 0 ? settings.trimEndMs
+                                                : qint64(source.duration * 1000);
+    return autoSegmentCount((endMs - settings.trimStartMs) / 1000.0) > 1;
+}
+
+int EncodePlanner::autoSegmentCount(double durationSec)
+{
+    if (durationSec < SEGMENT_MIN_DURATION_SEC)
+        return 1;
+
+    const int byCores = QThread::idealThreadCount() / THREADS_PER_SEGMENT;
+    const int byLength = int(durationSec / SEGMENT_MIN_LENGTH_SEC);
+
+    return qBound(1, qMin(byCores, byLength), MAX_SEGMENTS);
+}
+
+QList<double> EncodePlanner::segmentBoundaries(const KeyframeIndex &keyframes,
+                                               double startSec,
+                                               double endSec,
+                                               int segments)
+{
+    QList<double> bounds { startSec };
+
+    const double length = endSec - startSec;
+    for (int i = 1; i < segments; ++i) {
+        const double cut = keyframes.nearest(startSec + length * i / segments);
+
+        // Sparse keyframes can pull several cuts onto the same spot, or
+        // leave a sliver at either end; skip those
+        if (cut - bounds.last() < SEGMENT_MIN_LENGTH_SEC / 2
+            || endSec - cut < SEGMENT_MIN_LENGTH_SEC / 2)
+            continue;
+
+        bounds << cut;
+    }
+
+    bounds << endSec;
+    return bounds;
+}
+
+int EncodePlanner::computeScaledVideoBitrate(int userBitrate,
+                                             int outWidth,
+                                             int outHeight,
+                                             int fps)
+{
+    if (userBitrate <= 0)
+        return 0;
+
+    // Reference: 1080p @ 60fps
+    const double refPixels = 1920.0 * 1080.0;
+    const double curPixels = double(outWidth) * outHeight;
+
+    double resFactor = curPixels / refPixels;
+    resFactor = qBound(0.15, resFactor, 1.0);
+
+    double fpsFactor = fps / 60.0;
+    fpsFactor = qBound(0.35, fpsFactor, 1.0);
+
+    int scaled =
+        int(userBitrate * resFactor * fpsFactor);
+
+    // Safety clamp
+    scaled = qBound(400, scaled, userBitrate);
+
+    return scaled;
+}
+
+int EncodePlanner::crfForHeight(int outHeight)
+{
+    // --- CRF tuning ---
+    int crf = 22;
+    if (outHeight <= 720) crf = 23;
+    if (outHeight <= 480) crf = 24;
+    return crf;
+}
+
+int EncodePlanner::videoBitrateForTargetSize(qint64 targetSizeBytes,
+                                             double durationSec,
+                                             int audioBitrateKbps,
+                                             int fps)
+{
+    if (durationSec <= 0.0)
+        return 0;
+
+    // video × duration + audio × duration + index = budget
+    const qint64 overhead = containerOverheadBytes(durationSec, fps, audioBitrateKbps > 0);
+    const double budgetKbit = (targetSizeBytes * TARGET_SIZE_FILL - overhead) * 8.0 / 1000.0;
+    const double videoKbit = budgetKbit - double(audioBitrateKbps) * durationSec;
+
+    return qMax(MIN_VIDEO_KBPS, int(videoKbit / durationSec));
+}
+
+qint64 EncodePlanner::containerOverheadBytes(double durationSec, int fps, bool hasAudio)
+{
+    double bytes = MP4_FIXED_OVERHEAD_BYTES
+                   + durationSec * qMax(1, fps) * MP4_BYTES_PER_VIDEO_FRAME;
+    if (hasAudio)
+        bytes += durationSec * AAC_FRAMES_PER_SEC * MP4_BYTES_PER_AUDIO_FRAME;
+
+    return qint64(bytes);
+}
+
+qint64 EncodePlanner::fixedBytes(const EncodePlan &plan)
+{
+    const bool hasAudio = !plan.source.audioCodec.isEmpty();
+    const double audioBytes =
+        hasAudio ? plan.audioBitrateKbps * 1000.0 / 8.0 * plan.durationSec : 0.0;
+
+    return qint64(audioBytes) + containerOverheadBytes(plan.durationSec, plan.fps, hasAudio);
+}
+
+int EncodePlanner::correctedVideoBitrate(const EncodePlan &plan, qint64 outputBytes)
+{
+    const qint64 targetBytes = plan.settings.targetSizeBytes;
+    if (targetBytes <= 0 || plan.durationSec <= 0.0)
+        return plan.videoBitrateKbps;
+
+    // Audio and the index come out as planned; the video made the miss
+    const double fixed = fixedBytes(plan);
+    const double wantedVideoBytes = targetBytes * TARGET_SIZE_FILL - fixed;
+    const double gotVideoBytes = outputBytes - fixed;
+
+    if (wantedVideoBytes <= 0.0 || gotVideoBytes <= 0.0)
+        return MIN_VIDEO_KBPS;
+
+    const int kbps = int(plan.videoBitrateKbps * wantedVideoBytes / gotVideoBytes * RETRY_CORRECTION);
+    return qBound(MIN_VIDEO_KBPS, kbps, qMax(MIN_VIDEO_KBPS, plan.videoBitrateKbps - 1));
+}
@@ -0,0 +1,253 @@
+#ifndef ENCODEPLAN_H
+#define ENCODEPLAN_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QByteArray>
+#include <QRect>
+
+#include "videoinfo.h"
+#include "keyframeindex.h"
+
+// What the user asked for, independent of where it came from (GUI
+// sliders or command line). Zero means "same as the source".
+struct EncodeSettings {
+    QString inputPath;
+    QString outputPath;
+
+    qint64 trimStartMs = 0;
+    qint64 trimEndMs = 0;            // 0 = until the end
+
+    QRect crop;                      // in source pixels, applied before scaling; empty = none
+    int outWidth = 0;                // 0 = the (cropped) picture's size
+    int outHeight = 0;
+    int fps = 0;
+
+    int userVideoBitrateKbps = 0;    // slider value, scaled by resolution/fps
+    int audioBitrateKbps = 0;
+
+    qint64 targetSizeBytes = 0;      // when set, overrides the video bitrate (two-pass)
+    int videoBitrateOverrideKbps = 0; // forced video bitrate, e.g. when retrying an overshoot
+
+    int segments = 1;                // encoded in parallel; 0 = pick from cores and length
+    bool allowStreamCopy = true;     // copy streams that already fit instead of encoding
+
+    QString videoEncoder;            // FFmpeg encoder name; empty = libx264
+    QString x264Preset;              // picked for a time budget; empty = the encoder's default
+    bool toneMapHdr = true;          // PQ/HLG sources to SDR; off when FFmpeg lacks zscale
+    QString denoise;                 // "light" or "medium" hqdn3d before scaling; empty = none
+};
+
+// An FFmpeg video encoder the planner knows how to drive
+struct VideoEncoderSpec {
+    QString encoder;                 // FFmpeg name, e.g. "libx264"
+    QString codec;                   // as probes report it, e.g. "h264"
+    QString container;               // muxer and file suffix: "mp4" or "webm"
+    QString audioEncoder;            // paired audio encoder
+    QString rawFormat;               // elementary stream muxer, for samples
+    QStringList options;             // preset and friends, after -c:v
+    QString tag;                     // -tag:v in MP4 when the default doesn't play everywhere
+    double relativeBits = 1.0;       // bits for x264's quality; lower = more efficient
+    bool twoPass = false;            // -pass 1/2 through FFmpeg
+    bool vbvCap = false;             // takes -maxrate/-bufsize as a cap
+    bool mpegTs = false;             // can be cut into MPEG-TS pieces and joined
+};
+
+// An x264 preset the time budget can choose, with the lookahead and
+// reference frames it implies
+struct X264Preset {
+    QString name;
+    double relativeSpeed = 1.0;      // frames per second relative to "fast"
+    int lookahead = 30;              // -rc-lookahead, frames
+    int refs = 2;                    // before the level cap
+};
+
+// Optional facts about the source gathered in the background. The
+// planner falls back to a plain single pass for anything missing.
+struct SourceAnalysis {
+    KeyframeIndex keyframes;
+};
+
+// One FFmpeg invocation. The output path is always the last argument.
+struct EncodeStep {
+    QStringList arguments;
+    qint64 durationUs = 0;           // expected output duration, for progress
+    double cost = 1.0;               // relative share of the plan's total work
+
+    // Output bytes this step may write without pushing the encode past
+    // its size target; 0 = not watched
+    qint64 budgetBytes = 0;
+};
+
+// Steps of a stage run side by side; stages run one after another.
+using EncodeStage = QList<EncodeStep>;
+
+// One output of a multi-tier plan
+struct EncodeTier {
+    EncodeSettings settings;         // output path, size target and format of this tier
+    int videoBitrateKbps = 0;
+};
+
+// The resolved FFmpeg invocations for one encode.
+struct EncodePlan {
+    QList<EncodeStage> stages;
+
+    // Several outputs from a single decode; empty for a plain encode of
+    // settings.outputPath
+    QList<EncodeTier> tiers;
+
+    // Intermediate files live here; created before the first stage and
+    // removed when the run ends. Empty for single-pass plans.
+    QString scratchDir;
+    QList<QPair<QString, QByteArray>> scratchFiles;  // written before the first stage
+
+    int segments = 1;
+    bool copyVideo = false;          // remuxed as-is, no x264
+    bool smartCut = false;           // only the GOPs at the trim marks are encoded
+    bool copyAudio = false;
+    bool twoPass = false;            // analysis pass before each encode
+
+    double startSec = 0.0;
+    double durationSec = 0.0;        // of the output
+    bool hasTrim = false;
+
+    int outWidth = 0;
+    int outHeight = 0;
+    int fps = 0;
+    int videoBitrateKbps = 0;        // after scaling
+    int audioBitrateKbps = 0;
+    int crf = 23;
+
+    // What the plan was made from, so it can be made again with changes
+    VideoInfo source;
+    EncodeSettings settings;
+    SourceAnalysis analysis;
+
+    qint64 durationUs() const { return qint64(durationSec * 1e6); }
+};
+
+class EncodePlanner
+{
+public:
+    // Encoders in order of preference when nothing else decides; the
+    // first one (libx264) is the default and is always assumed present
+    static const QList<VideoEncoderSpec> &videoEncoders();
+    static const VideoEncoderSpec &videoEncoder(const QString &encoder);
+
+    // Fastest first; "fast" is what runs without a time budget
+    static const QList<X264Preset> &x264Presets();
+
+    static EncodePlan plan(const VideoInfo &source,
+                           const EncodeSettings &settings,
+                           const SourceAnalysis &analysis = SourceAnalysis());
+
+    // The same encode at a different video bitrate, always re-encoded.
+    // A two-pass plan keeps its scratch directory and skips the first
+    // passes, whose statistics don't depend on the bitrate.
+    static EncodePlan replan(const EncodePlan &plan, int videoBitrateKbps);
+
+    // The same clip at several sizes from one decode: the decoded video is
+    // split in a filter graph and feeds one encoder per tier. Trim, audio
+    // and input come from the first tier. Tiers without a resolution get
+    // the largest format the budget affords (see tierFormat), two-pass
+    // when any tier has a size target.
+    static EncodePlan planTiers(const VideoInfo &source,
+                                const QList<EncodeSettings> &tiers,
+                                const SourceAnalysis &analysis = SourceAnalysis());
+
+    // Largest standard height (and, if allowed, 30 instead of fps) whose
+    // scaled source bitrate fits videoBitrateKbps
+    static void tierFormat(const VideoInfo &source,
+                           int sourceKbps,
+                           int videoBitrateKbps,
+                           bool allowLowerFps,
+                           int &outWidth,
+                           int &outHeight,
+                           int &fps);
+
+    // <dir>/<base>-<N>MB.<ext> for one tier of outputPath
+    static QString tierOutputPath(const QString &outputPath, qint64 targetSizeBytes);
+
+    // Step arguments with the encoder's rate (and VBV, if capped) changed
+    static QStringList withVideoBitrate(const QStringList &arguments, int videoBitrateKbps);
+
+    // -vf chain that turns the source into what an output of the plan
+    // shows, minus the denoiser: the reference its quality is scored against
+    static QString referenceFilters(const EncodePlan &plan, int width, int height, int fps);
+
+    // A short stretch of the plan's video, encoded with its settings and
+    // written to stdout as a raw elementary stream, for measuring what the encode
+    // would produce
+    static QStringList sampleArguments(const EncodePlan &plan,
+                                       double startSec,
+                                       double lengthSec);
+
+    // True when plan() could use a KeyframeIndex for these settings
+    // (to split the encode or to stream-copy a trimmed video), so the
+    // caller knows whether building one is worth it
+    static bool needsKeyframes(const VideoInfo &source, const EncodeSettings &settings);
+    static bool wantsSegments(const VideoInfo &source, const EncodeSettings &settings);
+
+    // Copying is chosen per stream: the video when nothing about the
+    // picture changes, its bitrate already fits and the trim starts on a
+    // keyframe; the audio when the output container takes it and it's no
+    // bigger than the planned track. Video that fits but is trimmed
+    // between keyframes is smart-cut (8-bit 4:2:0 H.264 with its
+    // profile, level, colour and aspect known, to libx264 only).
+    static bool videoFitsAsIs(const VideoInfo &source,
+                              const EncodeSettings &settings,
+                              const EncodePlan &plan,
+                              const SourceAnalysis &analysis);
+    static bool canCopyVideo(const VideoInfo &source,
+                             const EncodeSettings &settings,
+                             const EncodePlan &plan,
+                             const SourceAnalysis &analysis);
+
+    // Video kbps of the source, derived from the container if needed;
+    // with a packet index, measured over the plan's range instead
+    static int sourceVideoKbps(const VideoInfo &source);
+    static int sourceVideoKbps(const VideoInfo &source,
+                               const EncodePlan &plan,
+                               const SourceAnalysis &analysis);
+
+    static int computeScaledVideoBitrate(int userBitrate,
+                                         int outWidth,
+                                         int outHeight,
+                                         int fps);
+
+    static int crfForHeight(int outHeight);
+
+    // Video bitrate that makes (video + audio + MP4 index) land a couple
+    // of percent under a byte budget
+    static int videoBitrateForTargetSize(qint64 targetSizeBytes,
+                                         double durationSec,
+                                         int audioBitrateKbps,
+                                         int fps);
+
+    // Bytes the MP4 container adds on top of the streams (moov sample
+    // tables, box headers)
+    static qint64 containerOverheadBytes(double durationSec, int fps, bool hasAudio);
+
+    // What a planned output holds besides video: its audio track and the
+    // MP4 index
+    static qint64 fixedBytes(const EncodePlan &plan);
+
+    // Video bitrate for another attempt after a target-size encode came
+    // out at outputBytes: the current one scaled by how far the video
+    // part missed its share of the budget
+    static int correctedVideoBitrate(const EncodePlan &plan, qint64 outputBytes);
+
+    // Segment count for settings.segments == 0
+    static int autoSegmentCount(double durationSec);
+
+    // [start, k1, k2, ..., end] with the inner cuts snapped to keyframes;
+    // just [start, end] if no usable cut exists
+    static QList<double> segmentBoundaries(const KeyframeIndex &keyframes,
+                                           double startSec,
+                                           double endSec,
+                                           int segments);
+};
+
+#endif // ENCODEPLAN_H
@@ -0,0 +1,234 @@
+#include "encodercaps.h"
+
+#include <QProcess>
+#include <QSettings>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// Bump when discovery changes, so old entries are measured again
+static constexpr int CAPS_VERSION = 1;
+
+static constexpr int LIST_TIMEOUT_MS      = 5000;
+static constexpr int BENCHMARK_TIMEOUT_MS = 30000;
+
+// Long enough to get past encoder startup, short enough to stay
+// unnoticed next to the first probe
+static constexpr int    BENCHMARK_FRAMES  = 90;
+static constexpr int    BENCHMARK_PIXELS  = 1280 * 720;
+static constexpr double TWO_PASS_SLOWDOWN = 1.4;
+
+// Only these are remembered; the full lists run into the hundreds
+static const QStringList &interestingAudioEncoders()
+{
+    static const QStringList names { "aac", "libopus" };
+    return names;
+}
+
+static const QStringList &interestingFilters()
+{
+    static const QStringList names {
+        "scale", "fps", "split", "crop", "cropdetect",
+        "hqdn3d", "zscale", "tonemap", "ssim", "psnr",
+    };
+    return names;
+}
+
+static qint64 binaryMtime(const QString &ffmpegPath)
+{
+    return QFileInfo(ffmpegPath).lastModified().toMSecsSinceEpoch();
+}
+
+// ----------------- Settings cache -----------------
+
+EncoderCaps EncoderCaps::cached(const QString &ffmpegPath)
+{
+    EncoderCaps caps;
+
+    QSettings settings;
+    settings.beginGroup("encoderCaps");
+
+    if (ffmpegPath.isEmpty()
+        || settings.value("version").toInt() != CAPS_VERSION
+        || settings.value("path").toString() != ffmpegPath
+        || settings.value("mtime").toLongLong() != binaryMtime(ffmpegPath))
+        return caps;
+
+    const QStringList encoders = settings.value("encoders").toStringList();
+    const QStringList filters = settings.value("filters").toStringList();
+    caps.m_encoders = QSet<QString>(encoders.cbegin(), encoders.cend());
+    caps.m_filters = QSet<QString>(filters.cbegin(), filters.cend());
+
+    settings.beginGroup("fps");
+    for (const QString &encoder : settings.childKeys())
+        caps.m_benchmarkFps.insert(encoder, settings.value(encoder).toDouble());
+
+    return caps;
+}
+
+void EncoderCaps::store(const QString &ffmpegPath) const
+{
+    QSettings settings;
+    settings.remove("encoderCaps");
+    settings.beginGroup("encoderCaps");
+
+    settings.setValue("version", CAPS_VERSION);
+    settings.setValue("path", ffmpegPath);
+    settings.setValue("mtime", binaryMtime(ffmpegPath));
+    settings.setValue("encoders", QStringList(m_encoders.cbegin(), m_encoders.cend()));
+    settings.setValue("filters", QStringList(m_filters.cbegin(), m_filters.cend()));
+
+    settings.beginGroup("fps");
+    for (auto it = m_benchmarkFps.cbegin(); it != m_benchmarkFps.cend(); ++it)
+        settings.setValue(it.key(), it.value());
+}
+
+// ----------------- Discovery -----------------
+
+QSet<QString> EncoderCaps::listNames(const QString &ffmpegPath, const QString &what)
+{
+    QSet<QString> names;
+
+    QProcess process;
+    process.start(ffmpegPath, { "-hide_banner", what });
+    if (!process.waitForFinished(LIST_TIMEOUT_MS)) {
+        process.kill();
+        process.waitForFinished();
+        return names;
+    }
+
+    // Lines look like " V....D libx264   libx264 H.264 ..." after a legend
+    // of " V..... = Video" lines and a "------" rule
+    const QStringList lines = QString::fromLocal8Bit(process.readAllStandardOutput()).split('\n');
+    for (const QString &line : lines) {
+        const QStringList fields = line.simplified().split(' ');
+        if (fields.size() >= 3 && fields.at(1) != "=")
+            names.insert(fields.at(1));
+    }
+
+    return names;
+}
+
+double EncoderCaps::benchmark(const QString &ffmpegPath, const VideoEncoderSpec &spec)
+{
+    QStringList args {
+        "-hide_banner",
+        "-loglevel", "error",
+        "-f", "lavfi",
+        "-i", "testsrc2=size=1280x720:rate=30",
+        "-frames:v", QString::number(BENCHMARK_FRAMES),
+        "-c:v", spec.encoder,
+    };
+    args << spec.options
+         << "-b:v" << "2000k"
+         << "-f" << "null"
+         << "-";
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QProcess process;
+    process.start(ffmpegPath, args);
+    if (!process.waitForFinished(BENCHMARK_TIMEOUT_MS)) {
+        process.kill();
+        process.waitForFinished();
+        return 0.0;
+    }
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+        return 0.0;
+
+    const double elapsedSec = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+    return BENCHMARK_FRAMES / elapsedSec;
+}
+
+EncoderCaps EncoderCaps::discover(const QString &ffmpegPath)
+{
+    EncoderCaps caps;
+    if (ffmpegPath.isEmpty())
+        return caps;
+
+    const QSet<QString> encoders = listNames(ffmpegPath, "-encoders");
+    const QSet<QString> filters = listNames(ffmpegPath, "-filters");
+
+    for (const VideoEncoderSpec &spec : EncodePlanner::videoEncoders()) {
+        if (encoders.contains(spec.encoder))
+            caps.m_encoders.insert(spec.encoder);
+    }
+    for (const QString &name : interestingAudioEncoders()) {
+        if (encoders.contains(name))
+            caps.m_encoders.insert(name);
+    }
+    for (const QString &name : interestingFilters()) {
+        if (filters.contains(name))
+            caps.m_filters.insert(name);
+    }
+
+    // One at a time: side by side they would measure each other
+    for (const VideoEncoderSpec &spec : EncodePlanner::videoEncoders()) {
+        if (!caps.m_encoders.contains(spec.encoder))
+            continue;
+
+        const double fps = benchmark(ffmpegPath, spec);
+        qDebug() << "Encoder benchmark:" << spec.encoder << fps << "fps at 720p";
+
+        if (fps > 0.0)
+            caps.m_benchmarkFps.insert(spec.encoder, fps);
+        else
+            caps.m_encoders.remove(spec.encoder);   // listed, but doesn't run
+    }
+
+    if (caps.isValid())
+        caps.store(ffmpegPath);
+
+    return caps;
+}
+
+// ----------------- Selection -----------------
+
+QStringList EncoderCaps::videoEncoders() const
+{
+    QStringList names;
+    for (const VideoEncoderSpec &spec : EncodePlanner::videoEncoders()) {
+        if (m_encoders.contains(spec.encoder))
+            names << spec.encoder;
+    }
+    return names;
+}
+
+double EncoderCaps::estimatedSpeed(const QString &encoder, const EncodePlan &plan) const
+{
+    const double fps = benchmarkFps(encoder);
+    if (fps <= 0.0 || plan.outWidth <= 0 || plan.outHeight <= 0 || plan.fps <= 0)
+        return 0.0;
+
+    // Encoders scale about linearly with pixels once past startup
+    const double pixels = double(plan.outWidth) * plan.outHeight;
+    double speed = fps * BENCHMARK_PIXELS / pixels / plan.fps;
+
+    const VideoEncoderSpec &spec = EncodePlanner::videoEncoder(encoder);
+    if (plan.settings.targetSizeBytes > 0 && spec.twoPass)
+        speed /= TWO_PASS_SLOWDOWN;
+
+    return speed;
+}
+
+QString EncoderCaps::chooseEncoder(const EncodePlan &plan, double speedFloor) const
+{
+    QString best = "libx264";
+    double bestBits = EncodePlanner::videoEncoder(best).relativeBits;
+
+    for (const VideoEncoderSpec &spec : EncodePlanner::videoEncoders()) {
+        if (!hasEncoder(spec.encoder) || !hasEncoder(spec.audioEncoder))
+            continue;
+
+        const double speed = estimatedSpeed(spec.encoder, plan);
+        if (speed >= speedFloor && spec.relativeBits < bestBits) {
+            best = spec.encoder;
+            bestBits = spec.relativeBits;
+        }
+    }
+
+    return best;
+}
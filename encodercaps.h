@@ -0,0 +1,59 @@
+#ifndef ENCODERCAPS_H
+#define ENCODERCAPS_H
+
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QHash>
+
+#include "encodeplan.h"
+
+// What an FFmpeg build can do: the encoders and filters clip2disc cares
+// about, and how fast each known video encoder runs on this machine.
+//
+// Discovery lists "-encoders" and "-filters", then encodes a short
+// synthetic 720p clip with every available video encoder. The result is
+// remembered in QSettings per binary (path and mtime), so it's measured
+// once per FFmpeg install. Discovery blocks; run it off the GUI thread.
+class EncoderCaps
+{
+public:
+    EncoderCaps() = default;
+
+    // Stored result for this binary, or an empty (invalid) one
+    static EncoderCaps cached(const QString &ffmpegPath);
+
+    // Lists and benchmarks, then stores the result
+    static EncoderCaps discover(const QString &ffmpegPath);
+
+    bool isValid() const { return !m_encoders.isEmpty(); }
+
+    bool hasEncoder(const QString &name) const { return m_encoders.contains(name); }
+    bool hasFilter(const QString &name) const { return m_filters.contains(name); }
+
+    // Known video encoders this build has, in EncodePlanner's order
+    QStringList videoEncoders() const;
+
+    // Benchmark frames per second at 720p; 0 if not measured
+    double benchmarkFps(const QString &encoder) const { return m_benchmarkFps.value(encoder); }
+
+    // Expected encode speed for the plan's format, as a multiple of
+    // real time (2.0 = a minute of video in 30 seconds); 0 if unknown
+    double estimatedSpeed(const QString &encoder, const EncodePlan &plan) const;
+
+    // The encoder needing the fewest bits for the plan's picture whose
+    // estimated speed is at least speedFloor; libx264 if none qualifies
+    QString chooseEncoder(const EncodePlan &plan, double speedFloor) const;
+
+private:
+    static QSet<QString> listNames(const QString &ffmpegPath, const QString &what);
+    static double benchmark(const QString &ffmpegPath, const VideoEncoderSpec &spec);
+
+    void store(const QString &ffmpegPath) const;
+
+    QSet<QString> m_encoders;
+    QSet<QString> m_filters;
+    QHash<QString, double> m_benchmarkFps;
+};
+
+#endif // ENCODERCAPS_H
@@ -0,0 +1,169 @@
+#include "encodescheduler.h"
+#include "encodesession.h"
+
+#include <QThread>
+#include <QDebug>
+
+// Threads one x264 job can use well before frame-parallel efficiency drops
+static constexpr int THREADS_PER_JOB_TARGET = 6;
+
+static int coreCount()
+{
+    return qMax(1, QThread::idealThreadCount());
+}
+
+EncodeScheduler::EncodeScheduler(QObject *parent)
+    : QObject(parent)
+{
+}
+
+EncodeScheduler::~EncodeScheduler()
+{
+    cancelAll();
+}
+
+void EncodeScheduler::setConcurrency(int jobs)
+{
+    m_requestedJobs = qMax(0, jobs);
+}
+
+int EncodeScheduler::concurrency() const
+{
+    if (m_requestedJobs > 0)
+        return qMin(m_requestedJobs, coreCount());
+
+    return qMax(1, coreCount() / THREADS_PER_JOB_TARGET);
+}
+
+int EncodeScheduler::threadsPerJob() const
+{
+    return qMax(1, coreCount() / concurrency());
+}
+
+int EncodeScheduler::enqueue(const QString &program, const EncodePlan &plan)
+{
+    Job job;
+    job.id = m_nextId++;
+    job.program = program;
+    job.plan = plan;
+
+    m_queue << job;
+    startNext();
+
+    return job.id;
+}
+
+void EncodeScheduler::cancelAll()
+{
+    m_queue.clear();
+
+    for (Job &job : m_running) {
+        job.session->disconnect(this);
+        job.session->cancel();
+        job.session->deleteLater();
+    }
+    m_running.clear();
+}
+
+int EncodeScheduler::freeSlot() const
+{
+    for (int slot = 0; slot < concurrency(); ++slot) {
+        bool used = false;
+        for (const Job &job : m_running) {
+            if (job.slot == slot) {
+                used = true;
+                break;
+            }
+        }
+        if (!used)
+            return slot;
+    }
+    return -1;
+}
+
+void EncodeScheduler::startNext()
+{
+    const int threads = threadsPerJob();
+
+    while (!m_queue.isEmpty() && m_running.size() < concurrency()) {
+        Job job = m_queue.takeFirst();
+        job.slot = freeSlot();
+
+        if (!m_wall.isValid())
+            m_wall.start();
+
+        job.session = new EncodeSession(this);
+        job.session->setThreadBudget(threads);
+
+        if (m_pinCpus) {
+            QList<int> cpus;
+            for (int i = 0; i < threads; ++i)
+                cpus << job.slot * threads + i;
+            job.session->setCpus(cpus);
+        }
+
+        const int id = job.id;
+
+        connect(job.session, &EncodeSession::progress,
+                this, [this, id](const EncodeProgress &p) {
+                    emit jobProgress(id, p);
+                });
+        connect(job.session, &EncodeSession::retrying,
+                this, [this, id](int attempt, int videoBitrateKbps) {
+                    emit jobRetrying(id, attempt, videoBitrateKbps);
+                });
+        connect(job.session, &EncodeSession::tierRedo,
+                this, [this, id](const QString &outputPath, int videoBitrateKbps) {
+                    emit jobTierRedo(id, outputPath, videoBitrateKbps);
+                });
+        connect(job.session, &EncodeSession::finished,
+                this, [this, id](bool ok, const QString &errorLog) {
+                    onJobFinished(id, ok, errorLog);
+                });
+
+        qDebug() << "Scheduler: job" << id << "slot" << job.slot
+                 << "threads" << threads << (m_pinCpus ? "(pinned)" : "");
+
+        m_running.insert(id, job);
+        job.session->start(job.program, job.plan);
+
+        emit jobStarted(id);
+    }
+}
+
+void EncodeScheduler::onJobFinished(int id, bool ok, const QString &errorLog)
+{
+    const Job job = m_running.take(id);
+    if (job.session)
+        job.session->deleteLater();
+
+    if (ok) {
+        ++m_completed;
+        m_encodedSec += job.plan.durationSec;
+    } else {
+        ++m_failed;
+    }
+
+    emit jobFinished(id, ok, errorLog);
+
+    startNext();
+
+    if (isIdle())
+        emit allFinished();
+}
+
+EncodeScheduler::Throughput EncodeScheduler::throughput() const
+{
+    Throughput t;
+    t.completed = m_completed;
+    t.failed = m_failed;
+    t.encodedSec = m_encodedSec;
+    t.wallSec = m_wall.isValid() ? m_wall.elapsed() / 1000.0 : 0.0;
+
+    if (t.wallSec > 0.0) {
+        t.clipsPerHour = m_completed * 3600.0 / t.wallSec;
+        t.encodedPerWallSec = m_encodedSec / t.wallSec;
+    }
+
+    return t;
+}
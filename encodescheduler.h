@@ -0,0 +1,87 @@
+#ifndef ENCODESCHEDULER_H
+#define ENCODESCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+
+#include "encodeplan.h"
+#include "progressparser.h"
+
+class EncodeSession;
+
+// Runs several encodes at once.
+//
+// A single libx264 job stops scaling well past a handful of threads, so
+// on big machines it's faster to run N jobs side by side, each with a
+// fixed slice of the cores. The slice is the job's EncodeSession thread
+// budget (passed to FFmpeg as -threads) and can optionally be enforced
+// with a CPU affinity mask (Linux), giving every running job its own
+// disjoint set of cores.
+class EncodeScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Throughput {
+        int completed = 0;
+        int failed = 0;
+        double wallSec = 0.0;
+        double encodedSec = 0.0;         // output media seconds produced
+        double clipsPerHour = 0.0;
+        double encodedPerWallSec = 0.0;  // realtime multiple of the whole batch
+    };
+
+    explicit EncodeScheduler(QObject *parent = nullptr);
+    ~EncodeScheduler();
+
+    // 0 = pick from the core count
+    void setConcurrency(int jobs);
+    void setPinCpus(bool pin) { m_pinCpus = pin; }
+
+    int enqueue(const QString &program, const EncodePlan &plan);
+    void cancelAll();
+
+    int concurrency() const;
+    int threadsPerJob() const;
+    bool isIdle() const { return m_queue.isEmpty() && m_running.isEmpty(); }
+
+    Throughput throughput() const;
+
+signals:
+    void jobStarted(int id);
+    void jobProgress(int id, const EncodeProgress &progress);
+    void jobRetrying(int id, int attempt, int videoBitrateKbps);
+    void jobTierRedo(int id, const QString &outputPath, int videoBitrateKbps);
+    void jobFinished(int id, bool ok, const QString &errorLog);
+    void allFinished();
+
+private:
+    struct Job {
+        int id = 0;
+        QString program;
+        EncodePlan plan;
+        int slot = -1;
+        EncodeSession *session = nullptr;
+    };
+
+    void startNext();
+    void onJobFinished(int id, bool ok, const QString &errorLog);
+    int freeSlot() const;
+
+    QList<Job> m_queue;
+    QHash<int, Job> m_running;
+
+    int m_requestedJobs = 0;
+    int m_nextId = 1;
+    bool m_pinCpus = false;
+
+    // --- Throughput ---
+    QElapsedTimer m_wall;
+    int m_completed = 0;
+    int m_failed = 0;
+    double m_encodedSec = 0.0;
+};
+
+#endif // ENCODESCHEDULER_H
@@ -0,0 +1,454 @@
+#include "encodesession.h"
+#include "ffmpegrunner.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+#include <QDebug>
+
+static constexpr int PROGRESS_INTERVAL_MS = 100;
+static constexpr int MAX_SIZE_RETRIES     = 2;
+
+// Size guard: a step's output is projected linearly from what it has
+// written so far. Two-pass spends unevenly on purpose, so the projection
+// must clear the budget by a margin that shrinks as the step advances.
+static constexpr double GUARD_MIN_FRACTION = 0.2;
+static constexpr double GUARD_MAX_MARGIN   = 0.25;
+static constexpr double GUARD_MIN_MARGIN   = 0.02;
+static constexpr double GUARD_CORRECTION   = 0.97;
+static constexpr int    MAX_STEP_RESTARTS  = 2;
+static constexpr int    MIN_VIDEO_KBPS     = 100;
+
+EncodeSession::EncodeSession(QObject *parent)
+    : QObject(parent)
+{
+}
+
+EncodeSession::~EncodeSession()
+{
+    if (m_running) {
+        stopSteps();
+        if (!m_plan.scratchDir.isEmpty())
+            QDir(m_plan.scratchDir).removeRecursively();
+    }
+}
+
+QStringList EncodeSession::withThreads(const QStringList &arguments, int threads)
+{
+    QStringList args = arguments;
+    const QString n = QString::number(threads);
+
+    // Decoder threads: input option, must precede -i
+    const int inputIndex = args.indexOf("-i");
+    if (inputIndex >= 0) {
+        args.insert(inputIndex, n);
+        args.insert(inputIndex, "-threads");
+    }
+
+    // Encoder threads: output option, right before the output path
+    args.insert(args.size() - 1, "-threads");
+    args.insert(args.size() - 1, n);
+
+    return args;
+}
+
+void EncodeSession::start(const QString &program, const EncodePlan &plan)
+{
+    if (m_running)
+        cancel();
+
+    m_program = program;
+    m_retries = 0;
+    m_followUps.clear();
+    m_running = true;
+
+    if (runPlan(plan))
+        emit started();
+}
+
+bool EncodeSession::runPlan(const EncodePlan &plan)
+{
+    m_plan = plan;
+    m_stage = 0;
+    m_doneCost = 0.0;
+    m_totalCost = 0.0;
+
+    for (const EncodeStage &stage : std::as_const(m_plan.stages)) {
+        for (const EncodeStep &step : stage)
+            m_totalCost += step.cost;
+    }
+
+    m_elapsed.start();
+    m_sinceLastEmit.invalidate();
+
+    QString error;
+    if (m_plan.stages.isEmpty())
+        error = "Nothing to encode";
+    else
+        prepareScratch(error);
+
+    // Report through the event loop, like a step that fails to start
+    if (!error.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, error] {
+            finish(false, error);
+        }, Qt::QueuedConnection);
+        return false;
+    }
+
+    startStage();
+    return true;
+}
+
+void EncodeSession::cancel()
+{
+    if (!m_running)
+        return;
+
+    stopSteps();
+    finish(false, "Cancelled");
+}
+
+bool EncodeSession::prepareScratch(QString &error)
+{
+    if (m_plan.scratchDir.isEmpty())
+        return true;
+
+    if (!QDir().mkpath(m_plan.scratchDir)) {
+        error = "Could not create " + m_plan.scratchDir;
+        return false;
+    }
+
+    for (const auto &[path, contents] : std::as_const(m_plan.scratchFiles)) {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)
+            || file.write(contents) != contents.size()
+            || !file.commit()) {
+            error = "Could not write " + path;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void EncodeSession::startStage()
+{
+    const EncodeStage &stage = m_plan.stages.at(m_stage);
+    const int count = int(stage.size());
+    ++m_generation;
+
+    m_stepThreads = 0;
+    if (m_threadBudget > 0)
+        m_stepThreads = qMax(1, m_threadBudget / count);
+    else if (count > 1)
+        m_stepThreads = qMax(1, QThread::idealThreadCount() / count);
+
+    qDebug() << "Encode stage" << m_stage + 1 << "of" << m_plan.stages.size()
+             << ":" << count << "step(s)," << m_stepThreads << "thread(s) each";
+
+    m_steps = QList<Step>(count);
+
+    for (int i = 0; i < count; ++i) {
+        m_steps[i].cost = stage.at(i).cost;
+        m_steps[i].videoBitrateKbps = m_plan.videoBitrateKbps;
+        startStep(i);
+    }
+}
+
+void EncodeSession::startStep(int index)
+{
+    const EncodeStep &planned = m_plan.stages.at(m_stage).at(index);
+    const int generation = m_generation;
+    const int cpusPerStep = qMax(1, int(m_cpus.size()) / int(m_steps.size()));
+
+    Step &step = m_steps[index];
+    step.runner = new FfmpegRunner;
+    step.last = EncodeProgress();
+
+    if (!m_cpus.isEmpty())
+        step.runner->setCpuAffinity(m_cpus.mid((index * cpusPerStep) % m_cpus.size(), cpusPerStep));
+
+    connect(step.runner, &FfmpegRunner::progress,
+            this, [this, generation, index](const EncodeProgress &p) {
+                if (generation == m_generation)
+                    onStepProgress(index, p);
+            });
+    connect(step.runner, &FfmpegRunner::finished,
+            this, [this, generation, index](bool ok, const QString &errorLog) {
+                if (generation == m_generation)
+                    onStepFinished(index, ok, errorLog);
+            });
+
+    step.runner->start(m_program,
+                       m_stepThreads > 0 ? withThreads(planned.arguments, m_stepThreads)
+                                         : planned.arguments,
+                       planned.durationUs);
+}
+
+void EncodeSession::restartStep(int index, int videoBitrateKbps)
+{
+    Step &step = m_steps[index];
+    step.runner->disconnect(this);
+    step.runner->cancel();
+    step.runner->deleteLater();
+
+    ++step.restarts;
+    step.videoBitrateKbps = videoBitrateKbps;
+
+    EncodeStep &planned = m_plan.stages[m_stage][index];
+    planned.arguments = EncodePlanner::withVideoBitrate(planned.arguments, videoBitrateKbps);
+
+    startStep(index);
+}
+
+void EncodeSession::onStepProgress(int index, const EncodeProgress &progress)
+{
+    m_steps[index].last = progress;
+
+    if (guardBudget(index))
+        return;
+
+    emitProgress(false);
+}
+
+bool EncodeSession::guardBudget(int index)
+{
+    const EncodeStep &planned = m_plan.stages.at(m_stage).at(index);
+    const Step &step = m_steps.at(index);
+
+    if (planned.budgetBytes <= 0
+        || planned.durationUs <= 0
+        || step.last.outTimeUs <= 0
+        || step.last.totalSize <= 0)
+        return false;
+
+    const double fraction = double(step.last.outTimeUs) / planned.durationUs;
+    if (fraction < GUARD_MIN_FRACTION || fraction >= 1.0)
+        return false;
+
+    const qint64 projected = qint64(step.last.totalSize / fraction);
+    const double margin = GUARD_MAX_MARGIN * (1.0 - fraction) + GUARD_MIN_MARGIN;
+    if (projected <= planned.budgetBytes * (1.0 + margin))
+        return false;
+
+    qDebug() << "Encode step" << m_stage + 1 << index << "projected at" << projected
+             << "bytes, budget" << planned.budgetBytes << "at" << int(fraction * 100) << "%";
+
+    // --- Parallel pieces: redo just this one, lower ---
+    // The pieces that finished or stay within their share are kept
+    if (m_steps.size() > 1) {
+        if (step.restarts >= MAX_STEP_RESTARTS)
+            return false;
+
+        const int kbps = qMax(MIN_VIDEO_KBPS,
+                              int(step.videoBitrateKbps * double(planned.budgetBytes) / projected
+                                  * GUARD_CORRECTION));
+        if (kbps >= step.videoBitrateKbps)
+            return false;
+
+        qDebug() << "  restarting it at" << kbps << "kbps";
+        restartStep(index, kbps);
+        return true;
+    }
+
+    // --- Whole output: start over at a corrected bitrate ---
+    stopSteps();
+    if (!retryForSize(projected)) {
+        finish(false, QString("The output would end up at about %1 bytes, over the %2 byte limit")
+                          .arg(projected)
+                          .arg(m_plan.settings.targetSizeBytes));
+    }
+    return true;
+}
+
+void EncodeSession::onStepFinished(int index, bool ok, const QString &errorLog)
+{
+    Step &step = m_steps[index];
+    step.done = true;
+
+    if (!ok) {
+        qDebug() << "Encode step failed:" << m_stage + 1 << index << errorLog;
+        stopSteps();
+        finish(false, errorLog);
+        return;
+    }
+
+    step.last.percent = 100.0;
+    emitProgress(true);
+
+    for (const Step &s : std::as_const(m_steps)) {
+        if (!s.done)
+            return;
+    }
+
+    // --- Stage complete ---
+    for (Step &s : m_steps) {
+        m_doneCost += s.cost;
+        s.runner->deleteLater();
+    }
+    m_steps.clear();
+
+    if (++m_stage < m_plan.stages.size())
+        startStage();
+    else
+        finish(true, QString());
+}
+
+void EncodeSession::emitProgress(bool force)
+{
+    if (!force
+        && m_sinceLastEmit.isValid()
+        && m_sinceLastEmit.elapsed() < PROGRESS_INTERVAL_MS)
+        return;
+
+    m_sinceLastEmit.start();
+
+    double doneCost = m_doneCost;
+    qint64 stepOutUs = 0;
+
+    EncodeProgress p;
+    for (const Step &s : std::as_const(m_steps)) {
+        doneCost += s.cost * s.last.percent / 100.0;
+        stepOutUs += s.last.outTimeUs;
+        p.frame += s.last.frame;
+        p.totalSize += s.last.totalSize;
+
+        if (!s.done) {
+            p.fps += s.last.fps;
+            p.speed += s.last.speed;
+        }
+    }
+
+    const double fraction = m_totalCost > 0.0 ? qBound(0.0, doneCost / m_totalCost, 1.0) : 0.0;
+
+    p.percent = fraction * 100.0;
+    p.outTimeUs = qint64(fraction * m_plan.durationUs());
+
+    if (stepOutUs > 0)
+        p.bitrateKbps = p.totalSize * 8000.0 / stepOutUs;
+
+    // A lone step has FFmpeg's own speed-based estimate; otherwise
+    // extrapolate from the time spent so far
+    const double elapsedSec = m_elapsed.elapsed() / 1000.0;
+    if (m_plan.stages.size() == 1 && m_steps.size() == 1)
+        p.etaSec = m_steps.first().last.etaSec;
+    else if (fraction > 0.01)
+        p.etaSec = elapsedSec * (1.0 - fraction) / fraction;
+
+    emit progress(p);
+}
+
+void EncodeSession::stopSteps()
+{
+    ++m_generation;
+
+    for (Step &s : m_steps) {
+        s.runner->disconnect(this);
+        s.runner->cancel();
+        s.runner->deleteLater();
+    }
+    m_steps.clear();
+}
+
+bool EncodeSession::retryForSize(qint64 outputBytes)
+{
+    if (m_retries >= MAX_SIZE_RETRIES)
+        return false;
+
+    const int kbps = EncodePlanner::correctedVideoBitrate(m_plan, outputBytes);
+    if (kbps >= m_plan.videoBitrateKbps)
+        return false;
+
+    ++m_retries;
+    qDebug() << "Output" << outputBytes << "bytes, over the target of"
+             << m_plan.settings.targetSizeBytes << "- retrying at" << kbps << "kbps";
+
+    const EncodePlan next = EncodePlanner::replan(m_plan, kbps);
+
+    if (!m_plan.scratchDir.isEmpty() && next.scratchDir != m_plan.scratchDir)
+        QDir(m_plan.scratchDir).removeRecursively();
+
+    emit retrying(m_retries, kbps);
+    runPlan(next);
+    return true;
+}
+
+void EncodeSession::queueOversizedTiers()
+{
+    // A tier that came out too big is encoded again on its own, as a
+    // regular size-targeted plan at a corrected bitrate
+    for (const EncodeTier &tier : std::as_const(m_plan.tiers)) {
+        const qint64 targetBytes = tier.settings.targetSizeBytes;
+        const qint64 outputBytes = QFileInfo(tier.settings.outputPath).size();
+        if (targetBytes <= 0 || outputBytes <= targetBytes)
+            continue;
+
+        const EncodePlan single = EncodePlanner::plan(m_plan.source, tier.settings, m_plan.analysis);
+
+        EncodeSettings retry = tier.settings;
+        retry.videoBitrateOverrideKbps = EncodePlanner::correctedVideoBitrate(single, outputBytes);
+
+        qDebug() << "Tier" << tier.settings.outputPath << "is" << outputBytes
+                 << "bytes, over" << targetBytes << "- redoing it at"
+                 << retry.videoBitrateOverrideKbps << "kbps";
+
+        m_followUps << EncodePlanner::plan(m_plan.source, retry, m_plan.analysis);
+    }
+}
+
+void EncodeSession::finish(bool ok, const QString &errorLog)
+{
+    if (!m_running)
+        return;
+
+    QString log = errorLog;
+
+    // --- Size target ---
+    const qint64 targetBytes = m_plan.settings.targetSizeBytes;
+    if (ok && targetBytes > 0) {
+        const qint64 outputBytes = QFileInfo(m_plan.settings.outputPath).size();
+        if (outputBytes > targetBytes) {
+            if (retryForSize(outputBytes))
+                return;
+
+            ok = false;
+            log = QString("The output is %1 bytes, over the %2 byte limit")
+                      .arg(outputBytes)
+                      .arg(targetBytes);
+        }
+    }
+
+    if (ok)
+        queueOversizedTiers();
+
+    // --- Follow-ups: oversized tiers, redone one at a time ---
+    if (ok && !m_followUps.isEmpty()) {
+        if (!m_plan.scratchDir.isEmpty())
+            QDir(m_plan.scratchDir).removeRecursively();
+
+        const EncodePlan next = m_followUps.takeFirst();
+        m_retries = 0;
+
+        emit tierRedo(next.settings.outputPath, next.videoBitrateKbps);
+        runPlan(next);
+        return;
+    }
+
+    m_followUps.clear();
+    m_running = false;
+
+    if (ok) {
+        EncodeProgress p;
+        p.outTimeUs = m_plan.durationUs();
+        p.percent = 100.0;
+        p.etaSec = 0.0;
+        p.finished = true;
+        emit progress(p);
+    }
+
+    if (!m_plan.scratchDir.isEmpty())
+        QDir(m_plan.scratchDir).removeRecursively();
+
+    emit finished(ok, log);
+}
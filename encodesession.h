@@ -0,0 +1,101 @@
+#ifndef ENCODESESSION_H
+#define ENCODESESSION_H
+
+#include <QObject>
+#include <QList>
+#include <QElapsedTimer>
+
+#include "encodeplan.h"
+#include "progressparser.h"
+
+class FfmpegRunner;
+
+// Runs an EncodePlan: its stages one after another, the steps of a stage
+// side by side, each in its own FfmpegRunner. Progress of every step is
+// folded into a single EncodeProgress weighted by step cost, so callers
+// see one encode no matter how the plan was split up.
+//
+// A failing step cancels the rest of the session. An encode with a size
+// target that comes out too big is planned again at a lower bitrate and
+// rerun, a couple of times at most. Steps with a byte budget are watched
+// while they run: one that is clearly heading past it is restarted at a
+// lower bitrate right away (parallel pieces on their own, a whole-file
+// encode by re-planning) instead of finishing a doomed encode. Tiers of
+// a multi-output plan that overshoot are redone one by one afterwards.
+class EncodeSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EncodeSession(QObject *parent = nullptr);
+    ~EncodeSession();
+
+    // Threads the whole session may use, split evenly between the steps of
+    // a stage. 0 leaves single steps to FFmpeg and splits the core count
+    // between parallel ones.
+    void setThreadBudget(int threads) { m_threadBudget = threads; }
+
+    // Logical CPUs to pin to (Linux), split the same way. Empty = no pinning.
+    void setCpus(const QList<int> &cpus) { m_cpus = cpus; }
+
+    void start(const QString &program, const EncodePlan &plan);
+    void cancel();
+
+    bool isRunning() const { return m_running; }
+    const EncodePlan &plan() const { return m_plan; }
+
+    // Inserts -threads for both decoding and encoding
+    static QStringList withThreads(const QStringList &arguments, int threads);
+
+signals:
+    void started();
+    void progress(const EncodeProgress &progress);
+    void retrying(int attempt, int videoBitrateKbps);   // progress starts over
+    void tierRedo(const QString &outputPath, int videoBitrateKbps);   // likewise, for one tier
+    void finished(bool ok, const QString &errorLog);
+
+private:
+    struct Step {
+        FfmpegRunner *runner = nullptr;
+        double cost = 0.0;
+        EncodeProgress last;
+        bool done = false;
+        int videoBitrateKbps = 0;    // currently in its arguments
+        int restarts = 0;
+    };
+
+    bool runPlan(const EncodePlan &plan);
+    bool prepareScratch(QString &error);
+    void startStage();
+    void startStep(int index);
+    void restartStep(int index, int videoBitrateKbps);
+    bool guardBudget(int index);
+    void onStepProgress(int index, const EncodeProgress &progress);
+    void onStepFinished(int index, bool ok, const QString &errorLog);
+    void emitProgress(bool force);
+    void stopSteps();
+    bool retryForSize(qint64 outputBytes);
+    void queueOversizedTiers();
+    void finish(bool ok, const QString &errorLog);
+
+    QString m_program;
+    EncodePlan m_plan;
+    int m_stage = -1;
+    int m_retries = 0;
+    QList<EncodePlan> m_followUps;  // run after the current plan succeeds
+    int m_generation = 0;           // bumped to ignore signals from stopped steps
+    QList<Step> m_steps;
+
+    double m_totalCost = 0.0;
+    double m_doneCost = 0.0;        // of finished stages
+
+    int m_threadBudget = 0;
+    int m_stepThreads = 0;          // -threads of each step in the current stage
+    QList<int> m_cpus;
+    bool m_running = false;
+
+    QElapsedTimer m_elapsed;
+    QElapsedTimer m_sinceLastEmit;
+};
+
+#endif // ENCODESESSION_H
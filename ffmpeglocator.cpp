@@ -0,0 +1,221 @@
+#include "ffmpeglocator.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QProcess>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QDebug>
+
+static constexpr int VERSION_TIMEOUT_MS = 3000;
+
+FfmpegLocator::FfmpegLocator(QObject *parent)
+    : QObject(parent)
+{
+    m_ffmpeg.name = "ffmpeg";
+    m_ffprobe.name = "ffprobe";
+}
+
+bool FfmpegLocator::resolvePaths()
+{
+    QDir binariesDir(QCoreApplication::applicationDirPath() + "/binaries");
+
+    QString ffmpegPath = binariesDir.absoluteFilePath("ffmpeg");
+    QString ffprobePath = binariesDir.absoluteFilePath("ffprobe");
+
+#ifdef Q_OS_WIN
+    ffmpegPath += ".exe";
+    ffprobePath += ".exe";
+#endif
+
+    qDebug() << "Looking for FFmpeg binaries";
+    qDebug() << "ffmpeg candidate:" << ffmpegPath;
+    qDebug() << "ffprobe candidate:" << ffprobePath;
+
+    // Bundled binaries are only used as a pair
+    if (!QFile::exists(ffmpegPath) || !QFile::exists(ffprobePath)) {
+        qDebug() << "Local binaries not found, looking for system FFmpeg";
+        ffmpegPath = QStandardPaths::findExecutable("ffmpeg");
+        ffprobePath = QStandardPaths::findExecutable("ffprobe");
+    }
+
+    m_ffmpeg.path = ffmpegPath;
+    m_ffprobe.path = ffprobePath;
+
+    for (Binary *bin : {&m_ffmpeg, &m_ffprobe}) {
+        bin->validated = false;
+        bin->version.clear();
+        bin->mtimeMs = bin->path.isEmpty()
+                           ? 0
+                           : QFileInfo(bin->path).lastModified().toMSecsSinceEpoch();
+    }
+
+    return !ffmpegPath.isEmpty() && !ffprobePath.isEmpty();
+}
+
+// ----------------- Settings cache -----------------
+
+bool FfmpegLocator::loadCached(Binary &bin)
+{
+    QSettings settings;
+    settings.beginGroup("binaries/" + bin.name);
+
+    if (settings.value("path").toString() != bin.path
+        || settings.value("mtime").toLongLong() != bin.mtimeMs
+        || bin.mtimeMs == 0)
+        return false;
+
+    bin.version = settings.value("version").toString();
+    bin.validated = true;
+    return true;
+}
+
+void FfmpegLocator::storeCached(const Binary &bin)
+{
+    QSettings settings;
+    settings.beginGroup("binaries/" + bin.name);
+    settings.setValue("path", bin.path);
+    settings.setValue("mtime", bin.mtimeMs);
+    settings.setValue("version", bin.version);
+}
+
+QString FfmpegLocator::firstLine(const QByteArray &output)
+{
+    return QString::fromLocal8Bit(output.left(output.indexOf('\n'))).trimmed();
+}
+
+// ----------------- Async validation -----------------
+
+void FfmpegLocator::start()
+{
+    m_pending = 0;
+    m_failed = false;
+
+    if (!resolvePaths()) {
+        m_failed = true;
+        QTimer::singleShot(0, this, &FfmpegLocator::finishIfDone);
+        return;
+    }
+
+    for (Binary *bin : {&m_ffmpeg, &m_ffprobe}) {
+        if (loadCached(*bin)) {
+            qDebug() << "Using cached" << bin->name << bin->path << bin->version;
+            continue;
+        }
+
+        ++m_pending;
+        validate(*bin);
+    }
+
+    // Keep the signal asynchronous even when everything came from the cache
+    if (m_pending == 0)
+        QTimer::singleShot(0, this, &FfmpegLocator::finishIfDone);
+}
+
+void FfmpegLocator::validate(Binary &bin)
+{
+    auto *process = new QProcess(this);
+    bin.process = process;
+
+    Binary *b = &bin;
+
+    connect(process, &QProcess::finished,
+            this, [this, b, process](int exitCode, QProcess::ExitStatus status) {
+                onValidated(*b, status == QProcess::NormalExit && exitCode == 0,
+                            process->readAllStandardOutput());
+            });
+
+    connect(process, &QProcess::errorOccurred,
+            this, [this, b](QProcess::ProcessError error) {
+                if (error == QProcess::FailedToStart)
+                    onValidated(*b, false, QByteArray());
+            });
+
+    QTimer::singleShot(VERSION_TIMEOUT_MS, process, [process] {
+        process->kill();
+    });
+
+    process->start(bin.path, {"-version"});
+}
+
+void FfmpegLocator::onValidated(Binary &bin, bool ok, const QByteArray &output)
+{
+    // finished and errorOccurred can both fire for one process
+    if (!bin.process)
+        return;
+
+    bin.process->deleteLater();
+    bin.process = nullptr;
+    --m_pending;
+
+    qDebug() << "Validated" << bin.name << ":" << ok;
+
+    if (ok) {
+        bin.version = firstLine(output);
+        bin.validated = true;
+        storeCached(bin);
+    } else {
+        m_failed = true;
+    }
+
+    finishIfDone();
+}
+
+void FfmpegLocator::finishIfDone()
+{
+    if (m_pending > 0)
+        return;
+
+    if (m_failed || !m_ffmpeg.validated || !m_ffprobe.validated) {
+        emit failed("FFmpeg binaries not found!");
+        return;
+    }
+
+    emit located(m_ffmpeg.path, m_ffprobe.path);
+}
+
+// ----------------- Blocking (headless) -----------------
+
+bool FfmpegLocator::locateBlocking()
+{
+    if (!resolvePaths())
+        return false;
+
+    QList<Binary *> toCheck;
+    for (Binary *bin : {&m_ffmpeg, &m_ffprobe}) {
+        if (!loadCached(*bin))
+            toCheck << bin;
+    }
+
+    // Start both before waiting on either
+    QList<QProcess *> processes;
+    for (Binary *bin : toCheck) {
+        auto *process = new QProcess(this);
+        process->start(bin->path, {"-version"});
+        processes << process;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < toCheck.size(); ++i) {
+        Binary *bin = toCheck.at(i);
+        QProcess *process = processes.at(i);
+
+        if (process->waitForFinished(VERSION_TIMEOUT_MS) && process->exitCode() == 0) {
+            bin->version = firstLine(process->readAllStandardOutput());
+            bin->validated = true;
+            storeCached(*bin);
+        } else {
+            process->kill();
+            process->waitForFinished();
+            ok = false;
+        }
+
+        delete process;
+    }
+
+    return ok;
+}
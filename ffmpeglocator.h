@@ -0,0 +1,62 @@
+#ifndef FFMPEGLOCATOR_H
+#define FFMPEGLOCATOR_H
+
+#include <QObject>
+#include <QString>
+
+class QProcess;
+
+// Finds ffmpeg/ffprobe without blocking the caller.
+//
+// Bundled binaries next to the executable win over the ones on PATH.
+// Validated paths are remembered in QSettings together with the binary's
+// mtime and version string, so a warm start never spawns anything; the
+// cache entry is invalidated as soon as the binary changes on disk.
+// On a cold start both "-version" checks run concurrently.
+class FfmpegLocator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FfmpegLocator(QObject *parent = nullptr);
+
+    void start();
+
+    QString ffmpegPath() const { return m_ffmpeg.path; }
+    QString ffprobePath() const { return m_ffprobe.path; }
+    QString ffmpegVersion() const { return m_ffmpeg.version; }
+    QString ffprobeVersion() const { return m_ffprobe.version; }
+
+    // Resolves both binaries synchronously (for headless use)
+    bool locateBlocking();
+
+signals:
+    void located(const QString &ffmpegPath, const QString &ffprobePath);
+    void failed(const QString &error);
+
+private:
+    struct Binary {
+        QString name;
+        QString path;
+        QString version;
+        qint64 mtimeMs = 0;
+        bool validated = false;
+        QProcess *process = nullptr;
+    };
+
+    bool resolvePaths();
+    static bool loadCached(Binary &bin);
+    static void storeCached(const Binary &bin);
+    static QString firstLine(const QByteArray &output);
+
+    void validate(Binary &bin);
+    void onValidated(Binary &bin, bool ok, const QByteArray &output);
+    void finishIfDone();
+
+    Binary m_ffmpeg;
+    Binary m_ffprobe;
+    int m_pending = 0;
+    bool m_failed = false;
+};
+
+#endif // FFMPEGLOCATOR_H
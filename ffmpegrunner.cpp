@@ -0,0 +1,206 @@
+#include "ffmpegrunner.h"
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QThread>
+#include <QMutex>
+#include <QSet>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+static constexpr qsizetype ERROR_TAIL_BYTES = 4096;
+static constexpr qsizetype READ_CHUNK_BYTES = 4096;
+
+// Live runners, so shutdown can kill their processes before the
+// I/O thread stops (their deleteLater would never run after that)
+static QMutex s_runnersMutex;
+static QSet<FfmpegRunner *> s_runners;
+
+QThread *FfmpegRunner::ioThread()
+{
+    static QThread *thread = [] {
+        auto *t = new QThread;
+        t->setObjectName("ffmpeg-io");
+        t->start();
+
+        auto *context = new QObject;
+        context->moveToThread(t);
+
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, t, [t, context] {
+            QMetaObject::invokeMethod(context, [] {
+                QMutexLocker lock(&s_runnersMutex);
+                for (FfmpegRunner *runner : std::as_const(s_runners))
+                    runner->doCancel();
+            }, Qt::BlockingQueuedConnection);
+
+            t->quit();
+            t->wait();
+        }, Qt::DirectConnection);
+
+        return t;
+    }();
+
+    return thread;
+}
+
+FfmpegRunner::FfmpegRunner()
+{
+    m_readBuffer.resize(READ_CHUNK_BYTES);
+    moveToThread(ioThread());
+
+    QMutexLocker lock(&s_runnersMutex);
+    s_runners.insert(this);
+}
+
+FfmpegRunner::~FfmpegRunner()
+{
+    {
+        QMutexLocker lock(&s_runnersMutex);
+        s_runners.remove(this);
+    }
+
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+}
+
+void FfmpegRunner::start(const QString &program,
+                         const QStringList &arguments,
+                         qint64 expectedDurationUs)
+{
+    QMetaObject::invokeMethod(this, [=] {
+        doStart(program, arguments, expectedDurationUs);
+    }, Qt::QueuedConnection);
+}
+
+void FfmpegRunner::cancel()
+{
+    QMetaObject::invokeMethod(this, &FfmpegRunner::doCancel, Qt::QueuedConnection);
+}
+
+// ----------------- I/O thread -----------------
+
+void FfmpegRunner::doStart(const QString &program,
+                           const QStringList &arguments,
+                           qint64 expectedDurationUs)
+{
+    if (m_process) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->deleteLater();
+    }
+
+    m_parser.reset();
+    m_parser.setExpectedDurationUs(expectedDurationUs);
+    m_errorTail.clear();
+    m_cancelled = false;
+    m_sinceLastEmit.invalidate();
+
+    m_process = new QProcess(this);
+    m_process->setProgram(program);
+    m_process->setArguments(arguments);
+    m_process->setProcessChannelMode(QProcess::SeparateChannels);
+
+#ifdef Q_OS_LINUX
+    if (!m_cpus.isEmpty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : std::as_const(m_cpus))
+            CPU_SET(cpu, &set);
+
+        // Runs in the forked child before exec; FFmpeg and all its
+        // threads inherit the mask.
+        m_process->setChildProcessModifier([set] {
+            sched_setaffinity(0, sizeof(set), &set);
+        });
+    }
+#endif
+
+    connect(m_process, &QProcess::readyReadStandardOutput,
+            this, &FfmpegRunner::onProgressOutput);
+    connect(m_process, &QProcess::readyReadStandardError,
+            this, &FfmpegRunner::onErrorOutput);
+    connect(m_process, &QProcess::finished,
+            this, &FfmpegRunner::onProcessFinished);
+    connect(m_process, &QProcess::errorOccurred,
+            this, [this](QProcess::ProcessError error) {
+                if (error == QProcess::FailedToStart) {
+                    m_errorTail = "Could not start " + m_process->program().toLocal8Bit();
+                    onProcessFinished();
+                }
+            });
+
+    m_process->start();
+    emit started();
+}
+
+void FfmpegRunner::doCancel()
+{
+    if (!m_process || m_process->state() == QProcess::NotRunning)
+        return;
+
+    m_cancelled = true;
+    m_process->kill();
+}
+
+void FfmpegRunner::onProgressOutput()
+{
+    // Read into a reused buffer instead of allocating a QByteArray per chunk
+    bool completed = false;
+    qint64 n = 0;
+    while ((n = m_process->read(m_readBuffer.data(), m_readBuffer.size())) > 0)
+        completed |= m_parser.feed(m_readBuffer.constData(), n);
+
+    if (!completed)
+        return;
+
+    const EncodeProgress &p = m_parser.current();
+
+    if (p.finished
+        || !m_sinceLastEmit.isValid()
+        || m_sinceLastEmit.elapsed() >= m_progressIntervalMs) {
+        m_sinceLastEmit.start();
+        emit progress(p);
+    }
+}
+
+void FfmpegRunner::onErrorOutput()
+{
+    m_errorTail += m_process->readAllStandardError();
+    if (m_errorTail.size() > ERROR_TAIL_BYTES)
+        m_errorTail = m_errorTail.right(ERROR_TAIL_BYTES);
+}
+
+void FfmpegRunner::onProcessFinished()
+{
+    if (!m_process)
+        return;
+
+    // Drain whatever is left on both pipes
+    if (m_process->state() == QProcess::NotRunning) {
+        m_process->setReadChannel(QProcess::StandardOutput);
+        onProgressOutput();
+        onErrorOutput();
+    }
+
+    const bool ok = !m_cancelled
+                    && m_process->error() != QProcess::FailedToStart
+                    && m_process->exitStatus() == QProcess::NormalExit
+                    && m_process->exitCode() == 0;
+
+    QString errorLog = QString::fromLocal8Bit(m_errorTail).trimmed();
+    if (m_cancelled)
+        errorLog = "Cancelled";
+    else if (!ok && errorLog.isEmpty())
+        errorLog = QString("FFmpeg exited with code %1").arg(m_process->exitCode());
+
+    m_process->disconnect(this);
+    m_process->deleteLater();
+    m_process = nullptr;
+
+    emit finished(ok, errorLog);
+}
@@ -0,0 +1,69 @@
+#ifndef FFMPEGRUNNER_H
+#define FFMPEGRUNNER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "progressparser.h"
+
+class QProcess;
+class QThread;
+
+// Runs one FFmpeg process on the shared encode I/O thread.
+//
+// The -progress pipe is parsed there as it arrives, so the GUI thread
+// only sees structured EncodeProgress updates, capped to one per
+// progressInterval() (plus the final one). stderr is kept separately and
+// only its tail is reported when the process fails.
+//
+// Public methods may be called from any thread. Delete with deleteLater().
+class FfmpegRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    FfmpegRunner();
+    ~FfmpegRunner();
+
+    void start(const QString &program,
+               const QStringList &arguments,
+               qint64 expectedDurationUs);
+    void cancel();
+
+    void setProgressInterval(int ms) { m_progressIntervalMs = ms; }
+    int progressInterval() const { return m_progressIntervalMs; }
+
+    // Restricts the process to these logical CPUs (Linux only; ignored
+    // elsewhere). Must be set before start().
+    void setCpuAffinity(const QList<int> &cpus) { m_cpus = cpus; }
+
+    // Thread shared by all runners; started on first use
+    static QThread *ioThread();
+
+signals:
+    void started();
+    void progress(const EncodeProgress &progress);
+    void finished(bool ok, const QString &errorLog);
+
+private:
+    void doStart(const QString &program,
+                 const QStringList &arguments,
+                 qint64 expectedDurationUs);
+    void doCancel();
+    void onProgressOutput();
+    void onErrorOutput();
+    void onProcessFinished();
+
+    QProcess *m_process = nullptr;
+    ProgressParser m_parser;
+    QElapsedTimer m_sinceLastEmit;
+    QByteArray m_errorTail;
+    QByteArray m_readBuffer;
+
+    QList<int> m_cpus;
+    int m_progressIntervalMs = 100;
+    bool m_cancelled = false;
+};
+
+#endif // FFMPEGRUNNER_H
@@ -0,0 +1,54 @@
+#include "fileidentity.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+static constexpr qint64 SAMPLE_BLOCK_SIZE = 16 * 1024;
+
+QString FileIdentity::key() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(canonicalPath.toUtf8());
+    hash.addData(QByteArray::number(size));
+    hash.addData(QByteArray::number(mtimeMs));
+    hash.addData(sampleHash);
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+FileIdentity FileIdentity::of(const QString &filePath)
+{
+    FileIdentity id;
+
+    const QFileInfo fi(filePath);
+    if (!fi.exists() || !fi.isFile())
+        return id;
+
+    QFile file(fi.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return id;
+
+    id.canonicalPath = fi.canonicalFilePath();
+    id.size = fi.size();
+    id.mtimeMs = fi.lastModified().toMSecsSinceEpoch();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(id.size));
+
+    // Head, middle and tail blocks (they overlap on tiny files, which is fine)
+    const qint64 offsets[] = {
+        0,
+        qMax<qint64>(0, id.size / 2 - SAMPLE_BLOCK_SIZE / 2),
+        qMax<qint64>(0, id.size - SAMPLE_BLOCK_SIZE)
+    };
+
+    for (qint64 offset : offsets) {
+        if (!file.seek(offset))
+            return FileIdentity();
+        hash.addData(file.read(SAMPLE_BLOCK_SIZE));
+    }
+
+    id.sampleHash = hash.result();
+    return id;
+}
@@ -0,0 +1,35 @@
+#ifndef FILEIDENTITY_H
+#define FILEIDENTITY_H
+
+#include <QString>
+#include <QByteArray>
+#include <QtGlobal>
+
+// Cheap fingerprint of a media file: canonical path, size, mtime and a
+// hash over a few sampled blocks (head, middle, tail). Good enough to tell
+// a re-recorded or edited file from the one we saw before without reading
+// the whole thing.
+struct FileIdentity {
+    QString canonicalPath;
+    qint64 size = 0;
+    qint64 mtimeMs = 0;
+    QByteArray sampleHash;
+
+    bool isValid() const { return !canonicalPath.isEmpty() && !sampleHash.isEmpty(); }
+
+    // Stable hex key, usable as a file name
+    QString key() const;
+
+    static FileIdentity of(const QString &filePath);
+
+    bool operator==(const FileIdentity &other) const
+    {
+        return canonicalPath == other.canonicalPath
+               && size == other.size
+               && mtimeMs == other.mtimeMs
+               && sampleHash == other.sampleHash;
+    }
+    bool operator!=(const FileIdentity &other) const { return !(*this == other); }
+};
+
+#endif // FILEIDENTITY_H
@@ -0,0 +1,131 @@
+#include "filtergraph.h"
+
+#include <QtGlobal>
+
+#include <cmath>
+
+// Past this, area averaging is as sharp as bicubic and cheaper, and
+// bilinear starts to alias
+static constexpr double AREA_DOWNSCALE_RATIO = 2.0;
+
+QStringList FilterGraph::stages(const VideoFilterSpec &spec)
+{
+    QStringList filters;
+
+    // --- Crop ---
+    // Only a pointer offset for the filters after it
+    const bool cropped = !spec.crop.isEmpty()
+                         && spec.crop != QRect(0, 0, spec.sourceWidth, spec.sourceHeight);
+    const int pictureWidth = cropped ? spec.crop.width() : spec.sourceWidth;
+    const int pictureHeight = cropped ? spec.crop.height() : spec.sourceHeight;
+
+    if (cropped) {
+        filters << QString("crop=%1:%2:%3:%4")
+                       .arg(spec.crop.width())
+                       .arg(spec.crop.height())
+                       .arg(spec.crop.x())
+                       .arg(spec.crop.y());
+    }
+
+    // --- Frame rate ---
+    // First, so dropped frames are never scaled. A rate within a frame
+    // of the source's (30 for 29.97) is the source's own.
+    if (spec.fps > 0) {
+        const bool unknown = spec.sourceFps <= 0.0;
+        const bool lower = spec.fps < std::floor(spec.sourceFps);
+        const bool higher = spec.fps > std::ceil(spec.sourceFps);
+
+        if (unknown || lower || higher)
+            filters << QString("fps=%1").arg(spec.fps);
+    }
+
+    // --- Denoise ---
+    // At the picture's own size: noise scaled down first is harder to
+    // tell from detail
+    const QString denoiser = FilterGraph::denoiser(spec.denoise);
+    if (!denoiser.isEmpty())
+        filters << denoiser;
+
+    // --- Size ---
+    const int width = (spec.outWidth > 0 ? spec.outWidth : pictureWidth) / 2 * 2;
+    const int height = (spec.outHeight > 0 ? spec.outHeight : pictureHeight) / 2 * 2;
+    const QString algorithm = scaler(pictureWidth, pictureHeight,
+                                     width, height, spec.scalerBudget);
+
+    if (!algorithm.isEmpty())
+        filters << QString("scale=%1:%2:flags=%3").arg(width).arg(height).arg(algorithm);
+
+    // --- Tone map ---
+    // The costly part runs in float per pixel, so on the scaled picture.
+    // The scaler must not drop a 10-bit source to 8 bits first.
+    if (spec.toneMap) {
+        if (spec.bitDepth > 8)
+            filters << "format=yuv420p10le";
+
+        filters << "zscale=t=linear:npl=100"
+                << "format=gbrpf32le"
+                << "zscale=p=bt709"
+                << "tonemap=tonemap=hable:desat=0"
+                << "zscale=t=bt709:m=bt709:r=tv";
+    }
+
+    // --- Pixel format ---
+    // Negotiated into the scaler's output when there is one; a pass-through
+    // when the source already has it
+    if (!spec.pixelFormat.isEmpty())
+        filters << "format=" + spec.pixelFormat;
+
+    return filters;
+}
+
+QString FilterGraph::scaler(int fromWidth, int fromHeight,
+                            int toWidth, int toHeight,
+                            ScalerBudget budget)
+{
+    if (toWidth <= 0 || toHeight <= 0)
+        return QString();
+
+    if (fromWidth == toWidth && fromHeight == toHeight)
+        return QString();
+
+    // Unknown source size: resize, but don't guess at the ratio
+    if (fromWidth <= 0 || fromHeight <= 0)
+        return "bicubic";
+
+    const double ratio = qMax(double(fromWidth) / toWidth, double(fromHeight) / toHeight);
+
+    if (ratio < 1.0)
+        return budget == ScalerBudget::Quality ? "lanczos" : "bicubic";
+
+    switch (budget) {
+    case ScalerBudget::Fast:
+        return ratio >= AREA_DOWNSCALE_RATIO ? "area" : "bilinear";
+    case ScalerBudget::Balanced:
+        return ratio >= AREA_DOWNSCALE_RATIO ? "area" : "bicubic";
+    case ScalerBudget::Quality:
+        break;
+    }
+    return "lanczos";
+}
+
+QString FilterGraph::denoiser(const QString &level)
+{
+    // luma_spatial:chroma_spatial:luma_tmp:chroma_tmp; "medium" is
+    // hqdn3d's default, "light" half of it
+    if (level == "medium")
+        return "hqdn3d=4:3:6:4.5";
+    if (level == "light")
+        return "hqdn3d=2:1.5:3:2.25";
+    return QString();
+}
+
+ScalerBudget FilterGraph::budgetForPreset(const QString &x264Preset)
+{
+    if (x264Preset == "veryfast" || x264Preset == "faster")
+        return ScalerBudget::Fast;
+
+    if (x264Preset == "medium" || x264Preset == "slow" || x264Preset == "slower")
+        return ScalerBudget::Quality;
+
+    return ScalerBudget::Balanced;
+}
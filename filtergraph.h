@@ -0,0 +1,60 @@
+#ifndef FILTERGRAPH_H
+#define FILTERGRAPH_H
+
+#include <QString>
+#include <QStringList>
+#include <QRect>
+
+// How much time the scaler may take; follows the encoder's preset, whose
+// cost dwarfs the scaler's at the slow end
+enum class ScalerBudget {
+    Fast,                            // bilinear / area
+    Balanced,                        // bicubic / area
+    Quality,                         // lanczos
+};
+
+// One output's picture as the filters see it
+struct VideoFilterSpec {
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    double sourceFps = 0.0;          // 0 = unknown
+    QRect crop;                      // in source pixels; empty = the whole frame
+
+    int outWidth = 0;                // 0 = as source
+    int outHeight = 0;
+    int fps = 0;                     // 0 = as source
+
+    QString pixelFormat = "yuv420p"; // what every player decodes; empty = leave as is
+    ScalerBudget scalerBudget = ScalerBudget::Balanced;
+    QString denoise;                 // level for denoiser(); empty = none
+
+    bool toneMap = false;            // PQ/HLG source to BT.709 SDR
+    int bitDepth = 8;                // the source's, kept through the scaler when tone-mapping
+};
+
+// Builds -vf chains in the cheapest order: bars are cropped away and
+// frames dropped before anything denoises or scales them, and the pixel
+// format is converted in the same swscale pass as the resize. HDR is
+// tone-mapped after the resize, on the smaller picture, with the
+// source's bit depth kept until then so the gradients don't band.
+// Stages that wouldn't change the picture are left out.
+class FilterGraph
+{
+public:
+    // Filters in running order; empty when the source passes as is
+    static QStringList stages(const VideoFilterSpec &spec);
+    static QString chain(const VideoFilterSpec &spec) { return stages(spec).join(','); }
+
+    // swscale algorithm for a resize; empty when nothing is resized
+    static QString scaler(int fromWidth, int fromHeight,
+                          int toWidth, int toHeight,
+                          ScalerBudget budget);
+
+    // hqdn3d for "light" or "medium"; empty for anything else
+    static QString denoiser(const QString &level);
+
+    // Budget that suits an x264 preset; empty = the default ("fast")
+    static ScalerBudget budgetForPreset(const QString &x264Preset);
+};
+
+#endif // FILTERGRAPH_H
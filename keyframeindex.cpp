@@ -0,0 +1,361 @@
+#include "keyframeindex.h"
+
+#include <QProcess>
+#include <QByteArrayView>
+#include <QDebug>
+
+#ifdef CLIP2DISC_HAVE_LIBAV
+#include <QFile>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+}
+#endif
+
+#include <algorithm>
+
+static constexpr int INDEX_TIMEOUT_MS = 120000;
+static constexpr int INDEX_POLL_MS    = 50;
+
+KeyframeIndex KeyframeIndex::build(const QString &ffprobePath,
+                                   const QString &filePath,
+                                   const std::atomic_bool &cancelled,
+                                   QString *error)
+{
+#ifdef CLIP2DISC_HAVE_LIBAV
+    KeyframeIndex index = buildWithLibav(filePath, cancelled, error);
+    if (!index.isEmpty() || cancelled.load())
+        return index;
+
+    qDebug() << "Keyframe index: libavformat failed, falling back to ffprobe";
+#endif
+
+    return buildWithFfprobe(ffprobePath, filePath, cancelled, error);
+}
+
+// ----------------- ffprobe -----------------
+
+KeyframeIndex KeyframeIndex::buildWithFfprobe(const QString &ffprobePath,
+                                              const QString &filePath,
+                                              const std::atomic_bool &cancelled,
+                                              QString *error)
+{
+    KeyframeIndex index;
+
+    QProcess process;
+    process.setProgram(ffprobePath);
+    process.setArguments({
+        "-v", "error",
+        "-select_streams", "v:0",
+        "-show_entries", "format=start_time:packet=pts_time,dts_time,size,flags",
+        "-of", "csv",
+        filePath
+    });
+
+    process.start();
+    if (!process.waitForStarted()) {
+        if (error)
+            *error = "Could not start ffprobe";
+        return index;
+    }
+
+    int waitedMs = 0;
+    while (!process.waitForFinished(INDEX_POLL_MS)) {
+        waitedMs += INDEX_POLL_MS;
+
+        if (cancelled.load() || waitedMs >= INDEX_TIMEOUT_MS) {
+            process.kill();
+            process.waitForFinished();
+            if (error)
+                *error = cancelled.load() ? "Cancelled" : "ffprobe timed out";
+            return index;
+        }
+    }
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        if (error)
+            *error = QString::fromLocal8Bit(process.readAllStandardError()).trimmed();
+        return index;
+    }
+
+    // Lines look like "packet,12.345000,12.312000,48213,K__" (pts, dts,
+    // size, flags) and, last, "format,1.400000"
+    const QByteArray output = process.readAllStandardOutput();
+    qint64 startUs = 0;
+
+    index.m_packets.reserve(output.count('\n'));
+
+    qsizetype pos = 0;
+    while (pos < output.size()) {
+        qsizetype eol = output.indexOf('\n', pos);
+        if (eol < 0)
+            eol = output.size();
+
+        QByteArrayView line = QByteArrayView(output).sliced(pos, eol - pos).trimmed();
+        pos = eol + 1;
+
+        if (line.startsWith("format,")) {
+            bool ok = false;
+            const double v = line.sliced(7).toDouble(&ok);
+            if (ok)
+                startUs = qint64(v * 1e6);
+            continue;
+        }
+
+        if (!line.startsWith("packet,"))
+            continue;
+
+        line = line.sliced(7);
+
+        QByteArrayView fields[4];
+        for (int i = 0; i < 4; ++i) {
+            const qsizetype comma = line.indexOf(',');
+            fields[i] = comma < 0 ? line : line.first(comma);
+            line = comma < 0 ? QByteArrayView() : line.sliced(comma + 1);
+        }
+
+        bool ok = false;
+        double sec = fields[0].toDouble(&ok);
+        if (!ok)
+            sec = fields[1].toDouble(&ok);      // pts is N/A in some raw streams
+        if (!ok)
+            continue;
+
+        Packet packet;
+        packet.ptsUs = qint64(sec * 1e6);
+        packet.size = fields[2].toUInt();
+        packet.keyframe = fields[3].startsWith('K');
+        index.m_packets << packet;
+    }
+
+    for (Packet &packet : index.m_packets)
+        packet.ptsUs -= startUs;
+
+    index.finalize();
+    return index;
+}
+
+// ----------------- libavformat -----------------
+
+#ifdef CLIP2DISC_HAVE_LIBAV
+
+static int interruptCallback(void *opaque)
+{
+    return static_cast<const std::atomic_bool *>(opaque)->load() ? 1 : 0;
+}
+
+KeyframeIndex KeyframeIndex::buildWithLibav(const QString &filePath,
+                                            const std::atomic_bool &cancelled,
+                                            QString *error)
+{
+    KeyframeIndex index;
+
+    AVFormatContext *ctx = avformat_alloc_context();
+    if (!ctx)
+        return index;
+
+    ctx->interrupt_callback.callback = interruptCallback;
+    ctx->interrupt_callback.opaque = const_cast<std::atomic_bool *>(&cancelled);
+
+#ifdef Q_OS_WIN
+    const QByteArray path = filePath.toUtf8();
+#else
+    const QByteArray path = QFile::encodeName(filePath);
+#endif
+
+    if (avformat_open_input(&ctx, path.constData(), nullptr, nullptr) < 0) {
+        if (error)
+            *error = "libavformat could not open the file";
+        return index;
+    }
+
+    // Only the first real video stream is read; the demuxer skips the rest
+    int videoIndex = -1;
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        AVStream *st = ctx->streams[i];
+        if (videoIndex < 0
+            && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO
+            && !(st->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            videoIndex = int(i);
+        } else {
+            st->discard = AVDISCARD_ALL;
+        }
+    }
+
+    if (videoIndex < 0) {
+        if (error)
+            *error = "No video stream";
+        avformat_close_input(&ctx);
+        return index;
+    }
+
+    const AVRational timeBase = ctx->streams[videoIndex]->time_base;
+    const qint64 startUs = ctx->start_time != AV_NOPTS_VALUE ? ctx->start_time : 0;
+
+    AVPacket *pkt = av_packet_alloc();
+    while (!cancelled.load() && av_read_frame(ctx, pkt) >= 0) {
+        if (pkt->stream_index == videoIndex) {
+            const int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if (ts != AV_NOPTS_VALUE) {
+                Packet packet;
+                packet.ptsUs = av_rescale_q(ts, timeBase, AVRational{1, AV_TIME_BASE}) - startUs;
+                packet.size = quint32(pkt->size);
+                packet.keyframe = pkt->flags & AV_PKT_FLAG_KEY;
+                index.m_packets << packet;
+            }
+        }
+        av_packet_unref(pkt);
+    }
+
+    av_packet_free(&pkt);
+    avformat_close_input(&ctx);
+
+    if (cancelled.load()) {
+        if (error)
+            *error = "Cancelled";
+        return KeyframeIndex();
+    }
+
+    index.finalize();
+    return index;
+}
+
+#endif // CLIP2DISC_HAVE_LIBAV
+
+// ----------------- Lookups -----------------
+
+void KeyframeIndex::finalize()
+{
+    m_keyframes.clear();
+    for (const Packet &packet : std::as_const(m_packets)) {
+        if (packet.keyframe)
+            m_keyframes << packet.ptsUs / 1e6;
+    }
+
+    // Packets come in decode order; make the list usable for searching
+    std::sort(m_keyframes.begin(), m_keyframes.end());
+    m_keyframes.erase(std::unique(m_keyframes.begin(), m_keyframes.end()),
+                      m_keyframes.end());
+}
+
+double KeyframeIndex::nearest(double sec) const
+{
+    if (m_keyframes.isEmpty())
+        return sec;
+
+    const auto it = std::lower_bound(m_keyframes.cbegin(), m_keyframes.cend(), sec);
+    if (it == m_keyframes.cbegin())
+        return *it;
+    if (it == m_keyframes.cend())
+        return m_keyframes.last();
+
+    const double after = *it;
+    const double before = *(it - 1);
+    return (sec - before) <= (after - sec) ? before : after;
+}
+
+double KeyframeIndex::atOrAfter(double sec) const
+{
+    const auto it = std::lower_bound(m_keyframes.cbegin(), m_keyframes.cend(), sec);
+    return it != m_keyframes.cend() ? *it : -1.0;
+}
+
+double KeyframeIndex::atOrBefore(double sec) const
+{
+    const auto it = std::upper_bound(m_keyframes.cbegin(), m_keyframes.cend(), sec);
+    return it != m_keyframes.cbegin() ? *(it - 1) : -1.0;
+}
+
+qint64 KeyframeIndex::bytesBetween(double fromSec, double toSec) const
+{
+    if (m_packets.isEmpty())
+        return -1;
+
+    const qint64 fromUs = qint64(fromSec * 1e6);
+    const qint64 toUs = qint64(toSec * 1e6);
+
+    qint64 bytes = 0;
+    for (const Packet &packet : m_packets) {
+        if (packet.ptsUs >= fromUs && packet.ptsUs < toUs)
+            bytes += packet.size;
+    }
+    return bytes;
+}
+
+// ----------------- Serialization -----------------
+
+static void putVarint(QByteArray &out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.append(char((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+static bool getVarint(const char *&p, const char *end, quint64 &v)
+{
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const quint8 byte = quint8(*p++);
+        v |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+QByteArray KeyframeIndex::serialize() const
+{
+    // Consecutive timestamps differ by about a frame and most packets
+    // are small, so the typical record is 4-5 bytes before zlib
+    QByteArray raw;
+    raw.reserve(m_packets.size() * 5 + 8);
+
+    putVarint(raw, quint64(m_packets.size()));
+
+    qint64 prevUs = 0;
+    for (const Packet &packet : m_packets) {
+        const qint64 delta = packet.ptsUs - prevUs;
+        prevUs = packet.ptsUs;
+
+        putVarint(raw, (quint64(delta) << 1) ^ quint64(delta >> 63));   // zigzag
+        putVarint(raw, (quint64(packet.size) << 1) | (packet.keyframe ? 1 : 0));
+    }
+
+    return qCompress(raw);
+}
+
+bool KeyframeIndex::deserialize(const QByteArray &data, KeyframeIndex &index)
+{
+    const QByteArray raw = qUncompress(data);
+    const char *p = raw.constData();
+    const char *end = p + raw.size();
+
+    quint64 count = 0;
+    if (!getVarint(p, end, count) || count > quint64(raw.size()))
+        return false;
+
+    index.m_packets.clear();
+    index.m_packets.reserve(qsizetype(count));
+
+    qint64 prevUs = 0;
+    for (quint64 i = 0; i < count; ++i) {
+        quint64 zigzag = 0, sizeAndFlag = 0;
+        if (!getVarint(p, end, zigzag) || !getVarint(p, end, sizeAndFlag))
+            return false;
+
+        const qint64 delta = qint64(zigzag >> 1) ^ -qint64(zigzag & 1);
+        prevUs += delta;
+
+        Packet packet;
+        packet.ptsUs = prevUs;
+        packet.size = quint32(sizeAndFlag >> 1);
+        packet.keyframe = sizeAndFlag & 1;
+        index.m_packets << packet;
+    }
+
+    index.finalize();
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+#include <atomic>
+
+// Packet timestamps, sizes and keyframe flags of a file's first video
+// stream. Times are relative to the start of the file (the timebase
+// FFmpeg's input -ss uses).
+//
+// Built from packet headers only, nothing is decoded: in-process through
+// libavformat when available, otherwise by listing packets with ffprobe.
+class KeyframeIndex
+{
+public:
+    struct Packet {
+        qint64 ptsUs = 0;
+        quint32 size = 0;
+        bool keyframe = false;
+    };
+
+    KeyframeIndex() = default;
+
+    // Blocking; polls `cancelled` while it works
+    static KeyframeIndex build(const QString &ffprobePath,
+                               const QString &filePath,
+                               const std::atomic_bool &cancelled,
+                               QString *error = nullptr);
+
+    bool isEmpty() const { return m_keyframes.isEmpty(); }
+    const QList<double> &keyframes() const { return m_keyframes; }
+    const QList<Packet> &packets() const { return m_packets; }
+
+    // Keyframe closest to sec, or sec itself if the index is empty
+    double nearest(double sec) const;
+
+    // First keyframe at or after sec / last one at or before it; -1 if none
+    double atOrAfter(double sec) const;
+    double atOrBefore(double sec) const;
+
+    // Bytes of the packets presented in [fromSec, toSec); -1 without packets
+    qint64 bytesBetween(double fromSec, double toSec) const;
+
+    // Compact form: varint-coded deltas, then zlib
+    QByteArray serialize() const;
+    static bool deserialize(const QByteArray &data, KeyframeIndex &index);
+
+private:
+    static KeyframeIndex buildWithFfprobe(const QString &ffprobePath,
+                                          const QString &filePath,
+                                          const std::atomic_bool &cancelled,
+                                          QString *error);
+#ifdef CLIP2DISC_HAVE_LIBAV
+    static KeyframeIndex buildWithLibav(const QString &filePath,
+                                        const std::atomic_bool &cancelled,
+                                        QString *error);
+#endif
+
+    void finalize();
+
+    QList<Packet> m_packets;        // decode order
+    QList<double> m_keyframes;      // sorted, unique, seconds
+};
+
+#endif // KEYFRAMEINDEX_H
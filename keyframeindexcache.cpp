@@ -0,0 +1,119 @@
+#include "keyframeindexcache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QDebug>
+
+static constexpr quint32 INDEX_MAGIC   = 0x4332444b; // "C2DK"
+static constexpr quint32 INDEX_VERSION = 1;
+
+static constexpr int PRUNE_INTERVAL = 16;
+
+KeyframeIndexCache::KeyframeIndexCache(const QString &directory, int maxEntries)
+    : m_directory(directory)
+    , m_maxEntries(qMax(1, maxEntries))
+{
+    if (m_directory.isEmpty()) {
+        m_directory =
+            QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + "/keyframes";
+    }
+
+    QDir().mkpath(m_directory);
+}
+
+QString KeyframeIndexCache::entryPath(const QString &canonicalPath) const
+{
+    const QByteArray name =
+        QCryptographicHash::hash(canonicalPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_directory + "/" + QString::fromLatin1(name) + ".idx";
+}
+
+bool KeyframeIndexCache::lookup(const FileIdentity &id, KeyframeIndex &index)
+{
+    if (!id.isValid())
+        return false;
+
+    const QString path = entryPath(id.canonicalPath);
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION)
+        return false;
+
+    FileIdentity stored;
+    QByteArray data;
+    in >> stored.canonicalPath >> stored.size >> stored.mtimeMs >> stored.sampleHash
+       >> data;
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    if (stored != id) {
+        // Same path, different file: stale
+        file.close();
+        QFile::remove(path);
+        return false;
+    }
+
+    return KeyframeIndex::deserialize(data, index);
+}
+
+void KeyframeIndexCache::store(const FileIdentity &id, const KeyframeIndex &index)
+{
+    if (!id.isValid() || index.isEmpty())
+        return;
+
+    const QByteArray data = index.serialize();
+
+    QSaveFile file(entryPath(id.canonicalPath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Keyframe index cache: cannot write" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << INDEX_MAGIC << INDEX_VERSION;
+    out << id.canonicalPath << id.size << id.mtimeMs << id.sampleHash;
+    out << data;
+
+    if (!file.commit())
+        qDebug() << "Keyframe index cache: commit failed for" << file.fileName();
+
+    QMutexLocker lock(&m_mutex);
+    if (++m_storesSincePrune >= PRUNE_INTERVAL) {
+        m_storesSincePrune = 0;
+        prune();
+    }
+}
+
+void KeyframeIndexCache::prune()
+{
+    QDir dir(m_directory);
+    QFileInfoList entries =
+        dir.entryInfoList({"*.idx"}, QDir::Files, QDir::Time | QDir::Reversed);
+
+    const int excess = entries.size() - m_maxEntries;
+    if (excess <= 0)
+        return;
+
+    for (int i = 0; i < excess; ++i)
+        QFile::remove(entries.at(i).absoluteFilePath());
+
+    qDebug() << "Keyframe index cache: evicted" << excess << "entries";
+}
@@ -0,0 +1,39 @@
+#ifndef KEYFRAMEINDEXCACHE_H
+#define KEYFRAMEINDEXCACHE_H
+
+#include <QString>
+#include <QMutex>
+
+#include "keyframeindex.h"
+#include "fileidentity.h"
+
+// On-disk store of KeyframeIndex data, one file per source path, so a
+// multi-GB recording is only ever indexed once.
+//
+// Same rules as ProbeCache: entries are validated against the full
+// FileIdentity, replaced atomically and evicted oldest first. There is
+// no in-memory layer; an index is loaded once per opened file.
+// Thread-safe.
+class KeyframeIndexCache
+{
+public:
+    explicit KeyframeIndexCache(const QString &directory = QString(),
+                                int maxEntries = 256);
+
+    bool lookup(const FileIdentity &id, KeyframeIndex &index);
+    void store(const FileIdentity &id, const KeyframeIndex &index);
+
+    QString directory() const { return m_directory; }
+
+private:
+    QString entryPath(const QString &canonicalPath) const;
+    void prune();
+
+    QString m_directory;
+    int m_maxEntries;
+
+    QMutex m_mutex;
+    int m_storesSincePrune = 0;
+};
+
+#endif // KEYFRAMEINDEXCACHE_H
@@ -0,0 +1,106 @@
+#include "keyframeindexer.h"
+#include "keyframeindexcache.h"
+#include "fileidentity.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QElapsedTimer>
+#include <QDebug>
+
+KeyframeIndexer::KeyframeIndexer(QObject *parent)
+    : QObject(parent)
+    , m_cache(std::make_shared<KeyframeIndexCache>())
+{
+}
+
+KeyframeIndexer::~KeyframeIndexer()
+{
+    cancel();
+}
+
+bool KeyframeIndexer::isRunning() const
+{
+    return m_watcher && m_watcher->isRunning();
+}
+
+void KeyframeIndexer::cancel()
+{
+    if (m_cancelFlag)
+        m_cancelFlag->store(true);
+    m_cancelFlag.reset();
+
+    if (m_watcher) {
+        m_watcher->disconnect(this);
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+    }
+
+    m_currentFile.clear();
+}
+
+void KeyframeIndexer::index(const QString &filePath)
+{
+    cancel();
+
+    m_currentFile = filePath;
+    m_cancelFlag = std::make_shared<std::atomic_bool>(false);
+
+    m_watcher = new QFutureWatcher<Result>(this);
+
+    QFutureWatcher<Result> *watcher = m_watcher;
+    connect(watcher, &QFutureWatcher<Result>::finished,
+            this, [this, watcher, filePath]() {
+                if (watcher != m_watcher)
+                    return;
+
+                const Result result = watcher->result();
+
+                m_watcher->deleteLater();
+                m_watcher = nullptr;
+                m_cancelFlag.reset();
+                m_currentFile.clear();
+
+                if (!result.index.isEmpty())
+                    emit indexed(filePath, result.index);
+                else
+                    emit indexFailed(filePath, result.error);
+            });
+
+    watcher->setFuture(QtConcurrent::run(&KeyframeIndexer::runIndex,
+                                         m_ffprobePath, filePath,
+                                         m_cache, m_cancelFlag));
+}
+
+// ----------------- Worker -----------------
+
+KeyframeIndexer::Result KeyframeIndexer::runIndex(const QString &ffprobePath,
+                                                  const QString &filePath,
+                                                  const std::shared_ptr<KeyframeIndexCache> &cache,
+                                                  const CancelFlag &cancelled)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const FileIdentity id = FileIdentity::of(filePath);
+
+    Result result;
+    if (cache->lookup(id, result.index)) {
+        result.fromCache = true;
+        qDebug() << "Keyframe index cache hit:" << filePath
+                 << result.index.keyframes().size() << "keyframes";
+        return result;
+    }
+
+    result.index = KeyframeIndex::build(ffprobePath, filePath, *cancelled, &result.error);
+
+    if (!result.index.isEmpty()) {
+        cache->store(id, result.index);
+        qDebug() << "Keyframe index built:" << filePath
+                 << result.index.packets().size() << "packets,"
+                 << result.index.keyframes().size() << "keyframes in"
+                 << timer.elapsed() << "ms";
+    } else if (result.error.isEmpty()) {
+        result.error = "No video packets";
+    }
+
+    return result;
+}
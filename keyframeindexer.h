@@ -0,0 +1,61 @@
+#ifndef KEYFRAMEINDEXER_H
+#define KEYFRAMEINDEXER_H
+
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+
+#include <atomic>
+#include <memory>
+
+#include "keyframeindex.h"
+
+class KeyframeIndexCache;
+
+// Builds the KeyframeIndex of the current source in the background,
+// the same way VideoProber handles probes: one file at a time, a new
+// request abandons the previous one, and results are served from the
+// on-disk KeyframeIndexCache when the file hasn't changed.
+class KeyframeIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KeyframeIndexer(QObject *parent = nullptr);
+    ~KeyframeIndexer();
+
+    void setFfprobePath(const QString &path) { m_ffprobePath = path; }
+
+    void index(const QString &filePath);
+    void cancel();
+
+    bool isRunning() const;
+    QString currentFile() const { return m_currentFile; }
+
+signals:
+    void indexed(const QString &filePath, const KeyframeIndex &index);
+    void indexFailed(const QString &filePath, const QString &error);
+
+private:
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+
+    struct Result {
+        KeyframeIndex index;
+        QString error;
+        bool fromCache = false;
+    };
+
+    static Result runIndex(const QString &ffprobePath,
+                           const QString &filePath,
+                           const std::shared_ptr<KeyframeIndexCache> &cache,
+                           const CancelFlag &cancelled);
+
+    QString m_ffprobePath;
+    QString m_currentFile;
+
+    std::shared_ptr<KeyframeIndexCache> m_cache;
+    CancelFlag m_cancelFlag;
+    QFutureWatcher<Result> *m_watcher = nullptr;
+};
+
+#endif // KEYFRAMEINDEXER_H
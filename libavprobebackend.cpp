@@ -0,0 +1,138 @@
+#include "libavprobebackend.h"
+
+#include <QFile>
+
+#include <mutex>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/pixdesc.h>
+}
+
+// libavformat polls this during blocking I/O; returning 1 aborts it
+static int interruptCallback(void *opaque)
+{
+    return static_cast<const std::atomic_bool *>(opaque)->load() ? 1 : 0;
+}
+
+static QString averror(int code)
+{
+    char buf[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(code, buf, sizeof(buf));
+    return QString::fromUtf8(buf);
+}
+
+LibavProbeBackend::LibavProbeBackend()
+{
+    static std::once_flag once;
+    std::call_once(once, [] {
+        av_log_set_level(AV_LOG_ERROR);
+    });
+}
+
+ProbeResult LibavProbeBackend::probe(const QString &filePath,
+                                     const std::atomic_bool &cancelled) const
+{
+    ProbeResult result;
+
+    AVFormatContext *ctx = avformat_alloc_context();
+    if (!ctx) {
+        result.error = "Out of memory";
+        return result;
+    }
+
+    ctx->interrupt_callback.callback = interruptCallback;
+    ctx->interrupt_callback.opaque =
+        const_cast<std::atomic_bool *>(&cancelled);
+
+    // FFmpeg expects UTF-8 paths on Windows and raw bytes elsewhere
+#ifdef Q_OS_WIN
+    const QByteArray path = filePath.toUtf8();
+#else
+    const QByteArray path = QFile::encodeName(filePath);
+#endif
+
+    int ret = avformat_open_input(&ctx, path.constData(), nullptr, nullptr);
+    if (ret < 0) {
+        // ctx is freed by avformat_open_input on failure
+        result.error = cancelled.load() ? "Probe cancelled" : averror(ret);
+        return result;
+    }
+
+    ret = avformat_find_stream_info(ctx, nullptr);
+    if (ret < 0) {
+        result.error = cancelled.load() ? "Probe cancelled" : averror(ret);
+        avformat_close_input(&ctx);
+        return result;
+    }
+
+    VideoInfo &info = result.info;
+
+    // ---------- FORMAT (container) ----------
+    if (ctx->duration != AV_NOPTS_VALUE)
+        info.duration = double(ctx->duration) / AV_TIME_BASE;
+
+    info.bitrate = ctx->bit_rate / 1000;
+
+    // ---------- STREAMS ----------
+    // av_find_best_stream skips attached pictures (cover art), which
+    // ffprobe lists as just another video stream.
+    const int videoIndex =
+        av_find_best_stream(ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (videoIndex >= 0) {
+        const AVStream *st = ctx->streams[videoIndex];
+        const AVCodecParameters *par = st->codecpar;
+
+        info.videoCodec = QString::fromLatin1(avcodec_get_name(par->codec_id));
+        info.width  = par->width;
+        info.height = par->height;
+
+        // Same field ffprobe reports as r_frame_rate
+        if (st->r_frame_rate.den != 0)
+            info.fps = av_q2d(st->r_frame_rate);
+
+        info.videoBitrate = par->bit_rate / 1000;
+
+        // Same names ffprobe prints; unspecified stays empty
+        if (par->color_trc != AVCOL_TRC_UNSPECIFIED)
+            info.colorTransfer = QString::fromLatin1(av_color_transfer_name(par->color_trc));
+        if (par->color_primaries != AVCOL_PRI_UNSPECIFIED)
+            info.colorPrimaries = QString::fromLatin1(av_color_primaries_name(par->color_primaries));
+        if (par->color_space != AVCOL_SPC_UNSPECIFIED)
+            info.colorSpace = QString::fromLatin1(av_color_space_name(par->color_space));
+
+        if (const char *profile = avcodec_profile_name(par->codec_id, par->profile))
+            info.videoProfile = QString::fromLatin1(profile);
+        info.videoLevel = qMax(0, par->level);
+        if (const char *format = av_get_pix_fmt_name(static_cast<AVPixelFormat>(par->format)))
+            info.pixelFormat = QString::fromLatin1(format);
+
+        const AVRational sar = par->sample_aspect_ratio.num > 0 ? par->sample_aspect_ratio
+                                                                 : st->sample_aspect_ratio;
+        if (sar.num > 0 && sar.den > 0)
+            info.sampleAspectRatio = QString("%1:%2").arg(sar.num).arg(sar.den);
+
+        const AVPixFmtDescriptor *desc =
+            av_pix_fmt_desc_get(static_cast<AVPixelFormat>(par->format));
+        if (par->bits_per_raw_sample > 0)
+            info.bitDepth = par->bits_per_raw_sample;
+        else if (desc)
+            info.bitDepth = desc->comp[0].depth;
+    }
+
+    const int audioIndex =
+        av_find_best_stream(ctx, AVMEDIA_TYPE_AUDIO, -1, videoIndex, nullptr, 0);
+    if (audioIndex >= 0) {
+        const AVCodecParameters *par = ctx->streams[audioIndex]->codecpar;
+
+        info.audioCodec = QString::fromLatin1(avcodec_get_name(par->codec_id));
+        info.audioBitrate = par->bit_rate / 1000;
+    }
+
+    avformat_close_input(&ctx);
+
+    result.ok = true;
+    return result;
+}
@@ -0,0 +1,19 @@
+#ifndef LIBAVPROBEBACKEND_H
+#define LIBAVPROBEBACKEND_H
+
+#include "probebackend.h"
+
+// Reads container and stream parameters in-process through libavformat,
+// skipping the ffprobe spawn and the JSON round trip. Only built when
+// CMake is configured with -DCLIP2DISC_LIBAV_PROBE=ON.
+class LibavProbeBackend : public ProbeBackend
+{
+public:
+    LibavProbeBackend();
+
+    QString name() const override { return "libavformat"; }
+    ProbeResult probe(const QString &filePath,
+                      const std::atomic_bool &cancelled) const override;
+};
+
+#endif // LIBAVPROBEBACKEND_H
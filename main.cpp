@@ -1,10 +1,116 @@
 #include "mainwindow.h"
+#include "singleinstance.h"
+#include "cliencoder.h"
+
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QSettings>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <shellapi.h>
+#endif
+
+// QCoreApplication::arguments() needs an application object, but a
+// forwarding launch should exit before creating one.
+static QStringList rawArguments(int argc, char *argv[])
+{
+    QStringList args;
+
+#ifdef Q_OS_WIN
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+
+    int count = 0;
+    LPWSTR *wargv = CommandLineToArgvW(GetCommandLineW(), &count);
+    for (int i = 0; i < count; ++i)
+        args << QString::fromWCharArray(wargv[i]);
+    LocalFree(wargv);
+#else
+    for (int i = 0; i < argc; ++i)
+        args << QString::fromLocal8Bit(argv[i]);
+#endif
+
+    return args;
+}
+
+#ifdef Q_OS_WIN
+// The executable uses the GUI subsystem; when run from a terminal (and not
+// redirected by a job runner) borrow the parent's console for stdout.
+static void attachParentConsole()
+{
+    if (GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) != FILE_TYPE_UNKNOWN)
+        return;
+
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+}
+#endif
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
+    QCoreApplication::setOrganizationName("clip2disc");
+    QCoreApplication::setApplicationName("clip2disc");
+
+    QCommandLineParser parser;
+    const QCommandLineOption helpOption = parser.addHelpOption();
+    CliEncoder::addOptions(parser);
+
+    QCommandLineOption singleInstanceOption(
+        "single-instance",
+        "Hand files to an already running window instead of opening a new one.");
+    parser.addOption(singleInstanceOption);
+    parser.addPositionalArgument("files", "Video files to open.", "[files...]");
+    parser.parse(rawArguments(argc, argv));
+
+    // ---- Headless mode: no widgets, no window ----
+    if (CliEncoder::isRequested(parser) || parser.isSet(helpOption)) {
+#ifdef Q_OS_WIN
+        attachParentConsole();
+#endif
+        QCoreApplication app(argc, argv);
+
+        if (parser.isSet(helpOption))
+            parser.showHelp(CliEncoder::Success);
+
+        CliEncoder cli;
+        if (!cli.configure(parser))
+            return CliEncoder::UsageError;
+
+        cli.start();
+        return app.exec();
+    }
+
+    const QStringList files = parser.positionalArguments();
+
+    const bool singleInstance =
+        parser.isSet(singleInstanceOption)
+        || QSettings().value("singleInstance", false).toBool();
+
+    if (singleInstance && SingleInstance::forward(files))
+        return 0;
+
     QApplication a(argc, argv);
+
     MainWindow w;
+    w.setStartupTimer(startupTimer);
+
+    SingleInstance instance;
+    if (singleInstance && instance.listen()) {
+        QObject::connect(&instance, &SingleInstance::filesReceived,
+                         &w, &MainWindow::openFiles);
+    }
+
     w.showMaximized();
+
+    if (!files.isEmpty())
+        w.openFiles(files);
+
     return a.exec();
 }
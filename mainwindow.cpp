@@ -2,25 +2,35 @@
 #include "./ui_mainwindow.h"
 #include "videoinfo.h"
 #include "player.h"
+#include "videoprober.h"
+#include "ffmpeglocator.h"
+#include "encodesession.h"
+#include "encodeplan.h"
+#include "keyframeindexer.h"
+#include "sizepredictor.h"
+#include "presettuner.h"
+#include "cropdetector.h"
+#include "clipanalyzer.h"
 
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDesktopServices>
 #include <QUrl>
-#include <QRegularExpression>
 #include <QDebug>
 #include <QTimer>
 #include <QCoreApplication>
 #include <QDir>
 #include <QProcess>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
+#include <QSettings>
+#include <QtConcurrent/QtConcurrentRun>
+
+// The analysis decodes the whole marked range; longer ones are left
+// alone rather than keep a core busy for minutes
+static constexpr double MAX_BACKGROUND_ANALYSIS_SEC = 600.0;
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , ffmpegProcess(new QProcess(this))
 {
     ui->setupUi(this);
 
@@ -37,6 +47,51 @@ MainWindow::MainWindow(QWidget *parent)
     connect(m_player, &Player::requestOpenFile,
             this, &MainWindow::selectInputFile);
 
+    // Probing runs off the UI thread; results arrive via signals
+    m_prober = new VideoProber(this);
+
+    connect(m_prober, &VideoProber::probeFinished,
+            this, &MainWindow::onProbeFinished);
+    connect(m_prober, &VideoProber::probeFailed,
+            this, &MainWindow::onProbeFailed);
+
+    // The keyframe/packet index is built next to the probe, so it's
+    // usually ready by the time the user has marked a range
+    m_indexer = new KeyframeIndexer(this);
+
+    connect(m_indexer, &KeyframeIndexer::indexed,
+            this, &MainWindow::onKeyframesIndexed);
+    connect(m_indexer, &KeyframeIndexer::indexFailed,
+            this, &MainWindow::onKeyframeIndexFailed);
+
+    // The size label starts with bitrate × duration and is replaced by a
+    // measured prediction once a few samples have been encoded
+    m_predictor = new SizePredictor(this);
+
+    connect(m_predictor, &SizePredictor::predicted,
+            this, &MainWindow::onSizePredicted);
+
+    // Bars of ranges too long to profile are looked for on their own
+    m_cropDetector = new CropDetector(this);
+
+    connect(m_cropDetector, &CropDetector::detected,
+            this, &MainWindow::onCropDetected);
+
+    // So is everything else about its content, in one decode
+    m_analyzer = new ClipAnalyzer(this);
+
+    connect(m_analyzer, &ClipAnalyzer::analyzed,
+            this, &MainWindow::onClipAnalyzed);
+    connect(m_analyzer, &ClipAnalyzer::analysisFailed,
+            this, [this](const QString &filePath, const QString &error) {
+                if (filePath != inputFilePath)
+                    return;
+
+                qDebug() << "Content analysis failed:" << error;
+                m_analysisFailed = true;
+                detectCrop();
+            });
+
     qDebug() << "Application started";
     qDebug() << "App dir:" << QCoreApplication::applicationDirPath();
 
@@ -44,21 +99,51 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->outputButton, &QPushButton::clicked, this, &MainWindow::selectOutputFile);
     connect(ui->startButton, &QPushButton::clicked, this, &MainWindow::startEncoding);
     connect(ui->aboutButton, &QPushButton::clicked, this, &MainWindow::showAboutDialog);
-    connect(ffmpegProcess, &QProcess::readyReadStandardOutput, this, &MainWindow::updateProgress);
 
-    if (!initializeBinaryPaths()) {
-        qDebug() << "FFmpeg initialization failed";
-        ui->inputButton->setEnabled(false);
-        ui->outputButton->setEnabled(false);
-        ui->startButton->setEnabled(false);
-    }
+    // The session's runners parse FFmpeg's output on their own thread;
+    // rate-limited progress snapshots of the whole encode arrive here
+    m_session = new EncodeSession(this);
+    connect(m_session, &EncodeSession::progress, this, &MainWindow::updateProgress);
+    connect(m_session, &EncodeSession::finished, this, &MainWindow::onEncodingFinished);
+    connect(m_session, &EncodeSession::retrying,
+            this, [this](int attempt, int videoBitrateKbps) {
+                ui->progressBar->setValue(0);
+                ui->statusbar->showMessage(
+                    QString("Output too big, encoding again at %1 kbps (retry %2)")
+                        .arg(videoBitrateKbps)
+                        .arg(attempt));
+            });
+    connect(m_session, &EncodeSession::tierRedo,
+            this, [this](const QString &outputPath, int videoBitrateKbps) {
+                ui->progressBar->setValue(0);
+                ui->statusbar->showMessage(
+                    QString("%1 came out too big, encoding it again at %2 kbps")
+                        .arg(QFileInfo(outputPath).fileName())
+                        .arg(videoBitrateKbps));
+            });
+
+    // Discovery is asynchronous (and usually served from QSettings), so
+    // the window paints immediately; file controls unlock once it's done.
+    ui->inputButton->setEnabled(false);
+    ui->outputButton->setEnabled(false);
+    ui->startButton->setEnabled(false);
+
+    m_locator = new FfmpegLocator(this);
+
+    connect(m_locator, &FfmpegLocator::located,
+            this, &MainWindow::onBinariesLocated);
+    connect(m_locator, &FfmpegLocator::failed,
+            this, &MainWindow::onBinariesMissing);
+
+    m_locator->start();
 
     connect(ui->videoBitrateSlider, &QSlider::valueChanged,
             this, [this](int value) {
 
                 m_userAdjustedVideoBitrate = true;
 
-                int percent = (value * 100) / m_sourceInfo.videoBitrate;
+                int percent =
+                    (value * 100) / qMax<qint64>(1, m_sourceInfo.videoBitrate);
 
                 ui->videoBitrateLabel->setText(
                     QString("Bitrate: %1 kbps (%2%)")
@@ -117,152 +202,201 @@ MainWindow::MainWindow(QWidget *parent)
 
     ui->resolutionCombo->setEnabled(false);
 
-    connect(m_player, &Player::trimChanged,
-            this, &MainWindow::updateMarkedDuration);
+    // --- Video encoder ---
+    // H.264 unless asked otherwise: it's the one every Discord client
+    // plays inline. More appear once the FFmpeg build has been checked.
+    m_capsWatcher = new QFutureWatcher<EncoderCaps>(this);
+    connect(m_capsWatcher, &QFutureWatcher<EncoderCaps>::finished,
+            this, &MainWindow::onEncoderCapsDiscovered);
 
-    connect(m_player, &Player::trimChanged,
-            this, [this](qint64, qint64) {
+    populateVideoEncoders();
+
+    connect(ui->videoEncoderCombo, &QComboBox::currentIndexChanged,
+            this, [this](int) {
+                QSettings().setValue("videoEncoder", ui->videoEncoderCombo->currentData());
                 updateEstimatedFileSize();
             });
 
-}
+    // --- Target size (two-pass) ---
+    // Remembered between runs; most people always aim at the same limit
+    {
+        QSettings settings;
+        ui->targetSizeSpin->setValue(settings.value("targetSizeMB", 10.0).toDouble());
+        ui->targetSizeCheck->setChecked(settings.value("fitTargetSize", false).toBool());
+        ui->tiersEdit->setText(settings.value("extraTierSizes").toString());
+        ui->targetSizeSpin->setEnabled(ui->targetSizeCheck->isChecked());
+        ui->tiersEdit->setEnabled(ui->targetSizeCheck->isChecked());
+    }
 
-MainWindow::~MainWindow()
-{
-    delete ui;
-}
+    connect(ui->targetSizeCheck, &QCheckBox::toggled,
+            this, [this](bool checked) {
+                QSettings().setValue("fitTargetSize", checked);
 
-VideoInfo MainWindow::probeVideo(const QString &filePath)
-{
-    VideoInfo info;
+                ui->targetSizeSpin->setEnabled(checked);
+                ui->tiersEdit->setEnabled(checked);
 
-    QProcess process;
-    process.setProgram(ffprobePath);
-    process.setArguments({
-        "-v", "error",
-        "-print_format", "json",
-        "-show_format",
-        "-show_streams",
-        filePath
-    });
+                // The budget decides the video bitrate
+                ui->videoBitrateSlider->setEnabled(!checked && m_sourceInfo.duration > 0);
 
-    process.start();
-    if (!process.waitForFinished(5000))
-        return info;
+                updateEstimatedFileSize();
+            });
 
-    const QByteArray output = process.readAllStandardOutput();
-    const QJsonDocument doc = QJsonDocument::fromJson(output);
+    connect(ui->targetSizeSpin, &QDoubleSpinBox::valueChanged,
+            this, [this](double mb) {
+                QSettings().setValue("targetSizeMB", mb);
+                updateEstimatedFileSize();
+            });
 
-    if (!doc.isObject())
-        return info;
+    connect(ui->tiersEdit, &QLineEdit::editingFinished,
+            this, [this]() {
+                QSettings().setValue("extraTierSizes", ui->tiersEdit->text());
+            });
 
-    const QJsonObject root = doc.object();
+    // --- Time budget (x264 preset) ---
+    {
+        QSettings settings;
+        ui->timeBudgetSpin->setValue(settings.value("timeBudget", 1.0).toDouble());
+        ui->timeBudgetCheck->setChecked(settings.value("useTimeBudget", false).toBool());
+        ui->timeBudgetSpin->setEnabled(ui->timeBudgetCheck->isChecked());
+    }
 
-    // ---------- FORMAT (container) ----------
-    const QJsonObject format = root["format"].toObject();
+    connect(ui->timeBudgetCheck, &QCheckBox::toggled,
+            this, [this](bool checked) {
+                QSettings().setValue("useTimeBudget", checked);
+                ui->timeBudgetSpin->setEnabled(checked);
+            });
 
-    info.duration = format["duration"].toString().toDouble();
+    connect(ui->timeBudgetSpin, &QDoubleSpinBox::valueChanged,
+            this, [](double budget) {
+                QSettings().setValue("timeBudget", budget);
+            });
 
-    // container bitrate (bits/sec → kbps)
-    if (format.contains("bit_rate")) {
-        info.bitrate = format["bit_rate"].toString().toLongLong() / 1000;
-    }
+    // --- Denoise ---
+    ui->denoiseCheck->setChecked(QSettings().value("denoiseWhenTight", false).toBool());
 
-    // ---------- STREAMS ----------
-    const QJsonArray streams = root["streams"].toArray();
+    connect(ui->denoiseCheck, &QCheckBox::toggled,
+            this, [this](bool checked) {
+                QSettings().setValue("denoiseWhenTight", checked);
+            });
 
-    for (const QJsonValue &v : streams) {
-        const QJsonObject s = v.toObject();
-        const QString type = s["codec_type"].toString();
+    // --- Quality report ---
+    ui->qualityCheck->setChecked(QSettings().value("measureQuality", false).toBool());
 
-        if (type == "video") {
-            info.videoCodec = s["codec_name"].toString();
-            info.width  = s["width"].toInt();
-            info.height = s["height"].toInt();
+    connect(ui->qualityCheck, &QCheckBox::toggled,
+            this, [](bool checked) {
+                QSettings().setValue("measureQuality", checked);
+            });
 
-            // FPS (e.g. "30000/1001")
-            const QString fpsStr = s["r_frame_rate"].toString();
-            if (fpsStr.contains("/")) {
-                const auto parts = fpsStr.split("/");
-                const double num = parts.value(0).toDouble();
-                const double den = parts.value(1).toDouble();
-                if (den != 0.0)
-                    info.fps = num / den;
-            }
+    m_cacheWatcher = new QFutureWatcher<bool>(this);
+    connect(m_cacheWatcher, &QFutureWatcher<bool>::finished,
+            this, &MainWindow::onCacheChecked);
 
-            // video bitrate (bits/sec → kbps)
-            if (s.contains("bit_rate")) {
-                info.videoBitrate =
-                    s["bit_rate"].toString().toLongLong() / 1000;
-            }
-        }
-        else if (type == "audio") {
-            info.audioCodec = s["codec_name"].toString();
+    m_qualityWatcher = new QFutureWatcher<QList<QualityScore>>(this);
+    connect(m_qualityWatcher, &QFutureWatcher<QList<QualityScore>>::finished,
+            this, &MainWindow::onQualityMeasured);
 
-            // audio bitrate (bits/sec → kbps)
-            if (s.contains("bit_rate")) {
-                info.audioBitrate =
-                    s["bit_rate"].toString().toLongLong() / 1000;
-            }
-        }
-    }
+    m_noiseWatcher = new QFutureWatcher<NoiseMeasurement>(this);
+    connect(m_noiseWatcher, &QFutureWatcher<NoiseMeasurement>::finished,
+            this, &MainWindow::onNoiseMeasured);
 
-    return info;
-}
+    m_calibrationWatcher = new QFutureWatcher<double>(this);
+    connect(m_calibrationWatcher, &QFutureWatcher<double>::finished,
+            this, &MainWindow::onCalibrationFinished);
 
+    connect(m_player, &Player::trimChanged,
+            this, &MainWindow::updateMarkedDuration);
 
+    connect(m_player, &Player::trimChanged,
+            this, [this](qint64, qint64) {
+                updateEstimatedFileSize();
+                analyzeClip();
+                detectCrop();
+            });
 
-bool MainWindow::initializeBinaryPaths()
-{
-    QString appDir = QCoreApplication::applicationDirPath();
-    QDir binariesDir(appDir + "/binaries");
+    // --- Crop ---
+    ui->cropCheck->setChecked(QSettings().value("cropBlackBars", true).toBool());
 
-    QString ffmpegPath = binariesDir.absoluteFilePath("ffmpeg");
-    QString ffprobePath = binariesDir.absoluteFilePath("ffprobe");
+    connect(ui->cropCheck, &QCheckBox::toggled,
+            this, [this](bool checked) {
+                QSettings().setValue("cropBlackBars", checked);
 
-#ifdef Q_OS_WIN
-    ffmpegPath += ".exe";
-    ffprobePath += ".exe";
-#endif
+                if (checked)
+                    detectCrop();
 
-    qDebug() << "Looking for FFmpeg binaries";
-    qDebug() << "ffmpeg candidate:" << ffmpegPath;
-    qDebug() << "ffprobe candidate:" << ffprobePath;
+                populateResolutions();
+                updateEstimatedFileSize();
+            });
+}
 
-    bool localBinariesExist = QFile::exists(ffmpegPath) && QFile::exists(ffprobePath);
+MainWindow::~MainWindow()
+{
+    delete ui;
+}
 
-    if (localBinariesExist) {
-        this->ffmpegPath = ffmpegPath;
-        this->ffprobePath = ffprobePath;
-        qDebug() << "Using local FFmpeg binaries";
-        return true;
-    }
+void MainWindow::setStartupTimer(const QElapsedTimer &timer)
+{
+    m_startupTimer = timer;
+}
 
-    qDebug() << "Local binaries not found, testing system FFmpeg";
+void MainWindow::paintEvent(QPaintEvent *event)
+{
+    QMainWindow::paintEvent(event);
 
-    QProcess testProcess;
-    testProcess.start("ffmpeg", {"-version"});
-    bool systemFfmpegExists = testProcess.waitForFinished(3000) && testProcess.exitCode() == 0;
+    if (m_firstPaintReported || !m_startupTimer.isValid())
+        return;
 
-    testProcess.start("ffprobe", {"-version"});
-    bool systemFfprobeExists = testProcess.waitForFinished(3000) && testProcess.exitCode() == 0;
+    m_firstPaintReported = true;
 
-    qDebug() << "System ffmpeg:" << systemFfmpegExists;
-    qDebug() << "System ffprobe:" << systemFfprobeExists;
+    const qint64 elapsedMs = m_startupTimer.elapsed();
+    qDebug() << "Time to first paint:" << elapsedMs << "ms";
+    ui->statusbar->showMessage(
+        QString("Started in %1 ms").arg(elapsedMs), 5000);
+}
 
-    if (systemFfmpegExists && systemFfprobeExists) {
-        this->ffmpegPath = "ffmpeg";
-        this->ffprobePath = "ffprobe";
-        return true;
+void MainWindow::onBinariesLocated(const QString &ffmpeg, const QString &ffprobe)
+{
+    ffmpegPath = ffmpeg;
+    ffprobePath = ffprobe;
+
+    qDebug() << "Using ffmpeg:" << ffmpegPath << m_locator->ffmpegVersion();
+    qDebug() << "Using ffprobe:" << ffprobePath << m_locator->ffprobeVersion();
+
+    m_prober->setFfprobePath(ffprobePath);
+    m_indexer->setFfprobePath(ffprobePath);
+    m_predictor->setFfmpegPath(ffmpegPath);
+    m_cropDetector->setFfmpegPath(ffmpegPath);
+    m_analyzer->setFfmpegPath(ffmpegPath);
+    m_outputCache->setEncoder(ffmpegPath, m_locator->ffmpegVersion());
+
+    // Benchmarks take a few seconds, once per FFmpeg binary
+    m_encoderCaps = EncoderCaps::cached(ffmpegPath);
+    if (m_encoderCaps.isValid())
+        populateVideoEncoders();
+    else if (!m_capsWatcher->isRunning())
+        m_capsWatcher->setFuture(QtConcurrent::run(&EncoderCaps::discover, ffmpegPath));
+
+    ui->inputButton->setEnabled(true);
+    ui->outputButton->setEnabled(true);
+    ui->startButton->setEnabled(true);
+
+    // A file chosen while discovery was still running
+    if (!m_pendingInputFile.isEmpty()) {
+        const QString filePath = m_pendingInputFile;
+        m_pendingInputFile.clear();
+        loadInputFile(filePath);
     }
+}
 
-    QMessageBox::critical(this, "Error", "FFmpeg binaries not found!");
-    return false;
+void MainWindow::onBinariesMissing(const QString &error)
+{
+    qDebug() << "FFmpeg initialization failed";
+    QMessageBox::critical(this, "Error", error);
 }
 
 void MainWindow::updateEstimatedFileSize()
 {
     if (!m_player || m_sourceInfo.duration <= 0) {
+        m_predictor->cancel();
         ui->fileSizeLabel->setText("—");
         return;
     }
@@ -286,19 +420,13 @@ void MainWindow::updateEstimatedFileSize()
     // --- Video bitrate (scaled) ---
     int userVideoBitrate = ui->videoBitrateSlider->value();
     int videoBitrate =
-        computeScaledVideoBitrate(userVideoBitrate, outW, outH, fps);
+        EncodePlanner::computeScaledVideoBitrate(userVideoBitrate, outW, outH, fps);
 
     // --- Audio bitrate ---
     int audioBitrate = ui->audioBitrateSlider->isEnabled()
                            ? ui->audioBitrateSlider->value()
                            : m_sourceInfo.audioBitrate;
 
-    double totalBitrateKbps = videoBitrate + audioBitrate;
-    if (totalBitrateKbps <= 0) {
-        ui->fileSizeLabel->setText("—");
-        return;
-    }
-
     // --- Duration (trim-aware) ---
     double durationSec = m_sourceInfo.duration;
     qint64 startMs = m_player->trimStart();
@@ -307,13 +435,87 @@ void MainWindow::updateEstimatedFileSize()
     if (endMs > startMs)
         durationSec = (endMs - startMs) / 1000.0;
 
+    // --- Target size: the budget is the size, the bitrate follows ---
+    if (ui->targetSizeCheck->isChecked()) {
+        const double targetMB = ui->targetSizeSpin->value();
+
+        // Copied and smart-cut video keeps the source's bitrate; only
+        // encoders with a first pass budget from one
+        SourceAnalysis analysis;
+        if (m_keyframesFile == inputFilePath)
+            analysis.keyframes = m_keyframes;
+        const EncodePlan plan = EncodePlanner::plan(m_sourceInfo, settingsFromUi(), analysis);
+
+        QString mode;
+        if (plan.copyVideo)
+            mode = "copied";
+        else if (plan.smartCut)
+            mode = "smart cut";
+        else if (EncodePlanner::videoEncoder(plan.settings.videoEncoder).twoPass)
+            mode = "two-pass";
+        else
+            mode = "single pass";
+
+        ui->fileSizeLabel->setText(
+            QString("File size: ≤ %1 MB (video %2 kbps, %3)")
+                .arg(targetMB, 0, 'f', 1)
+                .arg(plan.videoBitrateKbps)
+                .arg(mode));
+
+        m_predictor->cancel();
+        updateKeyframeSnapping();
+        return;
+    }
+
+    double totalBitrateKbps = videoBitrate + audioBitrate;
+    if (totalBitrateKbps <= 0) {
+        m_predictor->cancel();
+        ui->fileSizeLabel->setText("—");
+        return;
+    }
+
     double sizeMB =
         (totalBitrateKbps * durationSec) / (8.0 * 1024.0);
 
+    const bool measuring = !ffmpegPath.isEmpty() && !m_encoding;
+
     ui->fileSizeLabel->setText(
-        QString("File size: ~%1 MB")
+        QString("File size: ~%1 MB%2")
             .arg(sizeMB, 0, 'f', 1)
+            .arg(measuring ? " (measuring…)" : "")
         );
+
+    // --- Measured prediction (async, cached per plan) ---
+    if (measuring) {
+        SourceAnalysis analysis;
+        if (m_keyframesFile == inputFilePath)
+            analysis.keyframes = m_keyframes;
+
+        m_predictor->predict(EncodePlanner::plan(m_sourceInfo, settingsFromUi(), analysis));
+    }
+
+    // Whether the video could be copied depends on the same inputs
+    updateKeyframeSnapping();
+}
+
+void MainWindow::onSizePredicted(const SizePrediction &prediction)
+{
+    if (m_encoding || ui->targetSizeCheck->isChecked())
+        return;
+
+    constexpr double MB = 1024.0 * 1024.0;
+
+    if (prediction.samples == 0) {
+        ui->fileSizeLabel->setText(
+            QString("File size: %1 MB").arg(prediction.bytes / MB, 0, 'f', 1));
+        return;
+    }
+
+    ui->fileSizeLabel->setText(
+        QString("File size: %1 MB (%2–%3)")
+            .arg(prediction.bytes / MB, 0, 'f', 1)
+            .arg(prediction.lowBytes / MB, 0, 'f', 1)
+            .arg(prediction.highBytes / MB, 0, 'f', 1));
 }
 
 void MainWindow::autoAdjustVideoBitrateForResolution()
@@ -360,21 +562,272 @@ void MainWindow::autoAdjustVideoBitrateForResolution()
 
 void MainWindow::selectInputFile()
 {
-    m_userAdjustedVideoBitrate = false;
-
-    inputFilePath = QFileDialog::getOpenFileName(
+    const QString filePath = QFileDialog::getOpenFileName(
         this,
         "Select Video File",
         "",
         "Videos (*.mp4 *.mkv *.avi *.mov)"
         );
 
-    if (inputFilePath.isEmpty())
+    if (filePath.isEmpty())
         return;
 
+    loadInputFile(filePath);
+}
+
+void MainWindow::openFiles(const QStringList &files)
+{
+    // Bring the existing window forward for the user who just launched us
+    setWindowState((windowState() & ~Qt::WindowMinimized) | Qt::WindowActive);
+    raise();
+    activateWindow();
+
+    m_fileQueue << files;
+
+    if (!isEncoding())
+        loadNextQueuedFile();
+
+    if (!m_fileQueue.isEmpty())
+        ui->statusbar->showMessage(
+            QString("%1 file(s) queued").arg(m_fileQueue.size()));
+}
+
+void MainWindow::loadNextQueuedFile()
+{
+    if (m_fileQueue.isEmpty())
+        return;
+
+    loadInputFile(m_fileQueue.takeFirst());
+}
+
+bool MainWindow::isEncoding() const
+{
+    return m_encoding;
+}
+
+void MainWindow::loadInputFile(const QString &filePath)
+{
+    if (ffprobePath.isEmpty()) {
+        m_pendingInputFile = filePath;
+        return;
+    }
+
+    m_userAdjustedVideoBitrate = false;
+
+    inputFilePath = filePath;
     ui->inputLabel->setPlainText(inputFilePath);
 
-    m_sourceInfo = probeVideo(inputFilePath);
+    // Forget the previous source until the new probe comes back
+    m_sourceInfo = VideoInfo();
+    setEncodingControlsEnabled(false);
+    ui->startButton->setEnabled(false);
+    ui->fileSizeLabel->setText("—");
+    ui->codecLabel->setText("Probing…");
+
+    // ---- Output path ----
+    QFileInfo inputInfo(inputFilePath);
+    outputFilePath =
+        inputInfo.absolutePath() + "/" +
+        inputInfo.completeBaseName() +
+        "-clipped.mp4";
+
+    ui->outputLabel->setPlainText(outputFilePath);
+
+    // ---- Player ----
+    m_player->setSourceFile(inputFilePath);
+
+    // ---- Probe (async, replaces any probe still running) ----
+    m_prober->probe(inputFilePath);
+
+    // ---- Crop (found once the probe has the frame size) ----
+    m_cropDetector->cancel();
+    m_detectedCrop = QRect();
+    ui->cropCheck->setText("Crop black bars");
+
+    // ---- Content profile (likewise) ----
+    m_analyzer->cancel();
+    m_profile = ComplexityProfile();
+    m_profileFile.clear();
+    m_analysisFailed = false;
+
+    // ---- Keyframe index (async, cached per file) ----
+    m_keyframes = KeyframeIndex();
+    m_keyframesFile.clear();
+    m_player->setSnapToKeyframes(false);
+    m_indexer->index(inputFilePath);
+}
+
+void MainWindow::onKeyframesIndexed(const QString &filePath, const KeyframeIndex &index)
+{
+    if (filePath != inputFilePath)
+        return;
+
+    m_keyframes = index;
+    m_keyframesFile = filePath;
+
+    QList<qint64> keyframesMs;
+    keyframesMs.reserve(index.keyframes().size());
+    for (double sec : index.keyframes())
+        keyframesMs << qint64(sec * 1000.0 + 0.5);
+    m_player->setKeyframes(keyframesMs);
+
+    updateKeyframeSnapping();
+
+    if (m_encodeWaitingForIndex) {
+        m_encodeWaitingForIndex = false;
+        ui->statusbar->clearMessage();
+        runEncode(m_pendingEncode);
+    }
+}
+
+void MainWindow::onKeyframeIndexFailed(const QString &filePath, const QString &error)
+{
+    if (filePath != inputFilePath)
+        return;
+
+    qDebug() << "Keyframe index failed:" << filePath << error;
+
+    // Remember the failure; plans just won't split or copy
+    m_keyframes = KeyframeIndex();
+    m_keyframesFile = filePath;
+
+    if (m_encodeWaitingForIndex) {
+        m_encodeWaitingForIndex = false;
+        ui->statusbar->clearMessage();
+        runEncode(m_pendingEncode);
+    }
+}
+
+void MainWindow::updateKeyframeSnapping()
+{
+    if (m_sourceInfo.duration <= 0 || m_keyframes.isEmpty()) {
+        m_player->setSnapToKeyframes(false);
+        return;
+    }
+
+    // Snapping only helps when the export could copy the video
+    SourceAnalysis analysis;
+    analysis.keyframes = m_keyframes;
+
+    const EncodeSettings settings = settingsFromUi();
+    const EncodePlan plan = EncodePlanner::plan(m_sourceInfo, settings, analysis);
+
+    m_player->setSnapToKeyframes(
+        EncodePlanner::videoFitsAsIs(m_sourceInfo, settings, plan, analysis));
+}
+
+void MainWindow::onProbeFinished(const QString &filePath, const VideoInfo &info)
+{
+    if (filePath != inputFilePath)
+        return;
+
+    applySourceInfo(info);
+    ui->startButton->setEnabled(true);
+}
+
+void MainWindow::onProbeFailed(const QString &filePath, const QString &error)
+{
+    if (filePath != inputFilePath)
+        return;
+
+    qDebug() << "Probe failed:" << filePath << error;
+
+    ui->codecLabel->setText("Codecs");
+    QMessageBox::warning(this, "Warning",
+                         "Could not read video information:\n" + error);
+}
+
+void MainWindow::onEncoderCapsDiscovered()
+{
+    m_encoderCaps = m_capsWatcher->result();
+    qDebug() << "Video encoders:" << m_encoderCaps.videoEncoders();
+
+    populateVideoEncoders();
+}
+
+void MainWindow::onCalibrationFinished()
+{
+    EncodeSettings settings = m_pendingEncode;
+
+    // Without a measurement the budget can't be judged; keep the default
+    if (m_calibrationWatcher->result() <= 0.0) {
+        qDebug() << "x264 calibration failed, keeping the default preset";
+        settings.x264Preset = "fast";
+    }
+
+    ui->statusbar->clearMessage();
+    runEncode(settings);
+}
+
+void MainWindow::onNoiseMeasured()
+{
+    // Kept even when it failed, so the encode goes ahead without
+    m_noise = m_noiseWatcher->result();
+
+    ui->statusbar->clearMessage();
+    runEncode(m_pendingEncode);
+}
+
+void MainWindow::onQualityMeasured()
+{
+    QStringList scores;
+    for (const QualityScore &score : m_qualityWatcher->result()) {
+        if (score.isValid())
+            scores << QString("%1p: SSIM %2, PSNR %3 dB")
+                          .arg(score.height)
+                          .arg(score.ssim, 0, 'f', 4)
+                          .arg(score.psnr, 0, 'f', 1);
+    }
+
+    // An encode started meanwhile owns the status bar
+    if (!isEncoding())
+        ui->statusbar->showMessage(scores.isEmpty() ? QString("Quality could not be measured")
+                                                    : scores.join(" | "));
+}
+
+void MainWindow::populateVideoEncoders()
+{
+    static const QList<QPair<QString, QString>> labels {
+        { "libx264", "H.264 (plays everywhere)" },
+        { "libx265", "H.265 / HEVC" },
+        { "libsvtav1", "AV1" },
+        { "libvpx-vp9", "VP9 (WebM)" },
+    };
+
+    const QString current = ui->videoEncoderCombo->count() > 0
+                                ? ui->videoEncoderCombo->currentData().toString()
+                                : QSettings().value("videoEncoder", "libx264").toString();
+
+    const QSignalBlocker blocker(ui->videoEncoderCombo);
+    ui->videoEncoderCombo->clear();
+
+    for (const auto &[encoder, label] : labels) {
+        if (encoder == "libx264" || m_encoderCaps.hasEncoder(encoder))
+            ui->videoEncoderCombo->addItem(label, encoder);
+    }
+
+    // Picks by speed and efficiency; needs the benchmarks
+    if (m_encoderCaps.isValid())
+        ui->videoEncoderCombo->addItem("Auto (smallest that keeps up)", "auto");
+
+    const int index = ui->videoEncoderCombo->findData(current);
+    ui->videoEncoderCombo->setCurrentIndex(qMax(0, index));
+}
+
+void MainWindow::setEncodingControlsEnabled(bool enabled)
+{
+    ui->videoBitrateSlider->setEnabled(enabled && !ui->targetSizeCheck->isChecked());
+    ui->fpsSlider->setEnabled(enabled);
+    ui->audioBitrateSlider->setEnabled(enabled);
+    ui->resolutionCombo->setEnabled(enabled);
+    ui->cropCheck->setEnabled(enabled);
+    ui->denoiseCheck->setEnabled(enabled);
+    ui->videoEncoderCombo->setEnabled(enabled);
+}
+
+void MainWindow::applySourceInfo(const VideoInfo &info)
+{
+    m_sourceInfo = info;
 
     // ---- Static info ----
     ui->durationLabel->setText(
@@ -386,8 +839,9 @@ void MainWindow::selectInputFile()
     //        .arg(m_sourceInfo.height));
 
     ui->codecLabel->setText(
-        QString("V: %1 | A: %2")
+        QString("V: %1%2 | A: %3")
             .arg(m_sourceInfo.videoCodec)
+            .arg(m_sourceInfo.isHdr() ? QString(" HDR") : QString())
             .arg(m_sourceInfo.audioCodec));
 
     ui->fpsLabel->setText(
@@ -399,7 +853,7 @@ void MainWindow::selectInputFile()
 
     ui->videoBitrateSlider->blockSignals(true);
 
-    ui->videoBitrateSlider->setEnabled(true);
+    ui->videoBitrateSlider->setEnabled(!ui->targetSizeCheck->isChecked());
     ui->videoBitrateSlider->setMinimum(1);
     ui->videoBitrateSlider->setMaximum(maxVideoBitrate);
     ui->videoBitrateSlider->setValue(maxVideoBitrate);
@@ -434,10 +888,40 @@ void MainWindow::selectInputFile()
         QString("Audio bitrate: %1 kbps").arg(maxAudioBitrate));
 
     // ---- Resolution ----
+    // A new source starts from its own size
+    m_detectedCrop = QRect();
     ui->resolutionCombo->clear();
+    populateResolutions();
+    ui->resolutionCombo->setEnabled(true);
 
-    int w = m_sourceInfo.width;
-    int h = m_sourceInfo.height;
+    analyzeClip();
+    detectCrop();
+
+    updateEstimatedFileSize();
+
+    // The player may have reported its duration before or after the probe
+    const qint64 endMs = m_player->trimEnd() > 0
+                             ? m_player->trimEnd()
+                             : qint64(m_sourceInfo.duration * 1000);
+    updateMarkedDuration(m_player->trimStart(), endMs);
+}
+
+void MainWindow::populateResolutions()
+{
+    // A new crop arrives while the user edits the trim; what they picked
+    // stays picked
+    const int previousIndex = ui->resolutionCombo->currentIndex();
+    const QString previousRes = ui->resolutionCombo->currentData().toString();
+
+    ui->resolutionCombo->clear();
+
+    // The picture is what's left after the crop
+    const bool cropped = ui->cropCheck->isChecked() && !m_detectedCrop.isEmpty();
+    int w = cropped ? m_detectedCrop.width() : m_sourceInfo.width;
+    int h = cropped ? m_detectedCrop.height() : m_sourceInfo.height;
+
+    if (w <= 0 || h <= 0)
+        return;
 
     // Helper: avoid duplicates using itemData (not visible text)
     auto addIfMissing = [&](const QString &resValue, const QString &resLabel) {
@@ -450,46 +934,122 @@ void MainWindow::selectInputFile()
 
     // Original resolution (pretty label, clean data)
     QString originalRes = QString("%1x%2").arg(w).arg(h);
-    addIfMissing(originalRes, originalRes + " (Original)");
+    addIfMissing(originalRes, originalRes + (cropped ? " (Cropped)" : " (Original)"));
 
-    // Common downscale options
-    if (w >= 1920 && h >= 1080)
-        addIfMissing("1920x1080", "1920x1080");
+    // Common downscale heights, keeping the picture's shape
+    for (int targetHeight : { 1080, 720, 480, 360 }) {
+        if (targetHeight >= h)
+            continue;
 
-    if (w >= 1280 && h >= 720)
-        addIfMissing("1280x720", "1280x720");
+        const int targetWidth = int((qint64(w) * targetHeight / h + 1) / 2 * 2);
+        const QString res = QString("%1x%2").arg(targetWidth).arg(targetHeight);
+        addIfMissing(res, res);
+    }
 
-    if (w >= 854 && h >= 480)
-        addIfMissing("854x480", "854x480");
+    // Default to original; a downscale keeps its size, or the nearest
+    // height when the picture's shape changed
+    int index = 0;
+    if (previousIndex > 0) {
+        const int previousHeight = previousRes.section('x', 1).toInt();
+        int nearest = -1;
+        for (int i = 0; i < ui->resolutionCombo->count(); ++i) {
+            const QString res = ui->resolutionCombo->itemData(i).toString();
+            if (res == previousRes) {
+                index = i;
+                break;
+            }
 
-    if (w >= 640 && h >= 360)
-        addIfMissing("640x360", "640x360");
+            const int distance = qAbs(res.section('x', 1).toInt() - previousHeight);
+            if (nearest < 0 || distance < nearest) {
+                nearest = distance;
+                index = i;
+            }
+        }
+    }
+    ui->resolutionCombo->setCurrentIndex(index);
+}
 
-    // Default to original
-    ui->resolutionCombo->setCurrentIndex(0);
-    ui->resolutionCombo->setEnabled(true);
+void MainWindow::detectCrop()
+{
+    if (!ui->cropCheck->isChecked() || m_sourceInfo.duration <= 0 || inputFilePath.isEmpty())
+        return;
 
-    updateEstimatedFileSize();
+    const double startSec = m_player->trimStart() / 1000.0;
+    const double endSec = m_player->trimEnd() > 0 ? m_player->trimEnd() / 1000.0
+                                                  : m_sourceInfo.duration;
+    if (endSec <= startSec)
+        return;
 
-    // ---- Output path ----
-    QFileInfo inputInfo(inputFilePath);
-    outputFilePath =
-        inputInfo.absolutePath() + "/" +
-        inputInfo.completeBaseName() +
-        "-clipped.mp4";
+    // The background profile sees the bars in its own decode; only
+    // ranges too long for it (or a failed analysis) get a second one
+    if (endSec - startSec <= MAX_BACKGROUND_ANALYSIS_SEC && !m_analysisFailed) {
+        m_cropDetector->cancel();
+        if (m_profileFile == inputFilePath && m_profile.covers(startSec, endSec - startSec))
+            onCropDetected(inputFilePath, m_profile.crop());
+        return;
+    }
 
-    ui->outputLabel->setPlainText(outputFilePath);
+    m_cropDetector->detect(inputFilePath, m_sourceInfo, startSec, endSec - startSec);
+}
 
-    // ---- Player ----
-    m_player->setSourceFile(inputFilePath);
+void MainWindow::onCropDetected(const QString &filePath, const QRect &crop)
+{
+    if (filePath != inputFilePath || crop == m_detectedCrop)
+        return;
+
+    m_detectedCrop = crop;
+
+    ui->cropCheck->setText(crop.isEmpty()
+                               ? QString("Crop black bars")
+                               : QString("Crop black bars (%1x%2)").arg(crop.width()).arg(crop.height()));
+
+    if (ui->cropCheck->isChecked()) {
+        populateResolutions();
+        updateEstimatedFileSize();
+    }
+}
+
+void MainWindow::analyzeClip()
+{
+    if (m_sourceInfo.duration <= 0 || inputFilePath.isEmpty())
+        return;
+
+    const double startSec = m_player->trimStart() / 1000.0;
+    const double endSec = m_player->trimEnd() > 0 ? m_player->trimEnd() / 1000.0
+                                                  : m_sourceInfo.duration;
+    if (endSec <= startSec || m_profile.covers(startSec, endSec - startSec))
+        return;
+
+    if (endSec - startSec > MAX_BACKGROUND_ANALYSIS_SEC) {
+        m_analyzer->cancel();
+        return;
+    }
+
+    m_analysisFailed = false;
+    m_analyzer->analyze(inputFilePath, m_sourceInfo, startSec, endSec - startSec);
+}
+
+void MainWindow::onClipAnalyzed(const QString &filePath, const ComplexityProfile &profile)
+{
+    if (filePath != inputFilePath)
+        return;
+
+    m_profile = profile;
+    m_profileFile = filePath;
 
-    updateMarkedDuration(0, m_sourceInfo.duration * 1000);
+    QList<qint64> cutsMs;
+    cutsMs.reserve(profile.sceneCuts().size());
+    for (double sec : profile.sceneCuts())
+        cutsMs << qint64(sec * 1000.0 + 0.5);
+    m_player->setSceneCuts(cutsMs);
 
+    // The bars come from the same decode
+    detectCrop();
 }
 
 void MainWindow::selectOutputFile()
 {
-    outputFilePath = QFileDialog::getSaveFileName(this, "Select Output File", "", "MP4 Files (*.mp4)");
+    outputFilePath = QFileDialog::getSaveFileName(this, "Select Output File", "", "Videos (*.mp4 *.webm)");
     if (!outputFilePath.isEmpty())
         ui->outputLabel->setPlainText(outputFilePath);
 }
@@ -523,89 +1083,229 @@ void MainWindow::startEncoding()
         return;
     }
 
+    if (m_prober->isRunning() || m_sourceInfo.duration <= 0) {
+        QMessageBox::warning(this, "Warning",
+                             "Video information is not available yet.");
+        return;
+    }
+
     m_player->pause();
 
-    // --- Trim ---
-    qint64 trimStartMs = m_player->trimStart();
-    qint64 trimEndMs   = m_player->trimEnd();
+    // The samples would only slow the encode down
+    m_predictor->cancel();
 
-    bool hasTrim =
-        trimEndMs > trimStartMs &&
-        trimEndMs <= m_sourceInfo.duration * 1000;
+    const EncodeSettings settings = settingsFromUi();
 
-    double trimStartSec = trimStartMs / 1000.0;
-    double trimDurationSec =
-        (trimEndMs - trimStartMs) / 1000.0;
+    m_encoding = true;
+    ui->inputButton->setEnabled(false);
+    ui->outputButton->setEnabled(false);
+    ui->startButton->setEnabled(false);
+    ui->progressBar->setValue(0);
 
-    // --- UI values ---
-    int userVideoBitrate = ui->videoBitrateSlider->value();
-    int audioBitrate     = ui->audioBitrateSlider->value();
-    int fps              = ui->fpsSlider->value();
+    // Wait for the background index if the plan can use it
+    if (EncodePlanner::needsKeyframes(m_sourceInfo, settings)
+        && m_keyframesFile != inputFilePath) {
+        if (m_indexer->currentFile() != inputFilePath)
+            m_indexer->index(inputFilePath);
 
-    QString res = ui->resolutionCombo->currentData().toString();
-    int outW = m_sourceInfo.width;
-    int outH = m_sourceInfo.height;
+        m_pendingEncode = settings;
+        m_encodeWaitingForIndex = true;
+        ui->statusbar->showMessage("Indexing keyframes…");
+        return;
+    }
 
+    runEncode(settings);
+}
+
+EncodeSettings MainWindow::settingsFromUi() const
+{
+    EncodeSettings settings;
+    settings.inputPath = inputFilePath;
+    settings.outputPath = outputFilePath;
+    settings.trimStartMs = m_player->trimStart();
+    settings.trimEndMs = m_player->trimEnd();
+    settings.userVideoBitrateKbps = ui->videoBitrateSlider->value();
+    settings.audioBitrateKbps = ui->audioBitrateSlider->value();
+    settings.fps = ui->fpsSlider->value();
+
+    QString res = ui->resolutionCombo->currentData().toString();
     QStringList parts = res.split("x");
     if (parts.size() == 2) {
-        outW = parts[0].toInt();
-        outH = parts[1].toInt();
+        settings.outWidth = parts[0].toInt();
+        settings.outHeight = parts[1].toInt();
     }
 
-    // --- Scaled video bitrate ---
-    int videoBitrate =
-        computeScaledVideoBitrate(userVideoBitrate, outW, outH, fps);
-    QString videoBitrateArg = QString::number(videoBitrate) + "k";
-    QString fpsArg = QString::number(fps);
-    QString scaleFilter = QString("scale=%1:%2:flags=lanczos")
-                              .arg(outW / 2 * 2)
-                              .arg(outH / 2 * 2);
-
-    // --- CRF tuning ---
-    int crf = 22;
-    if (outH <= 720) crf = 23;
-    if (outH <= 480) crf = 24;
-
-    QStringList args;
-    args << "-y";
-
-    if (hasTrim) {
-        args << "-ss" << QString::number(trimStartSec, 'f', 3)
-        << "-t"  << QString::number(trimDurationSec, 'f', 3);
-        totalDuration = trimDurationSec;
+    // Long clips are split at keyframes and encoded in parallel; streams
+    // that already fit are copied
+    settings.segments = 0;
+
+    if (ui->targetSizeCheck->isChecked())
+        settings.targetSizeBytes = qint64(ui->targetSizeSpin->value() * 1024 * 1024);
+
+    if (ui->cropCheck->isChecked())
+        settings.crop = m_detectedCrop;
+
+    // HDR to SDR, unless this FFmpeg is known to lack zimg
+    settings.toneMapHdr = QSettings().value("toneMapHdr", true).toBool();
+    if (m_encoderCaps.isValid()
+        && !(m_encoderCaps.hasFilter("zscale") && m_encoderCaps.hasFilter("tonemap")))
+        settings.toneMapHdr = false;
+
+    settings.videoEncoder = ui->videoEncoderCombo->currentData().toString();
+    if (settings.videoEncoder == "auto") {
+        // Judged on the format libx264 would get
+        settings.videoEncoder.clear();
+        const EncodePlan reference = EncodePlanner::plan(m_sourceInfo, settings);
+        settings.videoEncoder =
+            m_encoderCaps.chooseEncoder(reference, QSettings().value("speedFloor", 1.0).toDouble());
+    }
+
+    return settings;
+}
+
+QList<qint64> MainWindow::extraTierSizesFromUi() const
+{
+    QList<qint64> sizes;
+    if (!ui->targetSizeCheck->isChecked())
+        return sizes;
+
+    for (const QString &part : ui->tiersEdit->text().split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const double mb = part.trimmed().toDouble(&ok);
+        if (ok && mb > 0)
+            sizes << qint64(mb * 1024 * 1024);
+    }
+    return sizes;
+}
+
+void MainWindow::runEncode(const EncodeSettings &settings)
+{
+    SourceAnalysis analysis;
+    if (m_keyframesFile == settings.inputPath)
+        analysis.keyframes = m_keyframes;
+
+    // Extra sizes come from the same decode; they get their own
+    // <name>-<N>MB.mp4 and a format that suits their budget
+    const QList<qint64> extraTiers = extraTierSizesFromUi();
+
+    EncodePlan plan;
+    if (extraTiers.isEmpty() || settings.targetSizeBytes <= 0) {
+        plan = EncodePlanner::plan(m_sourceInfo, settings, analysis);
     } else {
-        totalDuration = m_sourceInfo.duration;
+        QList<EncodeSettings> tiers { settings };
+        for (qint64 bytes : extraTiers) {
+            EncodeSettings tier = settings;
+            tier.targetSizeBytes = bytes;
+            tier.outputPath = EncodePlanner::tierOutputPath(settings.outputPath, bytes);
+            tier.outWidth = 0;
+            tier.outHeight = 0;
+            tier.fps = 0;
+            tiers << tier;
+        }
+        plan = EncodePlanner::planTiers(m_sourceInfo, tiers, analysis);
     }
+    // --- Denoise ---
+    // The range's noise is measured once; whether it pays depends on
+    // the plan's bitrate
+    if (ui->denoiseCheck->isChecked()
+        && settings.denoise.isEmpty()
+        && !plan.copyVideo && !plan.smartCut) {
+        const QString noiseKey = QString("%1|%2|%3")
+                                     .arg(settings.inputPath)
+                                     .arg(settings.trimStartMs)
+                                     .arg(settings.trimEndMs);
+        if (noiseKey != m_noiseKey) {
+            m_noiseKey = noiseKey;
+            m_noise = NoiseMeasurement();
+            m_pendingEncode = settings;
+            ui->statusbar->showMessage("Measuring noise…");
+            const double startSec = settings.trimStartMs / 1000.0;
+            const double endSec = settings.trimEndMs > 0 ? settings.trimEndMs / 1000.0
+                                                         : m_sourceInfo.duration;
+            m_noiseWatcher->setFuture(QtConcurrent::run([path = ffmpegPath, settings, info = m_sourceInfo,
+                                                         startSec, endSec]() {
+                const std::atomic_bool notCancelled{false};
+                return Denoiser::measure(path, settings.inputPath, info,
+                                         startSec, endSec - startSec, notCancelled);
+            }));
+            return;
+        }
 
-    args << "-i" << inputFilePath;
+        EncodeSettings denoised = settings;
+        denoised.denoise = Denoiser::chooseLevel(
+            plan, m_noise, Denoiser::estimatedEncodeSeconds(plan, m_encoderCaps));
+        if (!denoised.denoise.isEmpty()) {
+            runEncode(denoised);
+            return;
+        }
+    }
+
+    // --- x264 preset (time budget) ---
+    // The first encode at a size measures this machine; later ones pick
+    // the preset right away
+    if (ui->timeBudgetCheck->isChecked()
+        && settings.x264Preset.isEmpty()
+        && !plan.copyVideo && !plan.smartCut
+        && EncodePlanner::videoEncoder(plan.settings.videoEncoder).encoder == "libx264") {
+        const double fps = PresetTuner::calibratedFps(plan.outWidth, plan.outHeight);
+        if (fps <= 0.0) {
+            m_pendingEncode = settings;
+            ui->statusbar->showMessage("Measuring encode speed…");
+            m_calibrationWatcher->setFuture(QtConcurrent::run(&PresetTuner::calibrate, ffmpegPath, plan));
+            return;
+        }
+
+        EncodeSettings tuned = settings;
+        tuned.x264Preset = PresetTuner::choosePreset(plan, fps,
+                                                     ui->timeBudgetSpin->value() * plan.durationSec);
+        runEncode(tuned);
+        return;
+    }
 
-    // --- Video ---
-    args << "-c:v" << "libx264"
-         << "-preset" << "fast"
-         << "-b:v" << videoBitrateArg
-         << "-maxrate" << videoBitrateArg
-         << "-bufsize" << QString::number(videoBitrate * 2) + "k"
-         << "-r" << fpsArg
-         << "-vf" << scaleFilter;
+    totalDurationUs = plan.durationUs();
 
-    // --- Audio ---
-    args << "-c:a" << "aac"
-         << "-b:a" << QString::number(audioBitrate) + "k";
+    // The container decides the suffix (VP9 goes into .webm)
+    if (plan.settings.outputPath != outputFilePath && plan.tiers.isEmpty()) {
+        outputFilePath = plan.settings.outputPath;
+        ui->outputLabel->setPlainText(outputFilePath);
+    }
+
+    // --- Output cache ---
+    // Same source, range and arguments as an earlier export
+    m_encodePlan = plan;
+    ui->statusbar->showMessage("Looking for an earlier export…");
+    m_cacheWatcher->setFuture(QtConcurrent::run([cache = m_outputCache, plan]() {
+        return cache->restore(plan);
+    }));
+}
 
-    // --- MP4 + progress ---
-    args << "-movflags" << "+faststart"
-         << "-progress" << "pipe:1"
-         << "-nostats"
-         << "-loglevel" << "error";
+void MainWindow::onCacheChecked()
+{
+    m_servedFromCache = m_cacheWatcher->result();
+    if (m_servedFromCache) {
+        onEncodingFinished(true, QString());
+        return;
+    }
 
-    args << outputFilePath;
+    ui->statusbar->clearMessage();
+    startSession(m_encodePlan);
+}
 
-    qDebug() << "FFmpeg:" << ffmpegPath << args;
+void MainWindow::startSession(const EncodePlan &plan)
+{
+    qDebug() << "FFmpeg:" << ffmpegPath << plan.segments << "segment(s)"
+             << "copy video:" << plan.copyVideo << "copy audio:" << plan.copyAudio
+             << "smart cut:" << plan.smartCut << "two-pass:" << plan.twoPass
+             << "tiers:" << plan.tiers.size()
+             << "encoder:" << EncodePlanner::videoEncoder(plan.settings.videoEncoder).encoder
+             << "x264 preset:" << plan.settings.x264Preset;
+    for (const EncodeStage &stage : plan.stages) {
+        for (const EncodeStep &step : stage)
+            qDebug() << "  " << step.arguments;
+    }
 
-    ffmpegProcess->setProgram(ffmpegPath);
-    ffmpegProcess->setArguments(args);
-    ffmpegProcess->setProcessChannelMode(QProcess::MergedChannels);
-    ffmpegProcess->start();
+    m_encodeTimer.start();
+    m_session->start(ffmpegPath, plan);
 }
 
 void MainWindow::deleteTrimmedFile(const QString &trimmedFilePath)
@@ -644,70 +1344,78 @@ int MainWindow::getVideoDuration(const QString &filePath)
     return ok ? duration : 0;
 }
 
-void MainWindow::updateProgress()
+void MainWindow::updateProgress(const EncodeProgress &progress)
 {
-    QString text = ffmpegProcess->readAllStandardOutput();
-    qDebug() << "FFmpeg progress:" << text;
-
-    static const QRegularExpression re("out_time_ms=([0-9]+)");
-    QRegularExpressionMatch match = re.match(text);
-
-    if (match.hasMatch() && totalDuration > 0) {
-        qint64 currentMs = match.captured(1).toLongLong();
-        int currentSeconds = currentMs / 1000000;
-
-        int percent = qMin((currentSeconds * 100) / totalDuration, 100);
-
-        if (isTrimming) {
-            percent = percent * 40 / 100;        // 0–40%
-        } else {
-            percent = 40 + percent * 60 / 100;   // 40–100%
-        }
+    int percent = int(progress.percent);
 
-        ui->progressBar->setValue(percent);
+    if (isTrimming) {
+        percent = percent * 40 / 100;        // 0–40%
+    } else {
+        percent = 40 + percent * 60 / 100;   // 40–100%
     }
 
-    // Only finish when NOT trimming
-    if (text.contains("progress=end") && !isTrimming) {
-        qDebug() << "Compression reported progress=end";
-
-        ui->progressBar->setValue(100);
-        ui->inputButton->setEnabled(true);
-        ui->outputButton->setEnabled(true);
-        ui->startButton->setEnabled(true);
+    ui->progressBar->setValue(percent);
 
-        QMessageBox::information(this, "Finished", "Video compressed!");
+    if (progress.etaSec >= 0 && !progress.finished) {
+        ui->statusbar->showMessage(
+            QString("%1 fps | %2x | ETA %3 s")
+                .arg(progress.fps, 0, 'f', 0)
+                .arg(progress.speed, 0, 'f', 2)
+                .arg(progress.etaSec, 0, 'f', 0));
     }
 }
 
-int MainWindow::computeScaledVideoBitrate(int userBitrate,
-                                          int outWidth,
-                                          int outHeight,
-                                          int fps) const
+void MainWindow::onEncodingFinished(bool ok, const QString &errorLog)
 {
-    if (userBitrate <= 0)
-        return 0;
+    m_encoding = false;
 
-    // Reference: 1080p @ 60fps
-    const double refPixels = 1920.0 * 1080.0;
-    const double curPixels = double(outWidth) * outHeight;
+    ui->inputButton->setEnabled(true);
+    ui->outputButton->setEnabled(true);
+    ui->startButton->setEnabled(true);
+    ui->statusbar->clearMessage();
 
-    double resFactor = curPixels / refPixels;
-    resFactor = qBound(0.15, resFactor, 1.0);
+    if (!ok) {
+        qDebug() << "FFmpeg failed:" << errorLog;
+        ui->progressBar->setValue(0);
+        QMessageBox::warning(this, "Error", "Compression failed:\n" + errorLog);
+        return;
+    }
 
-    double fpsFactor = fps / 60.0;
-    fpsFactor = qBound(0.35, fpsFactor, 1.0);
+    qDebug() << "Compression finished";
 
-    int scaled =
-        int(userBitrate * resFactor * fpsFactor);
+    ui->progressBar->setValue(100);
 
-    // Safety clamp
-    scaled = qBound(400, scaled, userBitrate);
+    if (m_servedFromCache) {
+        const OutputCache::Stats stats = m_outputCache->stats();
+        ui->statusbar->showMessage(
+            QString("Copied from an earlier export (cache hit rate %1%, %2 MB saved)")
+                .arg(stats.hitRate() * 100.0, 0, 'f', 0)
+                .arg(stats.bytesSaved / (1024.0 * 1024.0), 0, 'f', 1));
+    } else {
+        m_cacheStore = QtConcurrent::run([cache = m_outputCache, plan = m_encodePlan]() {
+            cache->store(plan);
+        });
+    }
 
-    return scaled;
-}
+    // Scored in the background; the result lands in the status bar and
+    // the quality log
+    if (ui->qualityCheck->isChecked() && !m_servedFromCache && !m_qualityWatcher->isRunning()) {
+        const EncodePlan plan = m_session->plan();
+        const double encodeSec = m_encodeTimer.elapsed() / 1000.0;
+
+        ui->statusbar->showMessage("Measuring quality…");
+        m_qualityWatcher->setFuture(QtConcurrent::run([path = ffmpegPath, plan, encodeSec]() {
+            const std::atomic_bool notCancelled{false};
+            const QList<QualityScore> scores = QualityReport::measure(path, plan, notCancelled);
+            QualityReport::record(plan, scores, encodeSec);
+            return scores;
+        }));
+    }
 
+    QMessageBox::information(this, "Finished", "Video compressed!");
 
+    loadNextQueuedFile();
+}
 
 void MainWindow::showAboutDialog()
 {
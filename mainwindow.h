@@ -3,10 +3,32 @@
 
 #include <QMainWindow>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QRect>
+
+#include <memory>
+
 #include "videoinfo.h"
+#include "progressparser.h"
+#include "keyframeindex.h"
+#include "encodeplan.h"
+#include "encodercaps.h"
+#include "denoiser.h"
+#include "qualityreport.h"
+#include "outputcache.h"
+#include "complexityprofile.h"
 
 // Forward declaration
 class Player;
+class VideoProber;
+class FfmpegLocator;
+class EncodeSession;
+class KeyframeIndexer;
+class SizePredictor;
+class CropDetector;
+class ClipAnalyzer;
+struct SizePrediction;
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -22,32 +44,67 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // Start of process, used to report time to first paint
+    void setStartupTimer(const QElapsedTimer &timer);
+
+public slots:
+    // Files from the command line or a forwarding instance; the first one
+    // is opened unless an encode is running, the rest wait in a queue.
+    void openFiles(const QStringList &files);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
 private slots:
     void selectInputFile();
     void selectOutputFile();
     void startEncoding();
-    void updateProgress();
+    void updateProgress(const EncodeProgress &progress);
+    void onEncodingFinished(bool ok, const QString &errorLog);
     void showAboutDialog();
     void updateEstimatedFileSize();
     void updateMarkedDuration(qint64 startMs, qint64 endMs);
+    void onProbeFinished(const QString &filePath, const VideoInfo &info);
+    void onProbeFailed(const QString &filePath, const QString &error);
+    void onBinariesLocated(const QString &ffmpeg, const QString &ffprobe);
+    void onBinariesMissing(const QString &error);
+    void onKeyframesIndexed(const QString &filePath, const KeyframeIndex &index);
+    void onKeyframeIndexFailed(const QString &filePath, const QString &error);
+    void onSizePredicted(const SizePrediction &prediction);
+    void onEncoderCapsDiscovered();
+    void onCalibrationFinished();
+    void onNoiseMeasured();
+    void onQualityMeasured();
+    void onCacheChecked();
+    void onCropDetected(const QString &filePath, const QRect &crop);
+    void onClipAnalyzed(const QString &filePath, const ComplexityProfile &profile);
 
 private:
     // -------- Helpers --------
-    VideoInfo probeVideo(const QString &filePath);
-    bool initializeBinaryPaths();
+    void loadInputFile(const QString &filePath);
+    void loadNextQueuedFile();
+    bool isEncoding() const;
+    void applySourceInfo(const VideoInfo &info);
+    void setEncodingControlsEnabled(bool enabled);
+    EncodeSettings settingsFromUi() const;
+    QList<qint64> extraTierSizesFromUi() const;
+    void runEncode(const EncodeSettings &settings);
+    void startSession(const EncodePlan &plan);
+    void updateKeyframeSnapping();
     void deleteTrimmedFile(const QString &filePath);
     int getVideoDuration(const QString &filePath);
 
     void autoAdjustVideoBitrateForResolution();
-
-    int computeScaledVideoBitrate(int userBitrate,
-                                  int outWidth,
-                                  int outHeight,
-                                  int fps) const;
+    void populateVideoEncoders();
+    void populateResolutions();
+    void detectCrop();
+    void analyzeClip();
 
     // -------- State --------
     Ui::MainWindow *ui = nullptr;
     Player *m_player = nullptr;
+    VideoProber *m_prober = nullptr;
+    FfmpegLocator *m_locator = nullptr;
 
     VideoInfo m_sourceInfo;
 
@@ -57,14 +114,71 @@ private:
     QString ffmpegInputFile;
     QString ffmpegPath;
     QString ffprobePath;
-
-    QProcess *ffmpegProcess = nullptr;
-
+    QString m_pendingInputFile;
+    QStringList m_fileQueue;
+
+    EncodeSession *m_session = nullptr;
+
+    // Index of the current input, built in the background; encodes that
+    // can use it wait for it
+    KeyframeIndexer *m_indexer = nullptr;
+    KeyframeIndex m_keyframes;
+    QString m_keyframesFile;
+    EncodeSettings m_pendingEncode;
+    bool m_encodeWaitingForIndex = false;
+
+    // Sample encodes behind the file size label
+    SizePredictor *m_predictor = nullptr;
+
+    // Black bars of the marked range; empty until found (or if none)
+    CropDetector *m_cropDetector = nullptr;
+    QRect m_detectedCrop;
+
+    // Content of the marked range from one background decode; empty
+    // until analysed, and for ranges too long to analyse unasked
+    ClipAnalyzer *m_analyzer = nullptr;
+    ComplexityProfile m_profile;
+    QString m_profileFile;
+    bool m_analysisFailed = false;  // crop falls back to CropDetector
+
+    // Encoders of the located FFmpeg and their speed; measured in the
+    // background on first use of a binary
+    EncoderCaps m_encoderCaps;
+    QFutureWatcher<EncoderCaps> *m_capsWatcher = nullptr;
+
+    // Speed of x264 on this machine, measured before the first encode
+    // with a time budget at a given size
+    QFutureWatcher<double> *m_calibrationWatcher = nullptr;
+
+    // Noise of the range last encoded with "Denoise when bits are
+    // tight", measured before its first encode
+    QFutureWatcher<NoiseMeasurement> *m_noiseWatcher = nullptr;
+    NoiseMeasurement m_noise;
+    QString m_noiseKey;
+
+    // Sampled SSIM/PSNR of the last output, scored after it's written
+    // when "Measure quality afterwards" is on
+    QFutureWatcher<QList<QualityScore>> *m_qualityWatcher = nullptr;
+    QElapsedTimer m_encodeTimer;
+
+    // Earlier exports; a repeat is copied instead of encoded. Lookups
+    // and stores hash and copy files, so they run in the background
+    // (and may outlive the window).
+    std::shared_ptr<OutputCache> m_outputCache = std::make_shared<OutputCache>();
+    QFutureWatcher<bool> *m_cacheWatcher = nullptr;
+    QFuture<void> m_cacheStore;
+    EncodePlan m_encodePlan;
+    bool m_servedFromCache = false;
+
+    bool m_encoding = false;
     bool m_userAdjustedVideoBitrate = false;
     bool isTrimming = false;
+    bool m_firstPaintReported = false;
+
+    QElapsedTimer m_startupTimer;
 
     qint64 videoDurationMs = 0;
-    int totalDuration = 0;
+    qint64 totalDurationUs = 0;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,328 @@
+#include "outputcache.h"
+#include "fileidentity.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+static constexpr qint64 DEFAULT_MAX_MB = 2048;
+
+// An entry bigger than this share of the limit would flush everything
+// else; it isn't kept
+static constexpr qint64 MAX_ENTRY_SHARE = 4;
+
+OutputCache::OutputCache(const QString &directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+{
+    if (m_directory.isEmpty()) {
+        m_directory =
+            QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + "/outputs";
+    }
+
+    if (m_maxBytes < 0)
+        m_maxBytes = QSettings().value("outputCacheMB", DEFAULT_MAX_MB).toLongLong() * 1024 * 1024;
+
+    QDir().mkpath(m_directory);
+}
+
+bool OutputCache::isEnabled() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_maxBytes > 0;
+}
+
+void OutputCache::setMaxBytes(qint64 maxBytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_maxBytes = qMax<qint64>(0, maxBytes);
+    prune();
+}
+
+void OutputCache::setEncoder(const QString &ffmpegPath, const QString &version)
+{
+    QMutexLocker lock(&m_mutex);
+
+    // An upgrade in place keeps the path but not the mtime
+    const QFileInfo binary(ffmpegPath);
+    m_encoder = binary.exists()
+                    ? QString("%1|%2|%3").arg(binary.canonicalFilePath())
+                                         .arg(binary.lastModified().toMSecsSinceEpoch())
+                                         .arg(version)
+                    : QString();
+}
+
+QStringList OutputCache::outputPaths(const EncodePlan &plan)
+{
+    if (plan.tiers.isEmpty())
+        return { plan.settings.outputPath };
+
+    QStringList paths;
+    for (const EncodeTier &tier : plan.tiers)
+        paths << tier.settings.outputPath;
+    return paths;
+}
+
+QString OutputCache::key(const EncodePlan &plan, const QString &encoder)
+{
+    if (encoder.isEmpty())
+        return QString();
+
+    const FileIdentity id = FileIdentity::of(plan.settings.inputPath);
+    if (!id.isValid())
+        return QString();
+
+    // Paths that change from one run to the next without changing the
+    // output; outputs first, since they often contain the input's name
+    QList<QPair<QString, QString>> placeholders;
+    const QStringList outputs = outputPaths(plan);
+    for (int i = 0; i < outputs.size(); ++i)
+        placeholders << qMakePair(outputs.at(i), QString("<output%1>").arg(i));
+    placeholders << qMakePair(plan.scratchDir, QString("<scratch>"));
+    placeholders << qMakePair(plan.settings.inputPath, QString("<input>"));
+
+    auto normalized = [&placeholders](QString text) {
+        for (const auto &[from, to] : std::as_const(placeholders)) {
+            if (!from.isEmpty())
+                text.replace(from, to);
+        }
+        return text;
+    };
+
+    QStringList parts {
+        encoder,
+        id.key(),
+        QString("%1|%2|%3").arg(int(plan.hasTrim))
+                           .arg(plan.startSec, 0, 'f', 6)
+                           .arg(plan.durationSec, 0, 'f', 6),
+    };
+
+    for (const EncodeStage &stage : plan.stages) {
+        parts << "stage";
+        for (const EncodeStep &step : stage)
+            parts << normalized(step.arguments.join(QChar(0x1f)));
+    }
+
+    for (const auto &[path, contents] : plan.scratchFiles)
+        parts << normalized(path) << normalized(QString::fromUtf8(contents));
+
+    return QString::fromLatin1(
+        QCryptographicHash::hash(parts.join('\n').toUtf8(), QCryptographicHash::Sha256).toHex());
+}
+
+QString OutputCache::entryPath(const QString &key, int index, const QString &outputPath) const
+{
+    return QString("%1/%2.%3.%4")
+        .arg(m_directory, key)
+        .arg(index)
+        .arg(QFileInfo(outputPath).suffix());
+}
+
+// ----------------- Lookup -----------------
+
+bool OutputCache::restore(const EncodePlan &plan)
+{
+    QString encoder;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_maxBytes <= 0)
+            return false;
+        encoder = m_encoder;
+    }
+
+    const QString k = key(plan, encoder);
+    if (k.isEmpty())
+        return false;
+
+    const QStringList outputs = outputPaths(plan);
+
+    QMutexLocker lock(&m_mutex);
+
+    for (int i = 0; i < outputs.size(); ++i) {
+        if (!QFileInfo::exists(entryPath(k, i, outputs.at(i)))) {
+            count("misses", 1);
+            return false;
+        }
+    }
+
+    qint64 bytes = 0;
+    for (int i = 0; i < outputs.size(); ++i) {
+        const QString entry = entryPath(k, i, outputs.at(i));
+        if (!cloneFile(entry, outputs.at(i))) {
+            qDebug() << "Output cache: cannot write" << outputs.at(i);
+            count("misses", 1);
+            return false;
+        }
+        bytes += QFileInfo(entry).size();
+
+        // Recently used, for the eviction order
+        QFile touched(entry);
+        if (touched.open(QIODevice::Append))
+            touched.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+
+    count("hits", 1);
+    count("bytesSaved", bytes);
+
+    qDebug() << "Output cache: hit" << k << bytes << "bytes";
+    return true;
+}
+
+void OutputCache::store(const EncodePlan &plan)
+{
+    QString encoder;
+    qint64 maxBytes = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        encoder = m_encoder;
+        maxBytes = m_maxBytes;
+    }
+
+    if (maxBytes <= 0)
+        return;
+
+    const QString k = key(plan, encoder);
+    if (k.isEmpty())
+        return;
+
+    const QStringList outputs = outputPaths(plan);
+
+    qint64 bytes = 0;
+    for (const QString &output : outputs)
+        bytes += QFileInfo(output).size();
+    if (bytes <= 0 || bytes > maxBytes / MAX_ENTRY_SHARE)
+        return;
+
+    QMutexLocker lock(&m_mutex);
+
+    for (int i = 0; i < outputs.size(); ++i) {
+        if (!cloneFile(outputs.at(i), entryPath(k, i, outputs.at(i)))) {
+            qDebug() << "Output cache: cannot store" << outputs.at(i);
+            for (int j = 0; j <= i; ++j)
+                QFile::remove(entryPath(k, j, outputs.at(j)));
+            return;
+        }
+    }
+
+    prune();
+}
+
+// ----------------- Stats -----------------
+
+OutputCache::Stats OutputCache::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    QSettings settings;
+    Stats s;
+    s.hits = settings.value("outputCache/hits", 0).toLongLong();
+    s.misses = settings.value("outputCache/misses", 0).toLongLong();
+    s.bytesSaved = settings.value("outputCache/bytesSaved", 0).toLongLong();
+    return s;
+}
+
+// With m_mutex held
+void OutputCache::count(const QString &name, qint64 amount)
+{
+    QSettings settings;
+    const QString settingKey = "outputCache/" + name;
+    settings.setValue(settingKey, settings.value(settingKey, 0).toLongLong() + amount);
+}
+
+// ----------------- Files -----------------
+
+// With m_mutex held
+void OutputCache::prune()
+{
+    // An entry is all the <key>.<n>.<suffix> files of one key; a tier
+    // missing from it would make the rest useless
+    struct Entry {
+        QStringList files;
+        qint64 bytes = 0;
+        QDateTime lastUsed;
+    };
+
+    QHash<QString, Entry> entries;
+    qint64 total = 0;
+
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo &file : files) {
+        Entry &entry = entries[file.fileName().section('.', 0, 0)];
+        entry.files << file.absoluteFilePath();
+        entry.bytes += file.size();
+        entry.lastUsed = qMax(entry.lastUsed, file.lastModified());
+        total += file.size();
+    }
+
+    if (total <= m_maxBytes)
+        return;
+
+    QList<Entry> byAge = entries.values();
+    std::sort(byAge.begin(), byAge.end(), [](const Entry &a, const Entry &b) {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    // Least recently used first
+    int evicted = 0;
+    for (const Entry &entry : std::as_const(byAge)) {
+        if (total <= m_maxBytes)
+            break;
+
+        for (const QString &file : entry.files)
+            QFile::remove(file);
+        total -= entry.bytes;
+        ++evicted;
+    }
+
+    qDebug() << "Output cache: evicted" << evicted << "entries";
+}
+
+bool OutputCache::cloneFile(const QString &from, const QString &to)
+{
+    // Written next to the target, then renamed over it, so a failed
+    // copy never leaves a truncated file under the real name
+    const QString partPath = to + ".part";
+    QFile::remove(partPath);
+
+    bool cloned = false;
+
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    // Copy-on-write clone on btrfs, XFS and friends: instant, no extra space
+    {
+        QFile source(from);
+        QFile target(partPath);
+        if (source.open(QIODevice::ReadOnly) && target.open(QIODevice::WriteOnly)) {
+            cloned = ioctl(target.handle(), FICLONE, source.handle()) == 0;
+            target.close();
+            if (!cloned)
+                QFile::remove(partPath);
+        }
+    }
+#endif
+
+    if (!cloned && !QFile::copy(from, partPath))
+        return false;
+
+    QFile::remove(to);
+    if (!QFile::rename(partPath, to)) {
+        QFile::remove(partPath);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef OUTPUTCACHE_H
+#define OUTPUTCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+
+#include "encodeplan.h"
+
+// Finished encodes kept on disk, so exporting the same clip again with
+// the same trim and settings is a file copy instead of an encode.
+//
+// An entry is addressed by what decides the output: the FFmpeg binary
+// (path, mtime and version), the source's FileIdentity (path, size,
+// mtime and sampled hash), the trim range and the plan's FFmpeg
+// arguments with the input, output and scratch paths taken out. A hit
+// is cloned to the requested paths (a reflink where the file system has
+// them, a copy otherwise). The entries share a size limit; the ones used
+// longest ago go first, all outputs of an entry together. Hits, misses
+// and the bytes hits saved encoding are counted across runs in
+// QSettings. Nothing is cached until the binary is known.
+// Thread-safe; restore() and store() read and copy whole files, so
+// callers keep them off the GUI thread.
+class OutputCache
+{
+public:
+    struct Stats {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 bytesSaved = 0;           // output bytes served instead of encoded
+
+        double hitRate() const { return hits + misses > 0 ? double(hits) / (hits + misses) : 0.0; }
+    };
+
+    // maxBytes < 0 = the "outputCacheMB" setting; 0 disables the cache
+    explicit OutputCache(const QString &directory = QString(), qint64 maxBytes = -1);
+
+    bool isEnabled() const;
+    void setMaxBytes(qint64 maxBytes);
+
+    // The FFmpeg that makes the outputs, as FfmpegLocator found it
+    void setEncoder(const QString &ffmpegPath, const QString &version);
+
+    // Writes the cached outputs of plan to its output paths; false (and
+    // a miss) when there are none
+    bool restore(const EncodePlan &plan);
+
+    // Keeps the outputs of a plan that just finished
+    void store(const EncodePlan &plan);
+
+    Stats stats() const;
+
+    QString directory() const { return m_directory; }
+
+    // Hex key of a plan made by the given binary (see setEncoder); empty
+    // when its source can't be identified
+    static QString key(const EncodePlan &plan, const QString &encoder);
+
+    // Every file a plan writes: each tier's, or settings.outputPath
+    static QStringList outputPaths(const EncodePlan &plan);
+
+private:
+    QString entryPath(const QString &key, int index, const QString &outputPath) const;
+    void count(const QString &name, qint64 amount);
+    void prune();
+
+    static bool cloneFile(const QString &from, const QString &to);
+
+    QString m_directory;
+    qint64 m_maxBytes;
+    QString m_encoder;              // path|mtime|version; empty = unknown
+
+    mutable QMutex m_mutex;
+};
+
+#endif // OUTPUTCACHE_H
@@ -18,26 +18,22 @@ static constexpr qint64 FRAME_STEP_MS = 40; // ~25fps fallback
 Player::Player(QWidget *parent)
     : QWidget(parent)
 {
-    // --- Media objects ---
-    m_player = new QMediaPlayer(this);
-    m_audioOutput = new QAudioOutput(this);
-    m_player->setAudioOutput(m_audioOutput);
-
-    // --- Video widget ---
-    m_videoWidget = new QVideoWidget(this);
-    m_videoWidget->setStyleSheet("background-color: black;");
-    m_player->setVideoOutput(m_videoWidget);
-
     // --- Video container ---
+    // QMediaPlayer, QAudioOutput and QVideoWidget are expensive to create
+    // (backend and audio device initialization), so until a file is opened
+    // the container only shows a black placeholder. See ensureMediaObjects().
     auto *videoContainer = new QWidget(this);
-    auto *videoStack = new QStackedLayout(videoContainer);
-    videoStack->setContentsMargins(0, 0, 0, 0);
-    videoStack->setStackingMode(QStackedLayout::StackAll);
-    videoStack->addWidget(m_videoWidget);
-    videoContainer->setLayout(videoStack);
+    m_videoStack = new QStackedLayout(videoContainer);
+    m_videoStack->setContentsMargins(0, 0, 0, 0);
+    m_videoStack->setStackingMode(QStackedLayout::StackAll);
+
+    m_videoPlaceholder = new QWidget(videoContainer);
+    m_videoPlaceholder->setStyleSheet("background-color: black;");
+    m_videoStack->addWidget(m_videoPlaceholder);
+    videoContainer->setLayout(m_videoStack);
 
     // --- Overlay ---
-    m_overlay = new ClickOverlay(m_videoWidget);
+    m_overlay = new ClickOverlay(videoContainer);
     m_overlay->show();
     m_overlay->raise();
 
@@ -45,40 +41,12 @@ Player::Player(QWidget *parent)
     m_timeline = new TimelineWidget(this);
     m_timeline->setEnabled(false);
 
-    connect(m_player, &QMediaPlayer::durationChanged,
-            m_timeline, &TimelineWidget::setDuration);
-
-    connect(m_player, &QMediaPlayer::mediaStatusChanged,
-            this, [this](QMediaPlayer::MediaStatus status) {
-                if ((status == QMediaPlayer::LoadedMedia || status == QMediaPlayer::BufferedMedia) &&
-                    m_autoPlayPending) {
-                    m_autoPlayPending = false;
-                    m_hasMedia = true;
-                    updateControlsEnabled(true);
-                    m_player->setPosition(m_timeline->startPosition());
-                    play();
-                }
-            });
-
-    connect(m_player, &QMediaPlayer::positionChanged,
+    connect(m_timeline, &TimelineWidget::playPositionChanged,
             this, [this](qint64 pos) {
-                if (m_reachedTrimEnd)
-                    return;
-
-                const qint64 end = m_timeline->endPosition();
-                if (m_player->playbackState() == QMediaPlayer::PlayingState && pos >= end) {
-                    m_player->pause();
-                    m_player->setPosition(end);
-                    m_reachedTrimEnd = true;
-                    m_btnPlayPause->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
-                    return;
-                }
-                m_timeline->setPlayPosition(pos);
+                if (m_player)
+                    m_player->setPosition(pos);
             });
 
-    connect(m_timeline, &TimelineWidget::playPositionChanged,
-            this, [this](qint64 pos) { m_player->setPosition(pos); });
-
     // --- Buttons ---
     m_btnGoToStart = new QPushButton(this);
     m_btnGoToStart->setIcon(style()->standardIcon(QStyle::SP_MediaSkipBackward));
@@ -125,10 +93,10 @@ Player::Player(QWidget *parent)
     m_volumeSlider = new QSlider(Qt::Horizontal, this);
     m_volumeSlider->setRange(0, 100);
     m_volumeSlider->setValue(50);
-    m_audioOutput->setVolume(0.5);
 
     connect(m_volumeSlider, &QSlider::valueChanged, this, [this](int value){
-        m_audioOutput->setVolume(value / 100.0);
+        if (m_audioOutput)
+            m_audioOutput->setVolume(value / 100.0);
     });
 
     QLabel *volumeLabel = new QLabel("🔊", this);
@@ -180,6 +148,63 @@ void Player::resizeEvent(QResizeEvent *event)
     }
 }
 
+// ----------------- Media objects -----------------
+
+void Player::ensureMediaObjects()
+{
+    if (m_player)
+        return;
+
+    m_player = new QMediaPlayer(this);
+    m_audioOutput = new QAudioOutput(this);
+    m_audioOutput->setVolume(m_volumeSlider->value() / 100.0);
+    m_player->setAudioOutput(m_audioOutput);
+
+    // --- Video widget replaces the placeholder ---
+    m_videoWidget = new QVideoWidget;
+    m_videoWidget->setStyleSheet("background-color: black;");
+    m_player->setVideoOutput(m_videoWidget);
+
+    m_videoStack->addWidget(m_videoWidget);
+    m_videoStack->setCurrentWidget(m_videoWidget);
+    m_videoStack->removeWidget(m_videoPlaceholder);
+    m_videoPlaceholder->deleteLater();
+    m_videoPlaceholder = nullptr;
+
+    m_overlay->raise();
+
+    connect(m_player, &QMediaPlayer::durationChanged,
+            m_timeline, &TimelineWidget::setDuration);
+
+    connect(m_player, &QMediaPlayer::mediaStatusChanged,
+            this, [this](QMediaPlayer::MediaStatus status) {
+                if ((status == QMediaPlayer::LoadedMedia || status == QMediaPlayer::BufferedMedia) &&
+                    m_autoPlayPending) {
+                    m_autoPlayPending = false;
+                    m_hasMedia = true;
+                    updateControlsEnabled(true);
+                    m_player->setPosition(m_timeline->startPosition());
+                    play();
+                }
+            });
+
+    connect(m_player, &QMediaPlayer::positionChanged,
+            this, [this](qint64 pos) {
+                if (m_reachedTrimEnd)
+                    return;
+
+                const qint64 end = m_timeline->endPosition();
+                if (m_player->playbackState() == QMediaPlayer::PlayingState && pos >= end) {
+                    m_player->pause();
+                    m_player->setPosition(end);
+                    m_reachedTrimEnd = true;
+                    m_btnPlayPause->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
+                    return;
+                }
+                m_timeline->setPlayPosition(pos);
+            });
+}
+
 // ----------------- UI State -----------------
 
 void Player::updateControlsEnabled(bool enabled)
@@ -208,6 +233,9 @@ void Player::play()
 
 void Player::pause()
 {
+    if (!m_player)
+        return;
+
     if (!m_player->videoOutput()) {
         m_player->setVideoOutput(m_videoWidget);
     }
@@ -221,6 +249,9 @@ void Player::pause()
 
 void Player::stop()
 {
+    if (!m_player)
+        return;
+
     m_player->stop();
     m_overlay->show();   // just the text is visible
     m_btnPlayPause->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
@@ -265,8 +296,12 @@ void Player::markEndAtCurrentFrame()
 
 void Player::setSource(const QUrl &url)
 {
+    ensureMediaObjects();
+
     m_autoPlayPending = true;
     m_reachedTrimEnd = false;
+    m_timeline->setKeyframes({});
+    m_timeline->setSceneCuts({});
     m_player->setSource(url);
     m_overlay->hide();
 }
@@ -276,8 +311,12 @@ void Player::setSourceFile(const QString &filePath)
     if (filePath.isEmpty())
         return;
 
+    ensureMediaObjects();
+
     m_autoPlayPending = true;
     m_reachedTrimEnd = false;
+    m_timeline->setKeyframes({});
+    m_timeline->setSceneCuts({});
     m_player->setSource(QUrl::fromLocalFile(filePath));
     m_overlay->hide();
 }
@@ -291,3 +330,18 @@ qint64 Player::trimEnd() const
 {
     return m_timeline->endPosition();
 }
+
+void Player::setKeyframes(const QList<qint64> &keyframesMs)
+{
+    m_timeline->setKeyframes(keyframesMs);
+}
+
+void Player::setSnapToKeyframes(bool snap)
+{
+    m_timeline->setSnapToKeyframes(snap);
+}
+
+void Player::setSceneCuts(const QList<qint64> &cutsMs)
+{
+    m_timeline->setSceneCuts(cutsMs);
+}
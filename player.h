@@ -9,6 +9,7 @@ class QMediaPlayer;
 class QAudioOutput;
 class QVideoWidget;
 class QPushButton;
+class QStackedLayout;
 class ClickOverlay;
 class TimelineWidget;
 
@@ -27,6 +28,11 @@ public:
     qint64 trimStart() const;
     qint64 trimEnd() const;
 
+    // Forwarded to the timeline; cleared whenever the source changes
+    void setKeyframes(const QList<qint64> &keyframesMs);
+    void setSnapToKeyframes(bool snap);
+    void setSceneCuts(const QList<qint64> &cutsMs);
+
 signals:
     void trimChanged(qint64 startMs, qint64 endMs);
 
@@ -37,6 +43,7 @@ protected:
     void resizeEvent(QResizeEvent *event) override;
 
 private:
+    void ensureMediaObjects();
     void updateControlsEnabled(bool enabled);
     bool m_hasMedia = false;
 
@@ -53,12 +60,14 @@ private:
     bool m_autoPlayPending = false;
     bool m_reachedTrimEnd  = false;
 
-    // --- Core media objects ---
+    // --- Core media objects (created on first source) ---
     QMediaPlayer   *m_player      = nullptr;
     QAudioOutput   *m_audioOutput = nullptr;
     QVideoWidget   *m_videoWidget = nullptr;
 
     // --- UI ---
+    QStackedLayout *m_videoStack       = nullptr;
+    QWidget        *m_videoPlaceholder = nullptr;
     TimelineWidget *m_timeline        = nullptr;
     ClickOverlay   *m_overlay         = nullptr;
 
@@ -0,0 +1,110 @@
+#include "presettuner.h"
+
+#include <QProcess>
+#include <QSettings>
+#include <QSysInfo>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// Long enough for x264's lookahead to fill, short enough to go unnoticed
+static constexpr double CALIBRATION_SEC        = 3.0;
+static constexpr int    CALIBRATION_TIMEOUT_MS = 60000;
+
+// The first pass runs with fast settings, as the planner assumes
+static constexpr double FIRST_PASS_COST = 0.4;
+
+// Extrapolated presets are rough; leave some of the budget unused
+static constexpr double BUDGET_FILL = 0.85;
+
+QString PresetTuner::calibrationKey(int width, int height)
+{
+    // Per machine: settings can roam, encode speed doesn't
+    return QString("x264Calibration/%1-%2/%3x%4")
+        .arg(QSysInfo::machineHostName())
+        .arg(QThread::idealThreadCount())
+        .arg(width)
+        .arg(height);
+}
+
+double PresetTuner::calibratedFps(int width, int height)
+{
+    return QSettings().value(calibrationKey(width, height), 0.0).toDouble();
+}
+
+double PresetTuner::calibrate(const QString &ffmpegPath, const EncodePlan &plan)
+{
+    if (ffmpegPath.isEmpty() || plan.durationSec <= 0.0 || plan.fps <= 0)
+        return 0.0;
+
+    EncodePlan reference = plan;
+    reference.settings.x264Preset.clear();
+
+    const double rangeStart = plan.hasTrim ? plan.startSec : 0.0;
+    const double length = qMin(CALIBRATION_SEC, plan.durationSec);
+    const double start = rangeStart + (plan.durationSec - length) / 2;
+
+    QProcess process;
+    process.setStandardOutputFile(QProcess::nullDevice());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    process.start(ffmpegPath, EncodePlanner::sampleArguments(reference, start, length));
+    if (!process.waitForFinished(CALIBRATION_TIMEOUT_MS)) {
+        process.kill();
+        process.waitForFinished();
+        return 0.0;
+    }
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+        return 0.0;
+
+    const double elapsedSec = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+    const double fps = length * plan.fps / elapsedSec;
+
+    qDebug() << "x264 calibration:" << plan.outWidth << "x" << plan.outHeight
+             << fps << "fps with fast";
+
+    QSettings().setValue(calibrationKey(plan.outWidth, plan.outHeight), fps);
+    return fps;
+}
+
+double PresetTuner::estimatedSeconds(const EncodePlan &plan, double presetFps)
+{
+    if (presetFps <= 0.0)
+        return 0.0;
+
+    // Tiers are encoded side by side from one decode; their frames are
+    // weighted by size against the calibrated (first) format
+    double frames = plan.durationSec * plan.fps;
+    if (!plan.tiers.isEmpty()) {
+        const double pixels = qMax(1.0, double(plan.outWidth) * plan.outHeight);
+
+        frames = 0.0;
+        for (const EncodeTier &tier : plan.tiers) {
+            const double tierPixels = double(tier.settings.outWidth) * tier.settings.outHeight;
+            frames += plan.durationSec * tier.settings.fps * tierPixels / pixels;
+        }
+    }
+
+    if (plan.twoPass)
+        frames *= 1.0 + FIRST_PASS_COST;
+
+    return frames / presetFps;
+}
+
+QString PresetTuner::choosePreset(const EncodePlan &plan, double fastFps, double budgetSec)
+{
+    const QList<X264Preset> &presets = EncodePlanner::x264Presets();
+
+    QString chosen = presets.first().name;
+    for (const X264Preset &preset : presets) {
+        const double seconds = estimatedSeconds(plan, fastFps * preset.relativeSpeed);
+        if (seconds > 0.0 && seconds <= budgetSec * BUDGET_FILL)
+            chosen = preset.name;
+    }
+
+    qDebug() << "x264 preset for a" << budgetSec << "s budget:" << chosen;
+    return chosen;
+}
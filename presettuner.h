@@ -0,0 +1,36 @@
+#ifndef PRESETTUNER_H
+#define PRESETTUNER_H
+
+#include <QString>
+
+#include "encodeplan.h"
+
+// Picks the slowest (most efficient) x264 preset an encode can afford
+// within a wall-clock budget.
+//
+// The speed of "fast" is measured once per machine and output size by
+// encoding a few seconds of the clip itself, then kept in QSettings;
+// the other presets are extrapolated from it (X264Preset::relativeSpeed).
+// Calibration blocks; run it off the GUI thread.
+class PresetTuner
+{
+public:
+    // Stored frames per second of "fast" at this size; 0 = not calibrated
+    static double calibratedFps(int width, int height);
+
+    // Times a short encode from the middle of the plan's range with
+    // "fast", stores the result and returns it; 0 on failure
+    static double calibrate(const QString &ffmpegPath, const EncodePlan &plan);
+
+    // Expected encode time of the plan at presetFps frames per second
+    static double estimatedSeconds(const EncodePlan &plan, double presetFps);
+
+    // Slowest preset whose estimated time fits budgetSec; the fastest
+    // one when none does
+    static QString choosePreset(const EncodePlan &plan, double fastFps, double budgetSec);
+
+private:
+    static QString calibrationKey(int width, int height);
+};
+
+#endif // PRESETTUNER_H
@@ -0,0 +1,174 @@
+#include "probebackend.h"
+
+#ifdef CLIP2DISC_HAVE_LIBAV
+#include "libavprobebackend.h"
+#endif
+
+#include <QProcess>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRegularExpression>
+
+static constexpr int PROBE_TIMEOUT_MS = 30000;
+static constexpr int PROBE_POLL_MS    = 50;
+
+ProbeBackendList createProbeBackends(const QString &ffprobePath)
+{
+    ProbeBackendList backends;
+
+#ifdef CLIP2DISC_HAVE_LIBAV
+    backends << std::make_shared<const LibavProbeBackend>();
+#endif
+
+    backends << std::make_shared<const FfprobeBackend>(ffprobePath);
+    return backends;
+}
+
+// ----------------- ffprobe -----------------
+
+FfprobeBackend::FfprobeBackend(const QString &ffprobePath)
+    : m_ffprobePath(ffprobePath)
+{
+}
+
+ProbeResult FfprobeBackend::probe(const QString &filePath,
+                                  const std::atomic_bool &cancelled) const
+{
+    ProbeResult result;
+
+    QProcess process;
+    process.setProgram(m_ffprobePath);
+    process.setArguments({
+        "-v", "error",
+        "-print_format", "json",
+        "-show_format",
+        "-show_streams",
+        filePath
+    });
+
+    process.start();
+    if (!process.waitForStarted()) {
+        result.error = "Could not start ffprobe";
+        return result;
+    }
+
+    // Poll so a cancelled probe doesn't hold a pool thread for the full timeout
+    int waitedMs = 0;
+    while (!process.waitForFinished(PROBE_POLL_MS)) {
+        waitedMs += PROBE_POLL_MS;
+
+        if (cancelled.load() || waitedMs >= PROBE_TIMEOUT_MS) {
+            process.kill();
+            process.waitForFinished();
+            result.error = cancelled.load() ? "Probe cancelled"
+                                            : "ffprobe timed out";
+            return result;
+        }
+    }
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        result.error = QString::fromLocal8Bit(process.readAllStandardError()).trimmed();
+        if (result.error.isEmpty())
+            result.error = "ffprobe failed";
+        return result;
+    }
+
+    if (!parseJson(process.readAllStandardOutput(), result.info)) {
+        result.error = "Could not parse ffprobe output";
+        return result;
+    }
+
+    result.ok = true;
+    return result;
+}
+
+bool FfprobeBackend::parseJson(const QByteArray &json, VideoInfo &info)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(json);
+
+    if (!doc.isObject())
+        return false;
+
+    const QJsonObject root = doc.object();
+
+    // ---------- FORMAT (container) ----------
+    const QJsonObject format = root["format"].toObject();
+
+    info.duration = format["duration"].toString().toDouble();
+
+    // container bitrate (bits/sec → kbps)
+    if (format.contains("bit_rate")) {
+        info.bitrate = format["bit_rate"].toString().toLongLong() / 1000;
+    }
+
+    // ---------- STREAMS ----------
+    const QJsonArray streams = root["streams"].toArray();
+
+    for (const QJsonValue &v : streams) {
+        const QJsonObject s = v.toObject();
+        const QString type = s["codec_type"].toString();
+
+        if (type == "video") {
+            info.videoCodec = s["codec_name"].toString();
+            info.width  = s["width"].toInt();
+            info.height = s["height"].toInt();
+
+            // FPS (e.g. "30000/1001")
+            const QString fpsStr = s["r_frame_rate"].toString();
+            if (fpsStr.contains("/")) {
+                const auto parts = fpsStr.split("/");
+                const double num = parts.value(0).toDouble();
+                const double den = parts.value(1).toDouble();
+                if (den != 0.0)
+                    info.fps = num / den;
+            }
+
+            // video bitrate (bits/sec → kbps)
+            if (s.contains("bit_rate")) {
+                info.videoBitrate =
+                    s["bit_rate"].toString().toLongLong() / 1000;
+            }
+
+            // Colour; "unknown" and missing mean the same
+            const QString transfer = s["color_transfer"].toString();
+            const QString primaries = s["color_primaries"].toString();
+            info.colorTransfer = transfer == "unknown" ? QString() : transfer;
+            info.colorPrimaries = primaries == "unknown" ? QString() : primaries;
+            const QString space = s["color_space"].toString();
+            info.colorSpace = space == "unknown" ? QString() : space;
+
+            info.videoProfile = s["profile"].toString();
+            info.videoLevel = qMax(0, s["level"].toInt());
+            info.pixelFormat = s["pix_fmt"].toString();
+
+            // "0:1" when the stream doesn't say
+            const QString sar = s["sample_aspect_ratio"].toString();
+            if (!sar.isEmpty() && !sar.startsWith("0:") && sar.contains(':'))
+                info.sampleAspectRatio = sar;
+
+            // bits_per_raw_sample is missing for some codecs; the pixel
+            // format says it too ("yuv420p10le")
+            const int rawBits = s["bits_per_raw_sample"].toString().toInt();
+            if (rawBits > 0) {
+                info.bitDepth = rawBits;
+            } else {
+                static const QRegularExpression depthPattern("p(\\d{2})(le|be)?$");
+                const QRegularExpressionMatch m = depthPattern.match(s["pix_fmt"].toString());
+                if (m.hasMatch())
+                    info.bitDepth = m.captured(1).toInt();
+            }
+        }
+        else if (type == "audio") {
+            info.audioCodec = s["codec_name"].toString();
+
+            // audio bitrate (bits/sec → kbps)
+            if (s.contains("bit_rate")) {
+                info.audioBitrate =
+                    s["bit_rate"].toString().toLongLong() / 1000;
+            }
+        }
+    }
+
+    return true;
+}
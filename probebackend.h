@@ -0,0 +1,57 @@
+#ifndef PROBEBACKEND_H
+#define PROBEBACKEND_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+#include <atomic>
+#include <memory>
+
+#include "videoinfo.h"
+
+// Result of a single probe, handed from the worker thread back to the UI.
+struct ProbeResult {
+    bool ok = false;
+    VideoInfo info;
+    QString error;
+    bool fromCache = false;
+};
+
+// Something that can fill a VideoInfo for a file. Implementations are
+// stateless and called from worker threads; probe() blocks and should
+// give up early once `cancelled` becomes true.
+class ProbeBackend
+{
+public:
+    virtual ~ProbeBackend() = default;
+
+    virtual QString name() const = 0;
+    virtual ProbeResult probe(const QString &filePath,
+                              const std::atomic_bool &cancelled) const = 0;
+};
+
+// Spawns ffprobe and parses its JSON output. Always available.
+class FfprobeBackend : public ProbeBackend
+{
+public:
+    explicit FfprobeBackend(const QString &ffprobePath);
+
+    QString name() const override { return "ffprobe"; }
+    ProbeResult probe(const QString &filePath,
+                      const std::atomic_bool &cancelled) const override;
+
+    // Parses the output of "ffprobe -print_format json -show_format -show_streams"
+    static bool parseJson(const QByteArray &json, VideoInfo &info);
+
+private:
+    QString m_ffprobePath;
+};
+
+using ProbeBackendList = QList<std::shared_ptr<const ProbeBackend>>;
+
+// Preferred backends in order: in-process libavformat when built with
+// CLIP2DISC_HAVE_LIBAV, then ffprobe as the fallback.
+ProbeBackendList createProbeBackends(const QString &ffprobePath);
+
+#endif // PROBEBACKEND_H
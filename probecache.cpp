@@ -0,0 +1,180 @@
+#include "probecache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <algorithm>
+
+static constexpr quint32 CACHE_MAGIC   = 0x43324450; // "C2DP"
+static constexpr quint32 CACHE_VERSION = 3;
+
+// Only scan the directory for eviction every so often
+static constexpr int PRUNE_INTERVAL = 64;
+
+static void writeInfo(QDataStream &out, const VideoInfo &info)
+{
+    out << info.duration
+        << qint32(info.width) << qint32(info.height) << info.fps
+        << info.videoCodec << info.audioCodec
+        << info.bitrate << info.videoBitrate << info.audioBitrate
+        << info.colorTransfer << info.colorPrimaries << qint32(info.bitDepth)
+        << info.colorSpace << info.videoProfile << qint32(info.videoLevel)
+        << info.pixelFormat << info.sampleAspectRatio;
+}
+
+static void readInfo(QDataStream &in, VideoInfo &info)
+{
+    qint32 width = 0, height = 0, bitDepth = 8, level = 0;
+
+    in >> info.duration
+        >> width >> height >> info.fps
+        >> info.videoCodec >> info.audioCodec
+        >> info.bitrate >> info.videoBitrate >> info.audioBitrate
+        >> info.colorTransfer >> info.colorPrimaries >> bitDepth
+        >> info.colorSpace >> info.videoProfile >> level
+        >> info.pixelFormat >> info.sampleAspectRatio;
+
+    info.width = width;
+    info.height = height;
+    info.bitDepth = bitDepth;
+    info.videoLevel = level;
+}
+
+ProbeCache::ProbeCache(const QString &directory, int maxEntries)
+    : m_directory(directory)
+    , m_maxEntries(qMax(1, maxEntries))
+{
+    if (m_directory.isEmpty()) {
+        m_directory =
+            QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + "/probe";
+    }
+
+    QDir().mkpath(m_directory);
+}
+
+QString ProbeCache::entryPath(const QString &canonicalPath) const
+{
+    const QByteArray name =
+        QCryptographicHash::hash(canonicalPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_directory + "/" + QString::fromLatin1(name) + ".bin";
+}
+
+bool ProbeCache::readEntry(const QString &path, Entry &entry) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION)
+        return false;
+
+    in >> entry.id.canonicalPath >> entry.id.size
+        >> entry.id.mtimeMs >> entry.id.sampleHash;
+    readInfo(in, entry.info);
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool ProbeCache::lookup(const FileIdentity &id, VideoInfo &info)
+{
+    if (!id.isValid()) {
+        ++m_misses;
+        return false;
+    }
+
+    QMutexLocker lock(&m_mutex);
+
+    // In-memory first: this is the microsecond path
+    auto it = m_memory.constFind(id.canonicalPath);
+    if (it != m_memory.constEnd() && it->id == id) {
+        info = it->info;
+        ++m_hits;
+        return true;
+    }
+
+    // Another instance may have written it since we last looked
+    const QString path = entryPath(id.canonicalPath);
+
+    Entry entry;
+    if (readEntry(path, entry)) {
+        if (entry.id == id) {
+            m_memory.insert(id.canonicalPath, entry);
+            info = entry.info;
+            ++m_hits;
+            return true;
+        }
+
+        // Same path, different file: stale
+        QFile::remove(path);
+    }
+
+    m_memory.remove(id.canonicalPath);
+    ++m_misses;
+    return false;
+}
+
+void ProbeCache::store(const FileIdentity &id, const VideoInfo &info)
+{
+    if (!id.isValid())
+        return;
+
+    QMutexLocker lock(&m_mutex);
+
+    m_memory.insert(id.canonicalPath, Entry{id, info});
+
+    // QSaveFile writes to a temp file and renames it into place, so
+    // concurrent readers never see a half-written entry.
+    QSaveFile file(entryPath(id.canonicalPath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Probe cache: cannot write" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << CACHE_MAGIC << CACHE_VERSION;
+    out << id.canonicalPath << id.size << id.mtimeMs << id.sampleHash;
+    writeInfo(out, info);
+
+    if (!file.commit())
+        qDebug() << "Probe cache: commit failed for" << file.fileName();
+
+    if (++m_storesSincePrune >= PRUNE_INTERVAL || m_memory.size() > m_maxEntries) {
+        m_storesSincePrune = 0;
+        prune();
+    }
+}
+
+void ProbeCache::prune()
+{
+    if (m_memory.size() > m_maxEntries)
+        m_memory.clear();
+
+    QDir dir(m_directory);
+    QFileInfoList entries =
+        dir.entryInfoList({"*.bin"}, QDir::Files, QDir::Time | QDir::Reversed);
+
+    const int excess = entries.size() - m_maxEntries;
+    if (excess <= 0)
+        return;
+
+    // Oldest first thanks to QDir::Reversed
+    for (int i = 0; i < excess; ++i)
+        QFile::remove(entries.at(i).absoluteFilePath());
+
+    qDebug() << "Probe cache: evicted" << excess << "entries";
+}
@@ -0,0 +1,55 @@
+#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+
+#include <atomic>
+
+#include "videoinfo.h"
+#include "fileidentity.h"
+
+// On-disk cache of probe results, one small file per source path.
+//
+// Entries are keyed by canonical path and validated against the full
+// FileIdentity (size, mtime, sampled hash), so a file that changed on
+// disk is treated as a miss and its entry is dropped. Files are replaced
+// atomically, which lets several clip2disc instances share the directory.
+// Thread-safe: lookups happen on probe worker threads.
+class ProbeCache
+{
+public:
+    explicit ProbeCache(const QString &directory = QString(),
+                        int maxEntries = 4096);
+
+    bool lookup(const FileIdentity &id, VideoInfo &info);
+    void store(const FileIdentity &id, const VideoInfo &info);
+
+    quint64 hits() const { return m_hits.load(); }
+    quint64 misses() const { return m_misses.load(); }
+
+    QString directory() const { return m_directory; }
+
+private:
+    struct Entry {
+        FileIdentity id;
+        VideoInfo info;
+    };
+
+    QString entryPath(const QString &canonicalPath) const;
+    bool readEntry(const QString &path, Entry &entry) const;
+    void prune();
+
+    QString m_directory;
+    int m_maxEntries;
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_memory;   // canonical path → entry
+    int m_storesSincePrune = 0;
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+};
+
+#endif // PROBECACHE_H
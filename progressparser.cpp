@@ -0,0 +1,127 @@
+#include "progressparser.h"
+
+#include <QByteArrayView>
+
+#include <cstring>
+
+// Longest line we expect ("stream_0_0_q=..." etc. are far shorter)
+static constexpr qsizetype LINE_RESERVE = 256;
+
+ProgressParser::ProgressParser()
+{
+    m_partial.reserve(LINE_RESERVE);
+}
+
+void ProgressParser::reset()
+{
+    m_partial.clear();
+    m_pending = EncodeProgress();
+    m_current = EncodeProgress();
+}
+
+void ProgressParser::setExpectedDurationUs(qint64 durationUs)
+{
+    m_expectedUs = durationUs;
+}
+
+bool ProgressParser::feed(const char *data, qsizetype size)
+{
+    m_blockCompleted = false;
+
+    const char *p = data;
+    const char *end = data + size;
+
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+
+        if (!nl) {
+            // Keep the tail for the next read; clear() keeps the capacity
+            m_partial.append(p, end - p);
+            break;
+        }
+
+        if (m_partial.isEmpty()) {
+            parseLine(p, nl);
+        } else {
+            m_partial.append(p, nl - p);
+            parseLine(m_partial.constData(), m_partial.constData() + m_partial.size());
+            m_partial.clear();
+        }
+
+        p = nl + 1;
+    }
+
+    return m_blockCompleted;
+}
+
+void ProgressParser::parseLine(const char *begin, const char *end)
+{
+    // Windows pipes may hand us CRLF
+    if (end > begin && end[-1] == '\r')
+        --end;
+
+    const char *eq = static_cast<const char *>(std::memchr(begin, '=', end - begin));
+    if (!eq)
+        return;
+
+    const QByteArrayView key(begin, eq - begin);
+    QByteArrayView value(eq + 1, end - eq - 1);
+    value = value.trimmed();
+
+    if (key == "out_time_us" || key == "out_time_ms") {
+        // Despite its name, out_time_ms is in microseconds too
+        bool ok = false;
+        const qint64 us = value.toLongLong(&ok);
+        if (ok)
+            m_pending.outTimeUs = us;
+    }
+    else if (key == "frame") {
+        m_pending.frame = value.toLongLong();
+    }
+    else if (key == "fps") {
+        m_pending.fps = value.toDouble();
+    }
+    else if (key == "speed") {
+        if (value.endsWith('x'))
+            value.chop(1);
+        m_pending.speed = value.toDouble();   // "N/A" → 0
+    }
+    else if (key == "total_size") {
+        bool ok = false;
+        const qint64 bytes = value.toLongLong(&ok);
+        if (ok)
+            m_pending.totalSize = bytes;
+    }
+    else if (key == "bitrate") {
+        if (value.endsWith("kbits/s"))
+            value.chop(7);
+        m_pending.bitrateKbps = value.toDouble();
+    }
+    else if (key == "progress") {
+        completeBlock(value == "end");
+    }
+}
+
+void ProgressParser::completeBlock(bool finished)
+{
+    EncodeProgress &p = m_pending;
+    p.finished = finished;
+
+    if (m_expectedUs > 0) {
+        p.percent = qBound(0.0, 100.0 * p.outTimeUs / m_expectedUs, 100.0);
+
+        if (p.speed > 0.0) {
+            const double remainingSec =
+                qMax<qint64>(0, m_expectedUs - p.outTimeUs) / 1e6;
+            p.etaSec = remainingSec / p.speed;
+        }
+    }
+
+    if (finished) {
+        p.percent = 100.0;
+        p.etaSec = 0.0;
+    }
+
+    m_current = p;
+    m_blockCompleted = true;
+}
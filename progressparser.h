@@ -0,0 +1,55 @@
+#ifndef PROGRESSPARSER_H
+#define PROGRESSPARSER_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QtGlobal>
+
+// One snapshot of FFmpeg's "-progress" output.
+struct EncodeProgress {
+    qint64 outTimeUs = 0;
+    qint64 frame = 0;
+    double fps = 0.0;
+    double speed = 0.0;         // realtime multiple, e.g. 2.5 for "2.5x"
+    qint64 totalSize = 0;       // bytes written so far
+    double bitrateKbps = 0.0;
+
+    double percent = 0.0;       // of the expected output duration
+    double etaSec = -1.0;       // -1 while unknown
+    bool finished = false;      // "progress=end" seen
+};
+
+Q_DECLARE_METATYPE(EncodeProgress)
+
+// Incremental parser for FFmpeg's -progress key=value protocol.
+//
+// Bytes can be fed in arbitrary chunks: a line split across two reads is
+// carried over in a small preallocated buffer, and complete lines are
+// parsed in place, so steady-state feeding does not allocate. A snapshot
+// becomes current() each time a "progress=" line closes a block.
+class ProgressParser
+{
+public:
+    ProgressParser();
+
+    void reset();
+    void setExpectedDurationUs(qint64 durationUs);
+
+    // Returns true if at least one block was completed by this chunk
+    bool feed(const char *data, qsizetype size);
+    bool feed(const QByteArray &data) { return feed(data.constData(), data.size()); }
+
+    const EncodeProgress &current() const { return m_current; }
+
+private:
+    void parseLine(const char *begin, const char *end);
+    void completeBlock(bool finished);
+
+    QByteArray m_partial;
+    EncodeProgress m_pending;
+    EncodeProgress m_current;
+    qint64 m_expectedUs = 0;
+    bool m_blockCompleted = false;
+};
+
+#endif // PROGRESSPARSER_H
@@ -0,0 +1,217 @@
+#include "qualityreport.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QThread>
+#include <QDebug>
+
+#include <memory>
+#include <vector>
+
+// A handful of frames from each of a few chunks says enough about an
+// encode to compare it with another, at a fraction of a full decode
+static constexpr int MAX_CHUNKS       = 8;
+static constexpr int CHUNK_FRAMES     = 5;
+static constexpr int MEASURE_TIMEOUT_MS = 60000;
+static constexpr int MEASURE_POLL_MS    = 50;
+
+// Identical frames read "inf"
+static constexpr double LOSSLESS_PSNR = 99.0;
+
+QString QualityReport::logPath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+        .filePath("quality.jsonl");
+}
+
+// ----------------- Measurement -----------------
+
+QList<QualityScore> QualityReport::measure(const QString &ffmpegPath,
+                                           const EncodePlan &plan,
+                                           const std::atomic_bool &cancelled)
+{
+    QList<QualityScore> scores;
+    if (ffmpegPath.isEmpty() || plan.copyVideo || plan.durationSec <= 0.0)
+        return scores;
+
+    if (plan.tiers.isEmpty()) {
+        QualityScore score = measureOutput(ffmpegPath, plan, plan.settings.outputPath,
+                                           plan.outWidth, plan.outHeight, plan.fps, cancelled);
+        score.videoBitrateKbps = plan.videoBitrateKbps;
+        scores << score;
+        return scores;
+    }
+
+    for (const EncodeTier &tier : plan.tiers) {
+        if (cancelled.load())
+            break;
+
+        QualityScore score = measureOutput(ffmpegPath, plan, tier.settings.outputPath,
+                                           tier.settings.outWidth, tier.settings.outHeight,
+                                           tier.settings.fps, cancelled);
+        score.videoBitrateKbps = tier.videoBitrateKbps;
+        scores << score;
+    }
+
+    return scores;
+}
+
+QualityScore QualityReport::measureOutput(const QString &ffmpegPath,
+                                          const EncodePlan &plan,
+                                          const QString &outputPath,
+                                          int width,
+                                          int height,
+                                          int fps,
+                                          const std::atomic_bool &cancelled)
+{
+    QualityScore score;
+    score.outputPath = outputPath;
+    score.bytes = QFileInfo(outputPath).size();
+    score.width = width;
+    score.height = height;
+    score.fps = fps;
+
+    if (score.bytes <= 0 || width <= 0 || height <= 0 || fps <= 0)
+        return score;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Both inputs start at the chunk; the source then goes through the
+    // plan's filters so the two pictures line up frame for frame
+    const QString reference = EncodePlanner::referenceFilters(plan, width, height, fps);
+    const QString graph =
+        QString("[1:v]setpts=PTS-STARTPTS%1[ref];[0:v]setpts=PTS-STARTPTS,split[o0][o1];"
+                "[ref]split[r0][r1];[o0][r0]ssim;[o1][r1]psnr")
+            .arg(reference.isEmpty() ? QString() : "," + reference);
+
+    const double rangeStart = plan.hasTrim ? plan.startSec : 0.0;
+    const double chunkSec = double(CHUNK_FRAMES) / fps;
+    const int chunks = qBound(1, qMin(QThread::idealThreadCount(),
+                                      int(plan.durationSec / chunkSec)), MAX_CHUNKS);
+
+    // One thread per chunk; the chunks are the parallelism
+    std::vector<std::unique_ptr<QProcess>> processes;
+    for (int i = 0; i < chunks; ++i) {
+        // Centred in equal slices of the output
+        const double at = qMax(0.0, (plan.durationSec - chunkSec) * (i + 0.5) / chunks);
+
+        auto process = std::make_unique<QProcess>();
+        process->setStandardOutputFile(QProcess::nullDevice());
+        process->start(ffmpegPath, {
+            "-hide_banner", "-nostats",
+            "-threads", "1",
+            "-ss", QString::number(at, 'f', 3),
+            "-i", outputPath,
+            "-ss", QString::number(rangeStart + at, 'f', 3),
+            "-i", plan.settings.inputPath,
+            "-an", "-sn", "-dn",
+            "-filter_complex", graph,
+            "-frames:v", QString::number(CHUNK_FRAMES),
+            "-f", "null", "-",
+        });
+        processes.push_back(std::move(process));
+    }
+
+    // ssim ends with "SSIM Y:... U:... V:... All:0.981 (17.2)", psnr
+    // with "PSNR y:... u:... v:... average:41.23 min:... max:..."
+    static const QRegularExpression ssimPattern("SSIM .* All:([0-9.]+)");
+    static const QRegularExpression psnrPattern("PSNR .* average:(inf|[0-9.]+)");
+
+    double ssimSum = 0.0;
+    double psnrSum = 0.0;
+    for (const auto &process : processes) {
+        while (!process->waitForFinished(MEASURE_POLL_MS)) {
+            if (cancelled.load() || timer.elapsed() > MEASURE_TIMEOUT_MS) {
+                for (const auto &p : processes) {
+                    p->kill();
+                    p->waitForFinished();
+                }
+                score.samples = 0;
+                return score;
+            }
+        }
+
+        const QString log = QString::fromLocal8Bit(process->readAllStandardError());
+        const QRegularExpressionMatch ssim = ssimPattern.match(log);
+        const QRegularExpressionMatch psnr = psnrPattern.match(log);
+        if (!ssim.hasMatch() || !psnr.hasMatch())
+            continue;
+
+        ssimSum += ssim.captured(1).toDouble();
+        psnrSum += psnr.captured(1) == "inf" ? LOSSLESS_PSNR
+                                             : qMin(LOSSLESS_PSNR, psnr.captured(1).toDouble());
+        ++score.samples;
+    }
+
+    if (score.samples > 0) {
+        score.ssim = ssimSum / score.samples;
+        score.psnr = psnrSum / score.samples;
+    }
+
+    qDebug() << "Quality:" << outputPath << score.samples << "chunk(s), SSIM" << score.ssim
+             << "PSNR" << score.psnr << "dB in" << timer.elapsed() << "ms";
+    return score;
+}
+
+// ----------------- Log -----------------
+
+void QualityReport::record(const EncodePlan &plan,
+                           const QList<QualityScore> &scores,
+                           double encodeSec)
+{
+    // Reports of concurrent encodes share the file
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+
+    const QString path = logPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qDebug() << "Quality report: can't write" << path;
+        return;
+    }
+
+    const QString now = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    for (const QualityScore &score : scores) {
+        if (!score.isValid())
+            continue;
+
+        const QJsonObject line {
+            { "time", now },
+            { "input", plan.settings.inputPath },
+            { "output", score.outputPath },
+            { "encoder", EncodePlanner::videoEncoder(plan.settings.videoEncoder).encoder },
+            { "preset", plan.settings.x264Preset },
+            { "width", score.width },
+            { "height", score.height },
+            { "fps", score.fps },
+            { "duration", plan.durationSec },
+            { "bytes", score.bytes },
+            { "kbps", score.bytes * 8.0 / 1000.0 / plan.durationSec },
+            { "video_kbps", score.videoBitrateKbps },
+            { "audio_kbps", plan.copyAudio ? 0 : plan.audioBitrateKbps },
+            { "two_pass", plan.twoPass },
+            { "smart_cut", plan.smartCut },
+            { "denoise", plan.settings.denoise },
+            { "encode_sec", encodeSec },
+            { "ssim", score.ssim },
+            { "psnr", score.psnr },
+            { "samples", score.samples },
+        };
+
+        file.write(QJsonDocument(line).toJson(QJsonDocument::Compact));
+        file.write("\n");
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef QUALITYREPORT_H
+#define QUALITYREPORT_H
+
+#include <QList>
+#include <QString>
+
+#include <atomic>
+
+#include "encodeplan.h"
+
+// How close one output came to its source
+struct QualityScore {
+    QString outputPath;
+    qint64 bytes = 0;
+    int width = 0;
+    int height = 0;
+    int fps = 0;
+    int videoBitrateKbps = 0;        // as planned
+
+    double ssim = 0.0;               // all planes, 0-1
+    double psnr = 0.0;               // all planes, dB
+    int samples = 0;                 // chunks that were scored; 0 = no score
+
+    bool isValid() const { return samples > 0; }
+};
+
+// Scores a finished encode against the trimmed source with FFmpeg's
+// ssim and psnr filters, and keeps the result next to what it cost.
+//
+// Only a sparse set of frames is compared: a few short chunks spread
+// evenly over the output, each decoded from both files by its own
+// single-threaded FFmpeg, all of them side by side. The source goes
+// through the plan's own crop, frame rate, scaler and tone mapping, but
+// not its denoiser, so whatever the denoiser took away counts against
+// the output. Every score is appended as one JSON line to logPath(),
+// with the size, bitrates, format and encode time, for comparing
+// presets and resolutions across many clips. Measuring blocks; run it
+// off the GUI thread.
+class QualityReport
+{
+public:
+    // One score per output of the plan (each tier, or settings.outputPath);
+    // nothing for copied video
+    static QList<QualityScore> measure(const QString &ffmpegPath,
+                                       const EncodePlan &plan,
+                                       const std::atomic_bool &cancelled);
+
+    // Appends the valid scores to the log
+    static void record(const EncodePlan &plan,
+                       const QList<QualityScore> &scores,
+                       double encodeSec);
+
+    // <AppDataLocation>/quality.jsonl
+    static QString logPath();
+
+private:
+    static QualityScore measureOutput(const QString &ffmpegPath,
+                                      const EncodePlan &plan,
+                                      const QString &outputPath,
+                                      int width,
+                                      int height,
+                                      int fps,
+                                      const std::atomic_bool &cancelled);
+};
+
+#endif // QUALITYREPORT_H
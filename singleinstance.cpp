@@ -0,0 +1,98 @@
+#include "singleinstance.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <memory>
+
+// Wire format: one UTF-8 absolute path per line, terminated by closing
+// the connection. A single "\n" (no files) just raises the window.
+
+SingleInstance::SingleInstance(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+{
+    connect(m_server, &QLocalServer::newConnection,
+            this, &SingleInstance::onNewConnection);
+}
+
+QString SingleInstance::serverName()
+{
+    const QByteArray user =
+        QCryptographicHash::hash(QDir::homePath().toUtf8(), QCryptographicHash::Sha1)
+            .toHex().left(12);
+    return "clip2disc-" + QString::fromLatin1(user);
+}
+
+bool SingleInstance::forward(const QStringList &files, int timeoutMs)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(timeoutMs))
+        return false;
+
+    QByteArray payload;
+    for (const QString &file : files)
+        payload += QFileInfo(file).absoluteFilePath().toUtf8() + '\n';
+    if (payload.isEmpty())
+        payload = "\n";
+
+    socket.write(payload);
+    if (!socket.waitForBytesWritten(timeoutMs))
+        return false;
+
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState)
+        socket.waitForDisconnected(timeoutMs);
+
+    return true;
+}
+
+bool SingleInstance::listen()
+{
+    if (m_server->listen(serverName()))
+        return true;
+
+    // forward() already failed, so this is a stale socket from a crash
+    QLocalServer::removeServer(serverName());
+
+    if (m_server->listen(serverName()))
+        return true;
+
+    qDebug() << "Single instance: cannot listen:" << m_server->errorString();
+    return false;
+}
+
+void SingleInstance::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        auto buffer = std::make_shared<QByteArray>();
+
+        connect(socket, &QLocalSocket::readyRead, this, [socket, buffer] {
+            buffer->append(socket->readAll());
+        });
+
+        auto finish = [this, socket, buffer] {
+            buffer->append(socket->readAll());
+
+            QStringList files;
+            for (const QByteArray &line : buffer->split('\n')) {
+                if (!line.isEmpty())
+                    files << QString::fromUtf8(line);
+            }
+
+            socket->deleteLater();
+            emit filesReceived(files);
+        };
+
+        // A fast client may already be gone by the time we pick it up
+        if (socket->state() == QLocalSocket::UnconnectedState)
+            finish();
+        else
+            connect(socket, &QLocalSocket::disconnected, this, finish);
+    }
+}
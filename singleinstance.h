@@ -0,0 +1,37 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+
+// Local-socket handshake that lets a second clip2disc launch hand its
+// file arguments to the window that is already open and exit right away.
+// forward() is safe to call before any QCoreApplication exists, so the
+// second process never pays for GUI startup.
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SingleInstance(QObject *parent = nullptr);
+
+    // Per-user socket name
+    static QString serverName();
+
+    // True if a running instance accepted the files
+    static bool forward(const QStringList &files, int timeoutMs = 500);
+
+    bool listen();
+
+signals:
+    void filesReceived(const QStringList &files);
+
+private:
+    void onNewConnection();
+
+    QLocalServer *m_server = nullptr;
+};
+
+#endif // SINGLEINSTANCE_H
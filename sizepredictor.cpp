@@ -0,0 +1,250 @@
+#include "sizepredictor.h"
+#include "encodesession.h"
+
+#include <QProcess>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+
+#include <cmath>
+
+// Slider drags fire many requests; only the one that sticks is sampled
+static constexpr int DEBOUNCE_MS = 250;
+
+// A handful of short samples keeps the answer within a second or two
+static constexpr int    MAX_SAMPLES       = 6;
+static constexpr double SAMPLE_SEC        = 2.0;
+static constexpr int    SAMPLE_TIMEOUT_MS = 15000;
+
+// One sample says nothing about the spread; assume this much either way
+static constexpr double SINGLE_SAMPLE_SPREAD = 0.2;
+
+static constexpr int MAX_CACHE_ENTRIES = 64;
+
+// Two-sided 90% quantiles of Student's t by degrees of freedom
+static double tQuantile90(int dof)
+{
+    static const double table[] = { 6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860 };
+    if (dof < 1)
+        return table[0];
+    return dof <= 8 ? table[dof - 1] : 1.645;
+}
+
+SizePredictor::SizePredictor(QObject *parent)
+    : QObject(parent)
+    , m_debounce(new QTimer(this))
+{
+    m_debounce->setSingleShot(true);
+    m_debounce->setInterval(DEBOUNCE_MS);
+    connect(m_debounce, &QTimer::timeout, this, &SizePredictor::startSamples);
+}
+
+SizePredictor::~SizePredictor()
+{
+    cancel();
+}
+
+QString SizePredictor::cacheKey(const EncodePlan &plan)
+{
+    // The video part is what the samples run (input, range, encoder,
+    // preset, bitrate, filters), the rest what the size adds on top;
+    // slider positions that resolve to the same plan share an entry
+    const double rangeStart = plan.hasTrim ? plan.startSec : 0.0;
+    return QStringList {
+        EncodePlanner::sampleArguments(plan, rangeStart, plan.durationSec).join(QChar(0x1f)),
+        QString::number(plan.fps),
+        QString::number(plan.audioBitrateKbps),
+        QString::number(int(plan.copyVideo) | int(plan.smartCut) << 1
+                        | int(plan.copyAudio) << 2 | int(plan.twoPass) << 3),
+    }.join('|');
+}
+
+void SizePredictor::predict(const EncodePlan &plan)
+{
+    stopSamples();
+
+    m_plan = plan;
+    m_key = cacheKey(plan);
+
+    const auto cached = m_cache.constFind(m_key);
+    if (cached != m_cache.cend()) {
+        m_debounce->stop();
+        emit predicted(*cached);
+        return;
+    }
+
+    // Copied video is as big as the packets it copies
+    if (plan.copyVideo || plan.smartCut) {
+        m_debounce->stop();
+        const SizePrediction prediction = exactPrediction();
+        m_cache.insert(m_key, prediction);
+        emit predicted(prediction);
+        return;
+    }
+
+    m_debounce->start();
+}
+
+void SizePredictor::cancel()
+{
+    m_debounce->stop();
+    stopSamples();
+}
+
+SizePrediction SizePredictor::exactPrediction() const
+{
+    const double rangeStart = m_plan.hasTrim ? m_plan.startSec : 0.0;
+    qint64 videoBytes = m_plan.analysis.keyframes.bytesBetween(rangeStart,
+                                                               rangeStart + m_plan.durationSec);
+    if (videoBytes < 0)
+        videoBytes = qint64(m_plan.videoBitrateKbps * 1000.0 / 8.0 * m_plan.durationSec);
+
+    SizePrediction prediction;
+    prediction.bytes = videoBytes + EncodePlanner::fixedBytes(m_plan);
+    prediction.lowBytes = prediction.bytes;
+    prediction.highBytes = prediction.bytes;
+    return prediction;
+}
+
+// ----------------- Samples -----------------
+
+void SizePredictor::startSamples()
+{
+    if (m_ffmpegPath.isEmpty() || m_plan.durationSec <= 0.0)
+        return;
+
+    const double rangeStart = m_plan.hasTrim ? m_plan.startSec : 0.0;
+    const double length = qMin(SAMPLE_SEC, m_plan.durationSec);
+    const int count = qBound(1, int(m_plan.durationSec / (2 * SAMPLE_SEC)), MAX_SAMPLES);
+    const int threads = qMax(1, QThread::idealThreadCount() / count);
+    const int generation = ++m_generation;
+
+    for (int i = 0; i < count; ++i) {
+        // Centred in equal slices of the range
+        const double start = rangeStart + (m_plan.durationSec - length) * (i + 0.5) / count;
+
+        Sample sample;
+        sample.lengthSec = length;
+        sample.process = new QProcess(this);
+
+        QProcess *process = sample.process;
+        process->setStandardErrorFile(QProcess::nullDevice());
+
+        // Only the byte count matters; the stream itself is dropped
+        connect(process, &QProcess::readyReadStandardOutput,
+                this, [this, generation, i, process]() {
+                    if (generation == m_generation)
+                        m_samples[i].bytes += process->readAllStandardOutput().size();
+                });
+        connect(process, &QProcess::finished,
+                this, [this, generation, i](int exitCode, QProcess::ExitStatus status) {
+                    if (generation == m_generation)
+                        onSampleFinished(i, status == QProcess::NormalExit && exitCode == 0);
+                });
+        connect(process, &QProcess::errorOccurred,
+                this, [this, generation, i](QProcess::ProcessError error) {
+                    if (generation == m_generation && error == QProcess::FailedToStart)
+                        onSampleFinished(i, false);
+                });
+
+        m_samples << sample;
+
+        process->start(m_ffmpegPath,
+                       EncodeSession::withThreads(
+                           EncodePlanner::sampleArguments(m_plan, start, length), threads));
+    }
+
+    QTimer::singleShot(SAMPLE_TIMEOUT_MS, this, [this, generation]() {
+        if (generation != m_generation)
+            return;
+
+        qDebug() << "Size prediction: samples timed out";
+        stopSamples();
+    });
+}
+
+void SizePredictor::onSampleFinished(int index, bool ok)
+{
+    Sample &sample = m_samples[index];
+    if (sample.done)
+        return;
+
+    sample.done = true;
+    sample.ok = ok;
+    if (ok)
+        sample.bytes += sample.process->readAllStandardOutput().size();
+
+    for (const Sample &s : std::as_const(m_samples)) {
+        if (!s.done)
+            return;
+    }
+
+    finishPrediction();
+}
+
+void SizePredictor::finishPrediction()
+{
+    QList<double> kbps;
+    for (const Sample &s : std::as_const(m_samples)) {
+        if (s.ok && s.bytes > 0)
+            kbps << s.bytes * 8.0 / 1000.0 / s.lengthSec;
+    }
+
+    stopSamples();
+
+    if (kbps.isEmpty()) {
+        qDebug() << "Size prediction: no usable samples";
+        return;
+    }
+
+    // --- Extrapolate ---
+    // Samples start on an IDR frame the full encode only has once per GOP,
+    // so they read a little high, which errs on the safe side
+    const int n = int(kbps.size());
+
+    double mean = 0.0;
+    for (double v : std::as_const(kbps))
+        mean += v;
+    mean /= n;
+
+    double halfWidth = mean * SINGLE_SAMPLE_SPREAD;
+    if (n > 1) {
+        double variance = 0.0;
+        for (double v : std::as_const(kbps))
+            variance += (v - mean) * (v - mean);
+        variance /= n - 1;
+
+        halfWidth = tQuantile90(n - 1) * std::sqrt(variance / n);
+    }
+
+    const double bytesPerKbps = 1000.0 / 8.0 * m_plan.durationSec;
+    const qint64 fixed = EncodePlanner::fixedBytes(m_plan);
+
+    SizePrediction prediction;
+    prediction.samples = n;
+    prediction.bytes = qint64(mean * bytesPerKbps) + fixed;
+    prediction.lowBytes = qint64(qMax(0.0, mean - halfWidth) * bytesPerKbps) + fixed;
+    prediction.highBytes = qint64((mean + halfWidth) * bytesPerKbps) + fixed;
+
+    qDebug() << "Size prediction:" << n << "sample(s)," << mean << "kbps video,"
+             << prediction.bytes << "bytes";
+
+    if (m_cache.size() >= MAX_CACHE_ENTRIES)
+        m_cache.clear();
+    m_cache.insert(m_key, prediction);
+
+    emit predicted(prediction);
+}
+
+void SizePredictor::stopSamples()
+{
+    ++m_generation;
+
+    for (Sample &s : m_samples) {
+        s.process->disconnect(this);
+        if (s.process->state() != QProcess::NotRunning)
+            s.process->kill();
+        s.process->deleteLater();
+    }
+    m_samples.clear();
+}
@@ -0,0 +1,77 @@
+#ifndef SIZEPREDICTOR_H
+#define SIZEPREDICTOR_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QString>
+
+#include "encodeplan.h"
+
+class QProcess;
+class QTimer;
+
+// Predicted output size, with a ~90% interval around it
+struct SizePrediction {
+    qint64 bytes = 0;
+    qint64 lowBytes = 0;
+    qint64 highBytes = 0;
+    int samples = 0;                 // 0 = known without encoding (stream copy)
+};
+
+// Estimates what an EncodePlan will produce by encoding a few short,
+// evenly spaced samples of its range side by side and extrapolating
+// their bitrate; a bitrate × duration guess can be far off once x264's
+// rate control meets easy or hard content.
+//
+// Requests are debounced, a new one kills the samples of the previous
+// one, and results are kept per plan so going back to earlier settings
+// is instant.
+class SizePredictor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SizePredictor(QObject *parent = nullptr);
+    ~SizePredictor();
+
+    void setFfmpegPath(const QString &path) { m_ffmpegPath = path; }
+
+    void predict(const EncodePlan &plan);
+    void cancel();
+
+    bool isRunning() const { return !m_samples.isEmpty(); }
+
+signals:
+    void predicted(const SizePrediction &prediction);
+
+private:
+    struct Sample {
+        QProcess *process = nullptr;
+        double lengthSec = 0.0;
+        qint64 bytes = 0;
+        bool done = false;
+        bool ok = false;
+    };
+
+    static QString cacheKey(const EncodePlan &plan);
+
+    void startSamples();
+    void onSampleFinished(int index, bool ok);
+    void finishPrediction();
+    void stopSamples();
+
+    SizePrediction exactPrediction() const;
+
+    QString m_ffmpegPath;
+    EncodePlan m_plan;
+    QString m_key;
+
+    QTimer *m_debounce = nullptr;
+    QList<Sample> m_samples;
+    int m_generation = 0;           // bumped to ignore signals from killed samples
+
+    QHash<QString, SizePrediction> m_cache;
+};
+
+#endif // SIZEPREDICTOR_H
@@ -2,6 +2,11 @@
 #include <QPainter>
 #include <QMouseEvent>
 
+#include <algorithm>
+
+// How close (in pixels) a dragged handle must get to a keyframe to snap
+static constexpr int SNAP_DISTANCE_PX = 6;
+
 TimelineWidget::TimelineWidget(QWidget *parent)
     : QWidget(parent)
 {
@@ -61,6 +66,43 @@ void TimelineWidget::setEndPosition(qint64 positionMs)
 qint64 TimelineWidget::startPosition() const { return m_start; }
 qint64 TimelineWidget::endPosition() const { return m_end; }
 
+void TimelineWidget::setKeyframes(const QList<qint64> &keyframesMs)
+{
+    m_keyframes = keyframesMs;
+    update();
+}
+
+void TimelineWidget::setSnapToKeyframes(bool snap)
+{
+    m_snapToKeyframes = snap;
+    update();
+}
+
+void TimelineWidget::setSceneCuts(const QList<qint64> &cutsMs)
+{
+    m_sceneCuts = cutsMs;
+    update();
+}
+
+qint64 TimelineWidget::snapToKeyframe(qint64 pos, Qt::KeyboardModifiers modifiers) const
+{
+    if (!m_snapToKeyframes || m_keyframes.isEmpty() || (modifiers & Qt::AltModifier))
+        return pos;
+
+    auto it = std::lower_bound(m_keyframes.cbegin(), m_keyframes.cend(), pos);
+
+    qint64 best = -1;
+    if (it != m_keyframes.cend())
+        best = *it;
+    if (it != m_keyframes.cbegin() && (best < 0 || pos - *(it - 1) < best - pos))
+        best = *(it - 1);
+
+    if (qAbs(positionToX(best) - positionToX(pos)) <= SNAP_DISTANCE_PX)
+        return best;
+
+    return pos;
+}
+
 int TimelineWidget::positionToX(qint64 pos) const
 {
     if (m_duration == 0)
@@ -117,6 +159,39 @@ void TimelineWidget::paintEvent(QPaintEvent *)
     p.setBrush(activeColor);
     p.drawRoundedRect(xStart, trackTop, xEnd - xStart, trackHeight, 6, 6);
 
+    // --- Keyframes ---
+    // Thin ticks; brighter while the handles snap to them
+    if (!m_keyframes.isEmpty()) {
+        QColor tickColor = handleColor;
+        tickColor.setAlpha(m_snapToKeyframes ? 140 : 60);
+        p.setPen(QPen(tickColor, 1));
+
+        int lastX = -1;
+        for (qint64 keyframe : std::as_const(m_keyframes)) {
+            const int x = positionToX(keyframe);
+            if (x == lastX)
+                continue;
+            lastX = x;
+            p.drawLine(x, trackTop + 3, x, trackTop + trackHeight - 3);
+        }
+        p.setPen(Qt::NoPen);
+    }
+
+    // --- Scene cuts ---
+    // Short notches above and below the track
+    if (!m_sceneCuts.isEmpty()) {
+        QColor cutColor = handleColor;
+        cutColor.setAlpha(160);
+        p.setPen(QPen(cutColor, 1));
+
+        for (qint64 cut : std::as_const(m_sceneCuts)) {
+            const int x = positionToX(cut);
+            p.drawLine(x, trackTop - 4, x, trackTop - 1);
+            p.drawLine(x, trackTop + trackHeight + 1, x, trackTop + trackHeight + 4);
+        }
+        p.setPen(Qt::NoPen);
+    }
+
     // --- Start / End handles ---
     p.setBrush(handleColor);
     p.drawEllipse(QPoint(xStart, centerY), handleRadius, handleRadius);
@@ -170,9 +245,10 @@ void TimelineWidget::mouseMoveEvent(QMouseEvent *e)
         return;
 
     const qint64 pos = xToPosition(int(e->position().x()));
+    const qint64 trimPos = snapToKeyframe(pos, e->modifiers());
 
     if (m_activeHandle == Start) {
-        const qint64 newStart = qMin(pos, m_end);
+        const qint64 newStart = qMin(trimPos, m_end);
 
         // If pushing start forward past playhead → drag playhead
         if (newStart > m_start && newStart >= m_play) {
@@ -188,7 +264,7 @@ void TimelineWidget::mouseMoveEvent(QMouseEvent *e)
         emit playPositionChanged(m_play);
     }
     else if (m_activeHandle == End) {
-        m_end = qMax(pos, m_start);
+        m_end = qMax(trimPos, m_start);
         emit endPositionChanged(m_end);
     }
 
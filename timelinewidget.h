@@ -2,6 +2,7 @@
 #define TIMELINEWIDGET_H
 
 #include <QWidget>
+#include <QList>
 
 class TimelineWidget : public QWidget
 {
@@ -21,6 +22,14 @@ public:
     qint64 startPosition() const;
     qint64 endPosition() const;
 
+    // Keyframe ticks (sorted, ms). With snapping on, dragged trim handles
+    // jump to a keyframe within a few pixels; hold Alt to place freely.
+    void setKeyframes(const QList<qint64> &keyframesMs);
+    void setSnapToKeyframes(bool snap);
+
+    // Scene cuts of the marked range (sorted, ms), drawn above the track
+    void setSceneCuts(const QList<qint64> &cutsMs);
+
 signals:
     // Playback scrub / click
     void playPositionChanged(qint64 positionMs);
@@ -50,9 +59,15 @@ private:
     qint64 m_play = 0;
     qint64 m_end = 0;
 
+    QList<qint64> m_keyframes;
+    bool m_snapToKeyframes = false;
+
+    QList<qint64> m_sceneCuts;
+
     // Helpers
     int positionToX(qint64 pos) const;
     qint64 xToPosition(int x) const;
+    qint64 snapToKeyframe(qint64 pos, Qt::KeyboardModifiers modifiers) const;
 };
 
 #endif // TIMELINEWIDGET_H
@@ -14,6 +14,23 @@ struct VideoInfo {
     QString videoCodec;
     QString audioCodec;
 
+    // Colour of the video stream, in FFmpeg's names; empty = unknown
+    QString colorTransfer;    // "smpte2084" (PQ) and "arib-std-b67" (HLG) are HDR
+    QString colorPrimaries;   // e.g. "bt709", "bt2020"
+    int bitDepth = 8;         // bits per luma sample
+    QString colorSpace;       // matrix coefficients, e.g. "bt709"
+
+    // Coding of the video stream, for encoding pieces that join it
+    QString videoProfile;     // as ffprobe names it, e.g. "High"; empty = unknown
+    int videoLevel = 0;       // level_idc, e.g. 41 for 4.1; 0 = unknown
+    QString pixelFormat;      // e.g. "yuv420p"; empty = unknown
+    QString sampleAspectRatio; // "num:den"; empty = unknown
+
+    bool isHdr() const
+    {
+        return colorTransfer == "smpte2084" || colorTransfer == "arib-std-b67";
+    }
+
     qint64 bitrate = 0;       // container bitrate (kbps)
     qint64 videoBitrate = 0;  // video stream bitrate (kbps)
     qint64 audioBitrate = 0;  // audio stream bitrate (kbps)
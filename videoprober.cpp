@@ -0,0 +1,116 @@
+#include "videoprober.h"
+#include "probecache.h"
+#include "fileidentity.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+
+VideoProber::VideoProber(QObject *parent)
+    : QObject(parent)
+    , m_cache(std::make_shared<ProbeCache>())
+{
+}
+
+VideoProber::~VideoProber()
+{
+    cancel();
+}
+
+void VideoProber::setFfprobePath(const QString &path)
+{
+    m_backends = createProbeBackends(path);
+}
+
+bool VideoProber::isRunning() const
+{
+    return m_watcher && m_watcher->isRunning();
+}
+
+void VideoProber::cancel()
+{
+    if (m_cancelFlag)
+        m_cancelFlag->store(true);
+    m_cancelFlag.reset();
+
+    if (m_watcher) {
+        // The worker notices the flag, kills ffprobe and returns;
+        // nobody is listening for its result anymore.
+        m_watcher->disconnect(this);
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+    }
+
+    m_currentFile.clear();
+}
+
+void VideoProber::probe(const QString &filePath)
+{
+    cancel();
+
+    m_currentFile = filePath;
+    m_cancelFlag = std::make_shared<std::atomic_bool>(false);
+
+    m_watcher = new QFutureWatcher<ProbeResult>(this);
+
+    QFutureWatcher<ProbeResult> *watcher = m_watcher;
+    connect(watcher, &QFutureWatcher<ProbeResult>::finished,
+            this, [this, watcher, filePath]() {
+                if (watcher != m_watcher)
+                    return;
+
+                const ProbeResult result = watcher->result();
+
+                m_watcher->deleteLater();
+                m_watcher = nullptr;
+                m_cancelFlag.reset();
+                m_currentFile.clear();
+
+                qDebug() << "Probe" << (result.fromCache ? "cache hit:" : "done:") << filePath
+                         << "| cache hits" << m_cache->hits()
+                         << "misses" << m_cache->misses();
+
+                if (result.ok)
+                    emit probeFinished(filePath, result.info);
+                else
+                    emit probeFailed(filePath, result.error);
+            });
+
+    watcher->setFuture(QtConcurrent::run(&VideoProber::runProbe,
+                                         m_backends, filePath,
+                                         m_cache, m_cancelFlag));
+}
+
+// ----------------- Worker -----------------
+
+ProbeResult VideoProber::runProbe(const ProbeBackendList &backends,
+                                  const QString &filePath,
+                                  const std::shared_ptr<ProbeCache> &cache,
+                                  const CancelFlag &cancelled)
+{
+    // Hashing the sampled blocks touches the disk, so it belongs here too
+    const FileIdentity id = FileIdentity::of(filePath);
+
+    ProbeResult result;
+    if (cache && cache->lookup(id, result.info)) {
+        result.ok = true;
+        result.fromCache = true;
+        return result;
+    }
+
+    // First backend that succeeds wins; ffprobe is always last
+    for (const auto &backend : backends) {
+        result = backend->probe(filePath, *cancelled);
+        if (result.ok || cancelled->load())
+            break;
+
+        qDebug() << "Probe backend" << backend->name() << "failed:" << result.error;
+    }
+
+    if (backends.isEmpty())
+        result.error = "No probe backend available";
+
+    if (result.ok && cache)
+        cache->store(id, result.info);
+
+    return result;
+}
@@ -0,0 +1,59 @@
+#ifndef VIDEOPROBER_H
+#define VIDEOPROBER_H
+
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+
+#include <atomic>
+#include <memory>
+
+#include "videoinfo.h"
+#include "probebackend.h"
+
+class ProbeCache;
+
+// Runs the probe backends on a worker thread so the window never blocks
+// on a slow disk or network share. Only one probe is active at a time:
+// starting a new one (or calling cancel()) abandons the previous request,
+// aborts its backend and drops its result. Results are served from the
+// on-disk ProbeCache when the file hasn't changed since it was last seen.
+class VideoProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VideoProber(QObject *parent = nullptr);
+    ~VideoProber();
+
+    void setFfprobePath(const QString &path);
+
+    void probe(const QString &filePath);
+    void cancel();
+
+    bool isRunning() const;
+    QString currentFile() const { return m_currentFile; }
+
+    ProbeCache *cache() const { return m_cache.get(); }
+
+signals:
+    void probeFinished(const QString &filePath, const VideoInfo &info);
+    void probeFailed(const QString &filePath, const QString &error);
+
+private:
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+
+    static ProbeResult runProbe(const ProbeBackendList &backends,
+                                const QString &filePath,
+                                const std::shared_ptr<ProbeCache> &cache,
+                                const CancelFlag &cancelled);
+
+    ProbeBackendList m_backends;
+    QString m_currentFile;
+
+    std::shared_ptr<ProbeCache> m_cache;
+    CancelFlag m_cancelFlag;
+    QFutureWatcher<ProbeResult> *m_watcher = nullptr;
+};
+
+#endif // VIDEOPROBER_H